@@ -0,0 +1,124 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/ContainerAllocationPolicies.h"
+#include <atomic>
+
+/**
+ * Fixed-capacity ring that any number of threads may push to. Each cell carries a sequence number telling
+ * producers and consumers whose turn it is, so a push or pop is one CAS on the shared cursor plus a store to the
+ * cell. Cells and cursors sit on their own cache lines so producers on different threads don't false-share.
+ *
+ * Pops are safe from any thread too, which lets a producer make room by discarding the oldest element itself.
+ * Capacity is rounded up to a power of two.
+ */
+template <typename ElementType>
+class TBoundedMpscQueue
+{
+	public:
+	explicit TBoundedMpscQueue(const uint32 InCapacity)
+		: Capacity(FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(InCapacity, 2)))
+		, Mask(Capacity - 1)
+	{
+		Cells.SetNum(Capacity);
+		for (uint32 Index = 0; Index < Capacity; ++Index)
+		{
+			Cells[Index].Sequence.store(Index, std::memory_order_relaxed);
+		}
+	}
+
+	uint32 GetCapacity() const
+	{
+		return Capacity;
+	}
+
+	// Size of the ring; elements that allocate on their own are not counted
+	SIZE_T GetAllocatedSize() const
+	{
+		return Cells.GetAllocatedSize();
+	}
+
+	// Fails without touching Element if the ring is full
+	bool TryEnqueue(ElementType&& Element)
+	{
+		uint64 Position = EnqueuePosition.Value.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			FCell& Cell = Cells[static_cast<int32>(Position & Mask)];
+			const uint64 Sequence = Cell.Sequence.load(std::memory_order_acquire);
+			const int64 Lag = static_cast<int64>(Sequence - Position);
+			if (Lag == 0)
+			{
+				if (EnqueuePosition.Value.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+				{
+					Cell.Element = MoveTemp(Element);
+					Cell.Sequence.store(Position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (Lag < 0)
+			{
+				return false;
+			}
+			else
+			{
+				Position = EnqueuePosition.Value.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool TryDequeue(ElementType& OutElement)
+	{
+		uint64 Position = DequeuePosition.Value.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			FCell& Cell = Cells[static_cast<int32>(Position & Mask)];
+			const uint64 Sequence = Cell.Sequence.load(std::memory_order_acquire);
+			const int64 Lag = static_cast<int64>(Sequence - (Position + 1));
+			if (Lag == 0)
+			{
+				if (DequeuePosition.Value.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+				{
+					OutElement = MoveTemp(Cell.Element);
+					Cell.Element = ElementType();
+					Cell.Sequence.store(Position + Capacity, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (Lag < 0)
+			{
+				return false;
+			}
+			else
+			{
+				Position = DequeuePosition.Value.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Approximate while producers or consumers are active
+	int32 Num() const
+	{
+		const uint64 Enqueued = EnqueuePosition.Value.load(std::memory_order_relaxed);
+		const uint64 Dequeued = DequeuePosition.Value.load(std::memory_order_relaxed);
+		return Enqueued > Dequeued ? static_cast<int32>(Enqueued - Dequeued) : 0;
+	}
+
+	private:
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FCell
+	{
+		std::atomic<uint64> Sequence{0};
+		ElementType Element;
+	};
+
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FPaddedPosition
+	{
+		std::atomic<uint64> Value{0};
+	};
+
+	const uint32 Capacity;
+	const uint64 Mask;
+	TArray<FCell, TAlignedHeapAllocator<PLATFORM_CACHE_LINE_SIZE>> Cells;
+	FPaddedPosition EnqueuePosition;
+	FPaddedPosition DequeuePosition;
+};
@@ -0,0 +1,68 @@
+#include "DeadlineWheel.h"
+
+FDeadlineWheel::FDeadlineWheel(const double InResolution, const uint32 NumBuckets, const double Now)
+	: Resolution(FMath::Max(InResolution, 0.001))
+{
+	Buckets.SetNum(FMath::Max<uint32>(NumBuckets, 1));
+	CurrentTick = static_cast<uint64>(Now / Resolution);
+}
+
+uint64 FDeadlineWheel::ToTick(const double Time) const
+{
+	// Rounded up so nothing is expired before its deadline
+	return static_cast<uint64>(FMath::CeilToDouble(Time / Resolution));
+}
+
+void FDeadlineWheel::Schedule(const uint64 Id, const double Deadline)
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+
+	// A deadline that has already passed goes in the next bucket to be visited
+	const uint64 Tick = FMath::Max(ToTick(Deadline), CurrentTick + 1);
+	Buckets[static_cast<int32>(Tick % Buckets.Num())].Add({Id, Tick});
+}
+
+int32 FDeadlineWheel::Advance(const double Now, const TFunctionRef<void(uint64)> OnExpired)
+{
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		const uint64 NowTick = static_cast<uint64>(Now / Resolution);
+		if (NowTick <= CurrentTick) return 0;
+
+		// After a long stall every bucket is visited once rather than once per elapsed tick
+		const uint64 Ticks = FMath::Min<uint64>(NowTick - CurrentTick, Buckets.Num());
+		for (uint64 Tick = NowTick - Ticks + 1; Tick <= NowTick; ++Tick)
+		{
+			TArray<FEntry>& Bucket = Buckets[static_cast<int32>(Tick % Buckets.Num())];
+			for (int32 Index = Bucket.Num() - 1; Index >= 0; --Index)
+			{
+				if (Bucket[Index].Tick <= NowTick)
+				{
+					Expired.Add(Bucket[Index].Id);
+					Bucket.RemoveAtSwap(Index, 1, false);
+				}
+			}
+		}
+		CurrentTick = NowTick;
+	}
+
+	// Only Advance touches Expired, and it is called from one thread at a time
+	const int32 Count = Expired.Num();
+	for (const uint64 Id : Expired)
+	{
+		OnExpired(Id);
+	}
+	Expired.Reset();
+	return Count;
+}
+
+SIZE_T FDeadlineWheel::GetAllocatedSize() const
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	SIZE_T Size = Buckets.GetAllocatedSize();
+	for (const TArray<FEntry>& Bucket : Buckets)
+	{
+		Size += Bucket.GetAllocatedSize();
+	}
+	return Size;
+}
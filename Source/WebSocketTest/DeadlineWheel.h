@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <mutex>
+
+/**
+ * Hashed timer wheel of request deadlines. Scheduling drops the id into the bucket for its deadline tick, and
+ * Advance only visits the buckets for ticks that have passed since the last call, so the cost per tick depends on
+ * how many requests are due rather than on how many are pending. Deadlines further out than one rotation stay in
+ * their bucket until the rotation they fall in comes round.
+ *
+ * Entries are never removed early. An entry whose request already finished, or whose deadline moved, is simply
+ * passed to the expiry callback, which has to check whether the request is actually due.
+ */
+class WEBSOCKETTEST_API FDeadlineWheel
+{
+	public:
+	FDeadlineWheel(double InResolution, uint32 NumBuckets, double Now);
+
+	// Safe from any thread
+	void Schedule(uint64 Id, double Deadline);
+
+	/**
+	 * Hands every id whose deadline tick has passed to OnExpired, returning how many there were. Call from one
+	 * thread at a time; OnExpired runs outside the wheel's lock, so it may schedule again.
+	 */
+	int32 Advance(double Now, TFunctionRef<void(uint64)> OnExpired);
+
+	SIZE_T GetAllocatedSize() const;
+
+	private:
+	struct FEntry
+	{
+		uint64 Id;
+		uint64 Tick;
+	};
+
+	const double Resolution;
+	TArray<TArray<FEntry>> Buckets;
+	uint64 CurrentTick;
+	mutable std::mutex Mutex;
+
+	// Due ids are moved here under the lock and expired after it is released
+	TArray<uint64> Expired;
+
+	uint64 ToTick(double Time) const;
+};
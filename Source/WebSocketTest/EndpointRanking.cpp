@@ -0,0 +1,179 @@
+#include "EndpointRanking.h"
+#include "Misc/FileHelper.h"
+
+FEndpointRanking::FEndpointRanking(const TArray<FString>& Urls, const FString& InCacheFile)
+	: CacheFile(InCacheFile)
+{
+	for (const FString& Url : Urls)
+	{
+		Endpoints.Add({Url, -1.0});
+	}
+	LoadCache();
+}
+
+FEndpointRanking::~FEndpointRanking()
+{
+	CancelProbe();
+}
+
+const FString& FEndpointRanking::GetBest() const
+{
+	return Endpoints[0].Url;
+}
+
+const FString& FEndpointRanking::GetNext(const FString& Current) const
+{
+	const int32 Index = Endpoints.IndexOfByPredicate([&Current](const FEndpoint& Endpoint) { return Endpoint.Url == Current; });
+	return Endpoints[Index == INDEX_NONE ? 0 : (Index + 1) % Endpoints.Num()].Url;
+}
+
+double FEndpointRanking::GetRttMs(const FString& Url) const
+{
+	const FEndpoint* Endpoint = Endpoints.FindByPredicate([&Url](const FEndpoint& Candidate) { return Candidate.Url == Url; });
+	return Endpoint ? Endpoint->RttMs : -1.0;
+}
+
+void FEndpointRanking::Probe(FWebSocketsModule& Module, const TArray<FString>& Protocols, const float TimeoutSeconds, TFunction<void()> OnRanked)
+{
+	CancelProbe();
+	OnProbeRanked = MoveTemp(OnRanked);
+	ProbesLeft = Endpoints.Num();
+	Probes.SetNum(Endpoints.Num());
+
+	// Every socket is created before any connects, so no probe is held up by the ones before it
+	for (int32 Index = 0; Index < Endpoints.Num(); ++Index)
+	{
+		FProbe& Probe = Probes[Index];
+		Probe.Socket = Protocols.Num() > 0
+			? Module.CreateWebSocket(Endpoints[Index].Url, Protocols)
+			: Module.CreateWebSocket(Endpoints[Index].Url);
+		Probe.Socket->OnConnected().AddLambda([this, Index]() {
+			OnProbeDone(Index, (FPlatformTime::Seconds() - Probes[Index].Start) * 1000.0);
+		});
+		Probe.Socket->OnConnectionError().AddLambda([this, Index](const FString& Error) {
+			UE_LOG(LogTemp, Log, TEXT("Probe of %s failed: \"%s\""), *Endpoints[Index].Url, *Error);
+			OnProbeDone(Index, -1.0);
+		});
+	}
+
+	ProbeTimeoutHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FEndpointRanking::OnProbeTimeout), TimeoutSeconds);
+	for (FProbe& Probe : Probes)
+	{
+		Probe.Start = FPlatformTime::Seconds();
+		Probe.Socket->Connect();
+	}
+}
+
+void FEndpointRanking::CancelProbe()
+{
+	if (ProbeTimeoutHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(ProbeTimeoutHandle);
+		ProbeTimeoutHandle.Reset();
+	}
+	for (FProbe& Probe : Probes)
+	{
+		Probe.Socket->OnConnected().Clear();
+		Probe.Socket->OnConnectionError().Clear();
+		Probe.Socket->Close();
+	}
+	Probes.Reset();
+	ProbesLeft = 0;
+	OnProbeRanked.Reset();
+}
+
+void FEndpointRanking::OnProbeDone(const int32 Index, const double RttMs)
+{
+	FProbe& Probe = Probes[Index];
+	if (Probe.bDone) return;
+	Probe.bDone = true;
+	Probe.RttMs = RttMs;
+	if (RttMs >= 0.0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Probe of %s connected in %.1fms"), *Endpoints[Index].Url, RttMs);
+	}
+
+	// Finished from the ticker rather than here, since that closes the socket whose event is being delivered
+	if (--ProbesLeft == 0)
+	{
+		FTicker::GetCoreTicker().RemoveTicker(ProbeTimeoutHandle);
+		ProbeTimeoutHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FEndpointRanking::OnProbeTimeout));
+	}
+}
+
+bool FEndpointRanking::OnProbeTimeout(float DeltaTime)
+{
+	ProbeTimeoutHandle.Reset();
+	if (ProbesLeft > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Endpoint probe timed out with %d endpoints unanswered"), ProbesLeft);
+	}
+	FinishProbe();
+	return false;
+}
+
+void FEndpointRanking::FinishProbe()
+{
+	for (int32 Index = 0; Index < Endpoints.Num(); ++Index)
+	{
+		Endpoints[Index].RttMs = Probes[Index].RttMs;
+	}
+
+	// Stable, so endpoints that did not answer keep the order they had
+	Endpoints.StableSort([](const FEndpoint& A, const FEndpoint& B)
+	{
+		return A.RttMs >= 0.0 && (B.RttMs < 0.0 || A.RttMs < B.RttMs);
+	});
+	bRanked = true;
+	SaveCache();
+
+	// Cleared first, since OnRanked may well start the next connection attempt
+	TFunction<void()> OnRanked = MoveTemp(OnProbeRanked);
+	CancelProbe();
+	if (OnRanked)
+	{
+		OnRanked();
+	}
+}
+
+void FEndpointRanking::LoadCache()
+{
+	TArray<FString> Lines;
+	if (CacheFile.IsEmpty() || !FFileHelper::LoadFileToStringArray(Lines, *CacheFile)) return;
+
+	// Each line is "<url>\t<rtt ms>", best first; endpoints no longer configured are ignored and new ones go last
+	TArray<FEndpoint> Ranked;
+	for (const FString& Line : Lines)
+	{
+		FString Url;
+		FString RttMs;
+		if (!Line.Split(TEXT("\t"), &Url, &RttMs)) continue;
+
+		const int32 Index = Endpoints.IndexOfByPredicate([&Url](const FEndpoint& Endpoint) { return Endpoint.Url == Url; });
+		if (Index != INDEX_NONE)
+		{
+			Ranked.Add({Url, FCString::Atod(*RttMs)});
+			Endpoints.RemoveAt(Index);
+		}
+	}
+	if (Ranked.Num() == 0) return;
+
+	Ranked.Append(Endpoints);
+	Endpoints = MoveTemp(Ranked);
+	bRanked = true;
+}
+
+void FEndpointRanking::SaveCache() const
+{
+	if (CacheFile.IsEmpty()) return;
+
+	TArray<FString> Lines;
+	for (const FEndpoint& Endpoint : Endpoints)
+	{
+		Lines.Add(FString::Printf(TEXT("%s\t%f"), *Endpoint.Url, Endpoint.RttMs));
+	}
+	if (!FFileHelper::SaveStringArrayToFile(Lines, *CacheFile))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Couldn't save endpoint ranking to %s"), *CacheFile);
+	}
+}
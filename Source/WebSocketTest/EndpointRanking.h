@@ -0,0 +1,90 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "IWebSocket.h"
+#include "WebSocketsModule.h"
+
+/**
+ * Endpoints of one service, best first. Probe opens a socket to every endpoint at once and ranks them by how long
+ * the handshake took; endpoints that failed or did not answer in time keep their previous order behind the ones
+ * that did. The ranking is saved to CacheFile after every probe and loaded on construction, so a client that has
+ * run before can connect to the best endpoint straight away.
+ *
+ * Only used on the game thread, where socket events and tickers run.
+ */
+class WEBSOCKETTEST_API FEndpointRanking
+{
+	public:
+	// An empty CacheFile keeps the ranking for this session only
+	FEndpointRanking(const TArray<FString>& Urls, const FString& InCacheFile);
+
+	~FEndpointRanking();
+
+	int32 Num() const
+	{
+		return Endpoints.Num();
+	}
+
+	// Whether the order came from a probe, in this session or a cached earlier one, rather than the configuration
+	bool IsRanked() const
+	{
+		return bRanked;
+	}
+
+	bool IsProbing() const
+	{
+		return Probes.Num() > 0;
+	}
+
+	const FString& GetBest() const;
+
+	// The endpoint ranked after Current, wrapping round to the best; the best if Current is not one of them
+	const FString& GetNext(const FString& Current) const;
+
+	// Handshake time of the endpoint's last successful probe, or a negative value if there was none
+	double GetRttMs(const FString& Url) const;
+
+	// Probes every endpoint in parallel, re-ranks them and calls OnRanked, at the latest after TimeoutSeconds
+	void Probe(FWebSocketsModule& Module, const TArray<FString>& Protocols, float TimeoutSeconds, TFunction<void()> OnRanked);
+
+	// Drops a probe in progress without calling its OnRanked
+	void CancelProbe();
+
+	private:
+	struct FEndpoint
+	{
+		FString Url;
+		double RttMs = -1.0;
+	};
+
+	struct FProbe
+	{
+		TSharedPtr<IWebSocket> Socket;
+		double Start = 0.0;
+		double RttMs = -1.0;
+		bool bDone = false;
+	};
+
+	TArray<FEndpoint> Endpoints;
+	const FString CacheFile;
+	bool bRanked = false;
+
+	// One per endpoint, in the order of Endpoints, while a probe is running
+	TArray<FProbe> Probes;
+	int32 ProbesLeft = 0;
+	TFunction<void()> OnProbeRanked;
+	FDelegateHandle ProbeTimeoutHandle;
+
+	void OnProbeDone(int32 Index, double RttMs);
+
+	// Fires at the probe's timeout, or on the next tick once every endpoint has answered
+	bool OnProbeTimeout(float DeltaTime);
+
+	// Re-ranks the endpoints from the probe results, saves them and calls OnRanked
+	void FinishProbe();
+
+	void LoadCache();
+
+	void SaveCache() const;
+};
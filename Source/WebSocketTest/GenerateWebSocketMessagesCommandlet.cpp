@@ -0,0 +1,193 @@
+#include "GenerateWebSocketMessagesCommandlet.h"
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	// Same rule as WebSocketMessage::IsValidMsgType, reported here rather than as a static_assert in the build
+	bool IsValidMsgType(const FString& Name)
+	{
+		if (Name.IsEmpty()) return false;
+		for (const TCHAR Char : Name)
+		{
+			if (Char < 0x20 || Char > 0x7e || Char == TEXT('"') || Char == TEXT('\\')) return false;
+		}
+		return true;
+	}
+
+	bool IsIdentifier(const FString& Name)
+	{
+		if (Name.IsEmpty() || FChar::IsDigit(Name[0])) return false;
+		for (const TCHAR Char : Name)
+		{
+			if (!FChar::IsAlnum(Char) && Char != TEXT('_')) return false;
+		}
+		return true;
+	}
+
+	// A missing array reads as an empty one
+	const TArray<TSharedPtr<FJsonValue>>& GetArray(const FJsonObject& Object, const TCHAR* Name)
+	{
+		static const TArray<TSharedPtr<FJsonValue>> Empty;
+		const TArray<TSharedPtr<FJsonValue>>* Array = nullptr;
+		return Object.TryGetArrayField(Name, Array) ? *Array : Empty;
+	}
+}
+
+int32 UGenerateWebSocketMessagesCommandlet::Main(const FString& Params)
+{
+	const FString SourceDir = FPaths::Combine(FPaths::GameSourceDir(), TEXT("WebSocketTest"));
+	FString SchemaPath = FPaths::Combine(SourceDir, TEXT("WebSocketStructs.schema.json"));
+	FString OutputPath = FPaths::Combine(SourceDir, TEXT("WebSocketStructs.h"));
+	FParse::Value(*Params, TEXT("Schema="), SchemaPath);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	const bool bCheck = FParse::Param(*Params, TEXT("Check"));
+
+	FString SchemaText;
+	if (!FFileHelper::LoadFileToString(SchemaText, *SchemaPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't read schema %s"), *SchemaPath);
+		return 1;
+	}
+	TSharedPtr<FJsonObject> Schema;
+	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(SchemaText), Schema) || !Schema.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't parse schema %s"), *SchemaPath);
+		return 1;
+	}
+
+	FString Header;
+	FString Error;
+	if (!Generate(*Schema, Header, Error))
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s: %s"), *SchemaPath, *Error);
+		return 1;
+	}
+
+	// An unchanged header is left alone, so the build does not see it as modified
+	FString Existing;
+	if (FFileHelper::LoadFileToString(Existing, *OutputPath) && Existing == Header)
+	{
+		UE_LOG(LogTemp, Display, TEXT("%s is up to date"), *OutputPath);
+		return 0;
+	}
+	if (bCheck)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s is out of date with %s"), *OutputPath, *SchemaPath);
+		return 1;
+	}
+	if (!FFileHelper::SaveStringToFile(Header, *OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't write %s"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("Wrote %s"), *OutputPath);
+	return 0;
+}
+
+bool UGenerateWebSocketMessagesCommandlet::Generate(const FJsonObject& Schema, FString& OutHeader, FString& OutError)
+{
+	OutHeader = TEXT("// Generated from WebSocketStructs.schema.json by the GenerateWebSocketMessages commandlet; edit the schema\n")
+		TEXT("// and run it again rather than editing this file\n")
+		TEXT("#pragma once\n")
+		TEXT("\n")
+		TEXT("#include \"WebSocketMessage.h\"\n")
+		TEXT("#include \"WebSocketStructs.generated.h\"\n");
+
+	// Structs are written in schema order, so a base or field type has to come before its first use
+	TSet<FString> Structs;
+	for (const TSharedPtr<FJsonValue>& StructValue : GetArray(Schema, TEXT("structs")))
+	{
+		const TSharedPtr<FJsonObject>* Struct = nullptr;
+		FString Name;
+		if (!StructValue->TryGetObject(Struct) || !(*Struct)->TryGetStringField(TEXT("name"), Name) || !IsIdentifier(Name))
+		{
+			OutError = TEXT("Every struct needs a name that is a C++ identifier");
+			return false;
+		}
+		FString Base;
+		(*Struct)->TryGetStringField(TEXT("base"), Base);
+		if (!Base.IsEmpty() && !Structs.Contains(Base))
+		{
+			OutError = FString::Printf(TEXT("%s derives from %s, which is not declared before it"), *Name, *Base);
+			return false;
+		}
+		Structs.Add(Name);
+
+		OutHeader += TEXT("\nUSTRUCT()\nstruct ") + Name + (Base.IsEmpty() ? FString() : TEXT(" : public ") + Base) + TEXT("\n{\n\tGENERATED_BODY()\n");
+		for (const TSharedPtr<FJsonValue>& FieldValue : GetArray(**Struct, TEXT("fields")))
+		{
+			const TSharedPtr<FJsonObject>* Field = nullptr;
+			FString FieldName;
+			FString Type;
+			if (!FieldValue->TryGetObject(Field) || !(*Field)->TryGetStringField(TEXT("name"), FieldName) || !(*Field)->TryGetStringField(TEXT("type"), Type) || !IsIdentifier(FieldName))
+			{
+				OutError = FString::Printf(TEXT("Every field of %s needs a name and a type"), *Name);
+				return false;
+			}
+			FString Default;
+			FString Comment;
+			(*Field)->TryGetStringField(TEXT("default"), Default);
+			(*Field)->TryGetStringField(TEXT("comment"), Comment);
+
+			OutHeader += TEXT("\n\tUPROPERTY()\n\t") + Type + TEXT(" ") + FieldName;
+			if (!Default.IsEmpty())
+			{
+				OutHeader += TEXT(" = ") + Default;
+			}
+			OutHeader += TEXT(";");
+			if (!Comment.IsEmpty())
+			{
+				OutHeader += TEXT(" //") + Comment;
+			}
+			OutHeader += TEXT("\n");
+		}
+		OutHeader += TEXT("};\n");
+	}
+
+	OutHeader += TEXT("\n");
+	for (const TSharedPtr<FJsonValue>& MessageValue : GetArray(Schema, TEXT("messages")))
+	{
+		const TSharedPtr<FJsonObject>* Message = nullptr;
+		FString Type;
+		FString MsgType;
+		if (!MessageValue->TryGetObject(Message) || !(*Message)->TryGetStringField(TEXT("type"), Type) || !(*Message)->TryGetStringField(TEXT("msgType"), MsgType))
+		{
+			OutError = TEXT("Every message needs a type and a msgType");
+			return false;
+		}
+		if (!Structs.Contains(Type))
+		{
+			OutError = FString::Printf(TEXT("Message %s uses %s, which is not declared"), *MsgType, *Type);
+			return false;
+		}
+		if (!IsValidMsgType(MsgType))
+		{
+			OutError = FString::Printf(TEXT("msgType of %s must be printable ASCII without quotes or backslashes"), *Type);
+			return false;
+		}
+
+		bool bEvent = false;
+		(*Message)->TryGetBoolField(TEXT("event"), bEvent);
+		if (bEvent)
+		{
+			OutHeader += FString::Printf(TEXT("DECLARE_WEBSOCKET_EVENT(%s, \"%s\")\n"), *Type, *MsgType);
+			continue;
+		}
+
+		FString Response;
+		bool bAck = false;
+		(*Message)->TryGetStringField(TEXT("response"), Response);
+		(*Message)->TryGetBoolField(TEXT("ack"), bAck);
+		if (!Response.IsEmpty() && !Structs.Contains(Response))
+		{
+			OutError = FString::Printf(TEXT("Message %s is answered with %s, which is not declared"), *MsgType, *Response);
+			return false;
+		}
+		OutHeader += FString::Printf(TEXT("DECLARE_WEBSOCKET_MESSAGE(%s, \"%s\", %s, %s)\n"), *Type, *MsgType, Response.IsEmpty() ? TEXT("void") : *Response, bAck ? TEXT("true") : TEXT("false"));
+	}
+	return true;
+}
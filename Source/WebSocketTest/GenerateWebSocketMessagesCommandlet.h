@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GenerateWebSocketMessagesCommandlet.generated.h"
+
+/**
+ * Writes WebSocketStructs.h, the message USTRUCTs and their DECLARE_WEBSOCKET_MESSAGE lines, from the schema shared
+ * with the server, so the two cannot drift apart.
+ *
+ * UE4Editor-Cmd WebSocketTest.uproject -run=GenerateWebSocketMessages [-Schema=<json>] [-Output=<header>] [-Check]
+ *
+ * Both paths default to the files next to this one. -Check writes nothing and fails if the header is out of date.
+ */
+UCLASS()
+class UGenerateWebSocketMessagesCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+	public:
+	virtual int32 Main(const FString& Params) override;
+
+	// Builds the header for a parsed schema; returns false with OutError set if the schema is invalid
+	static bool Generate(const FJsonObject& Schema, FString& OutHeader, FString& OutError);
+};
@@ -0,0 +1,478 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JsonObjectConverter.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "StructPlan.h"
+
+namespace JsonStreamReader_Private
+{
+	// Exact comparison of a raw key span against a plain ASCII key, e.g. an envelope field name
+	template <typename CharType>
+	bool KeyEquals(const CharType* Begin, const CharType* End, const ANSICHAR* Key)
+	{
+		for (; Begin < End; ++Begin, ++Key)
+		{
+			if (*Key == 0 || *Begin != static_cast<CharType>(*Key)) return false;
+		}
+		return *Key == 0;
+	}
+
+	inline bool KeyMatches(const TCHAR* Begin, const TCHAR* End, const FStructPlanField& Field)
+	{
+		const int32 Length = static_cast<int32>(End - Begin);
+		return Length == Field.Name.Len() && FCString::Strnicmp(Begin, *Field.Name, Length) == 0;
+	}
+
+	inline bool KeyMatches(const ANSICHAR* Begin, const ANSICHAR* End, const FStructPlanField& Field)
+	{
+		return Field.MatchesUtf8Key(Begin, static_cast<int32>(End - Begin));
+	}
+
+	inline void AppendRun(FString& Out, const TCHAR* Begin, const TCHAR* End)
+	{
+		Out.AppendChars(Begin, static_cast<int32>(End - Begin));
+	}
+
+	inline void AppendRun(FString& Out, const ANSICHAR* Begin, const ANSICHAR* End)
+	{
+		const FUTF8ToTCHAR Converted(Begin, static_cast<int32>(End - Begin));
+		Out.AppendChars(Converted.Get(), Converted.Length());
+	}
+
+	inline void AppendCodePoint(FString& Out, const uint32 CodePoint)
+	{
+		if (sizeof(TCHAR) == 2 && CodePoint >= 0x10000)
+		{
+			Out.AppendChar(static_cast<TCHAR>(0xD800 + ((CodePoint - 0x10000) >> 10)));
+			Out.AppendChar(static_cast<TCHAR>(0xDC00 + ((CodePoint - 0x10000) & 0x3FF)));
+		}
+		else
+		{
+			Out.AppendChar(static_cast<TCHAR>(CodePoint));
+		}
+	}
+}
+
+/**
+ * Pull parser over a span of JSON text that decodes straight into reflected structs using their cached
+ * FStructPlan, without building an FJsonObject DOM. CharType is TCHAR for FString input or ANSICHAR for raw
+ * UTF-8 bytes.
+ *
+ * Values whose JSON type does not match the fast path for their property (and property kinds the plan does not
+ * model) are handed to FJsonObjectConverter, so decoding stays as lenient as JsonObjectToUStruct.
+ */
+template <typename CharType>
+class TJsonStreamReader
+{
+	public:
+	TJsonStreamReader(const CharType* InBegin, const CharType* InEnd) : Cursor(InBegin), End(InEnd) {}
+
+	// Reads an object into the struct; unknown keys are skipped and missing keys keep their current values
+	bool ReadStruct(const UScriptStruct* Struct, void* Data)
+	{
+		const FStructPlan& Plan = FStructPlan::Get(Struct);
+		return ForEachMember([this, &Plan, Data](const CharType* KeyBegin, const CharType* KeyEnd, const bool bKeyEscaped)
+		{
+			for (const FStructPlanField& Field : Plan.Fields)
+			{
+				if (bKeyEscaped ? DecodeKey(KeyBegin, KeyEnd).Equals(Field.Name, ESearchCase::IgnoreCase) : JsonStreamReader_Private::KeyMatches(KeyBegin, KeyEnd, Field))
+				{
+					return ReadField(Field, Field.Property->ContainerPtrToValuePtr<void>(Data));
+				}
+			}
+			return SkipValue();
+		});
+	}
+
+	template <typename TStruct>
+	bool ReadStruct(TStruct& Data)
+	{
+		return ReadStruct(TStruct::StaticStruct(), &Data);
+	}
+
+	/**
+	 * Visits each member of the object at the cursor. Visit receives the raw key span (without quotes) and
+	 * whether it contains escapes, and must consume the member's value.
+	 */
+	template <typename FuncType>
+	bool ForEachMember(FuncType&& Visit)
+	{
+		if (!Consume('{')) return false;
+		if (Peek() == '}')
+		{
+			++Cursor;
+			return true;
+		}
+		do
+		{
+			const CharType* KeyBegin = nullptr;
+			const CharType* KeyEnd = nullptr;
+			bool bKeyEscaped = false;
+			if (!ReadStringSpan(KeyBegin, KeyEnd, bKeyEscaped) || !Consume(':') || !Visit(KeyBegin, KeyEnd, bKeyEscaped))
+			{
+				return false;
+			}
+		}
+		while (ConsumeIf(','));
+		return Consume('}');
+	}
+
+	// Visits each element of the array at the cursor; Visit must consume the element
+	template <typename FuncType>
+	bool ForEachElement(FuncType&& Visit)
+	{
+		if (!Consume('[')) return false;
+		if (Peek() == ']')
+		{
+			++Cursor;
+			return true;
+		}
+		do
+		{
+			if (!Visit()) return false;
+		}
+		while (ConsumeIf(','));
+		return Consume(']');
+	}
+
+	// Skips whitespace and returns the next character without consuming it, or 0 at the end
+	CharType Peek()
+	{
+		while (Cursor < End && (*Cursor == ' ' || *Cursor == '\t' || *Cursor == '\n' || *Cursor == '\r'))
+		{
+			++Cursor;
+		}
+		return Cursor < End ? *Cursor : CharType(0);
+	}
+
+	const CharType* GetCursor() const
+	{
+		return Cursor;
+	}
+
+	bool ReadString(FString& Out)
+	{
+		const CharType* Begin = nullptr;
+		const CharType* StringEnd = nullptr;
+		bool bEscaped = false;
+		if (!ReadStringSpan(Begin, StringEnd, bEscaped)) return false;
+		Out.Reset(static_cast<int32>(StringEnd - Begin));
+		if (bEscaped)
+		{
+			return Unescape(Begin, StringEnd, Out);
+		}
+		JsonStreamReader_Private::AppendRun(Out, Begin, StringEnd);
+		return true;
+	}
+
+	bool ReadUInt64(uint64& Out)
+	{
+		ANSICHAR Number[64];
+		bool bIsInteger = false;
+		if (!ReadNumberToken(Number, bIsInteger)) return false;
+		Out = bIsInteger ? FCStringAnsi::Strtoui64(Number, nullptr, 10) : static_cast<uint64>(FCStringAnsi::Atod(Number));
+		return true;
+	}
+
+	bool SkipValue()
+	{
+		switch (Peek())
+		{
+		case '{':
+			return ForEachMember([this](const CharType*, const CharType*, bool) { return SkipValue(); });
+		case '[':
+			return ForEachElement([this]() { return SkipValue(); });
+		case '"':
+		{
+			const CharType* Begin = nullptr;
+			const CharType* StringEnd = nullptr;
+			bool bEscaped = false;
+			return ReadStringSpan(Begin, StringEnd, bEscaped);
+		}
+		case 't':
+			return ConsumeLiteral("true");
+		case 'f':
+			return ConsumeLiteral("false");
+		case 'n':
+			return ConsumeLiteral("null");
+		default:
+		{
+			ANSICHAR Number[64];
+			bool bIsInteger = false;
+			return ReadNumberToken(Number, bIsInteger);
+		}
+		}
+	}
+
+	private:
+	const CharType* Cursor;
+	const CharType* End;
+
+	bool Consume(const CharType Expected)
+	{
+		if (Peek() != Expected) return false;
+		++Cursor;
+		return true;
+	}
+
+	bool ConsumeIf(const CharType Expected)
+	{
+		return Consume(Expected);
+	}
+
+	bool ConsumeLiteral(const ANSICHAR* Literal)
+	{
+		Peek();
+		for (; *Literal; ++Literal, ++Cursor)
+		{
+			if (Cursor >= End || *Cursor != static_cast<CharType>(*Literal)) return false;
+		}
+		return true;
+	}
+
+	// Reads a quoted string, returning the span between the quotes
+	bool ReadStringSpan(const CharType*& OutBegin, const CharType*& OutEnd, bool& bOutEscaped)
+	{
+		if (!Consume('"')) return false;
+		OutBegin = Cursor;
+		bOutEscaped = false;
+		while (Cursor < End && *Cursor != '"')
+		{
+			if (*Cursor == '\\')
+			{
+				bOutEscaped = true;
+				++Cursor;
+			}
+			++Cursor;
+		}
+		if (Cursor >= End) return false;
+		OutEnd = Cursor++;
+		return true;
+	}
+
+	// Copies a JSON number into Out as ASCII, so it can be handed to the CString parsers
+	bool ReadNumberToken(ANSICHAR (&Out)[64], bool& bOutIsInteger)
+	{
+		Peek();
+		int32 Length = 0;
+		bOutIsInteger = true;
+		while (Cursor < End && Length < 63)
+		{
+			const CharType Char = *Cursor;
+			if (Char == '.' || Char == 'e' || Char == 'E')
+			{
+				bOutIsInteger = false;
+			}
+			else if (!(Char >= '0' && Char <= '9') && Char != '-' && Char != '+')
+			{
+				break;
+			}
+			Out[Length++] = static_cast<ANSICHAR>(Char);
+			++Cursor;
+		}
+		Out[Length] = 0;
+		return Length > 0;
+	}
+
+	FString DecodeKey(const CharType* Begin, const CharType* KeyEnd)
+	{
+		FString Key;
+		Unescape(Begin, KeyEnd, Key);
+		return Key;
+	}
+
+	bool Unescape(const CharType* Begin, const CharType* StringEnd, FString& Out)
+	{
+		const CharType* Run = Begin;
+		for (const CharType* Char = Begin; Char < StringEnd; ++Char)
+		{
+			if (*Char != '\\') continue;
+
+			JsonStreamReader_Private::AppendRun(Out, Run, Char);
+			if (++Char >= StringEnd) return false;
+			switch (*Char)
+			{
+			case 'b': Out.AppendChar(TEXT('\b')); break;
+			case 'f': Out.AppendChar(TEXT('\f')); break;
+			case 'n': Out.AppendChar(TEXT('\n')); break;
+			case 'r': Out.AppendChar(TEXT('\r')); break;
+			case 't': Out.AppendChar(TEXT('\t')); break;
+			case 'u':
+			{
+				uint32 CodePoint = 0;
+				if (!ReadHex4(Char + 1, StringEnd, CodePoint)) return false;
+				Char += 4;
+				// Join an escaped UTF-16 surrogate pair
+				uint32 Low = 0;
+				if (CodePoint >= 0xD800 && CodePoint <= 0xDBFF && Char + 2 < StringEnd && Char[1] == '\\' && Char[2] == 'u'
+					&& ReadHex4(Char + 3, StringEnd, Low) && Low >= 0xDC00 && Low <= 0xDFFF)
+				{
+					CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (Low - 0xDC00);
+					Char += 6;
+				}
+				JsonStreamReader_Private::AppendCodePoint(Out, CodePoint);
+				break;
+			}
+			default: Out.AppendChar(static_cast<TCHAR>(*Char)); break;
+			}
+			Run = Char + 1;
+		}
+		JsonStreamReader_Private::AppendRun(Out, Run, StringEnd);
+		return true;
+	}
+
+	static bool ReadHex4(const CharType* Begin, const CharType* StringEnd, uint32& Out)
+	{
+		if (StringEnd - Begin < 4) return false;
+		Out = 0;
+		for (int32 Index = 0; Index < 4; ++Index)
+		{
+			const CharType Char = Begin[Index];
+			uint32 Digit;
+			if (Char >= '0' && Char <= '9') Digit = Char - '0';
+			else if (Char >= 'a' && Char <= 'f') Digit = Char - 'a' + 10;
+			else if (Char >= 'A' && Char <= 'F') Digit = Char - 'A' + 10;
+			else return false;
+			Out = (Out << 4) | Digit;
+		}
+		return true;
+	}
+
+	bool ReadField(const FStructPlanField& Field, void* Value)
+	{
+		if (Field.Property->ArrayDim == 1)
+		{
+			return ReadFieldValue(Field, Value);
+		}
+		if (Peek() != '[')
+		{
+			return ReadFallback(Field.Property, Value);
+		}
+
+		int32 Index = 0;
+		return ForEachElement([this, &Field, Value, &Index]()
+		{
+			if (Index >= Field.Property->ArrayDim) return SkipValue();
+			return ReadFieldValue(Field, static_cast<uint8*>(Value) + Field.Property->ElementSize * Index++);
+		});
+	}
+
+	bool ReadFieldValue(const FStructPlanField& Field, void* Value)
+	{
+		const CharType Next = Peek();
+		if (Next == 'n')
+		{
+			// Like JsonObjectToUStruct, null leaves the property untouched
+			return ConsumeLiteral("null");
+		}
+
+		switch (Field.Kind)
+		{
+		case EStructPlanKind::Bool:
+			if (Next == 't' || Next == 'f')
+			{
+				static_cast<FBoolProperty*>(Field.Property)->SetPropertyValue(Value, Next == 't');
+				return ConsumeLiteral(Next == 't' ? "true" : "false");
+			}
+			break;
+		case EStructPlanKind::SignedInt:
+		case EStructPlanKind::UnsignedInt:
+		case EStructPlanKind::Float:
+		case EStructPlanKind::Double:
+			if (Next == '-' || (Next >= '0' && Next <= '9'))
+			{
+				return ReadNumber(Field, Value);
+			}
+			break;
+		case EStructPlanKind::String:
+			if (Next == '"')
+			{
+				return ReadString(*static_cast<FString*>(Value));
+			}
+			break;
+		case EStructPlanKind::Name:
+			if (Next == '"')
+			{
+				FString Name;
+				if (!ReadString(Name)) return false;
+				*static_cast<FName*>(Value) = FName(*Name);
+				return true;
+			}
+			break;
+		case EStructPlanKind::Struct:
+			if (Next == '{')
+			{
+				return ReadStruct(Field.Struct, Value);
+			}
+			break;
+		case EStructPlanKind::Array:
+			if (Next == '[')
+			{
+				FScriptArrayHelper ArrayHelper(static_cast<FArrayProperty*>(Field.Property), Value);
+				ArrayHelper.EmptyValues();
+				return ForEachElement([this, &Field, &ArrayHelper]()
+				{
+					const int32 Index = ArrayHelper.AddValue();
+					return ReadFieldValue(*Field.Element, ArrayHelper.GetRawPtr(Index));
+				});
+			}
+			break;
+		default:
+			break;
+		}
+		return ReadFallback(Field.Property, Value);
+	}
+
+	bool ReadNumber(const FStructPlanField& Field, void* Value)
+	{
+		ANSICHAR Number[64];
+		bool bIsInteger = false;
+		if (!ReadNumberToken(Number, bIsInteger)) return false;
+
+		FNumericProperty* NumericProperty = static_cast<FNumericProperty*>(Field.Property);
+		if (Field.Kind == EStructPlanKind::Float || Field.Kind == EStructPlanKind::Double || !bIsInteger)
+		{
+			const double Double = FCStringAnsi::Atod(Number);
+			if (NumericProperty->IsFloatingPoint())
+			{
+				NumericProperty->SetFloatingPointPropertyValue(Value, Double);
+			}
+			else
+			{
+				NumericProperty->SetIntPropertyValue(Value, static_cast<int64>(Double));
+			}
+		}
+		else if (Field.Kind == EStructPlanKind::UnsignedInt)
+		{
+			NumericProperty->SetIntPropertyValue(Value, FCStringAnsi::Strtoui64(Number, nullptr, 10));
+		}
+		else
+		{
+			NumericProperty->SetIntPropertyValue(Value, FCStringAnsi::Strtoi64(Number, nullptr, 10));
+		}
+		return true;
+	}
+
+	// Decodes one value through FJsonObjectConverter, for everything the fast paths do not cover
+	bool ReadFallback(FProperty* Property, void* Value)
+	{
+		Peek();
+		const CharType* ValueBegin = Cursor;
+		if (!SkipValue()) return false;
+
+		FString Wrapped(TEXT("{\"v\":"));
+		JsonStreamReader_Private::AppendRun(Wrapped, ValueBegin, Cursor);
+		Wrapped.AppendChar(TEXT('}'));
+
+		TSharedPtr<FJsonObject> JsonObject;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Wrapped), JsonObject) || !JsonObject.IsValid())
+		{
+			return false;
+		}
+		// A value the converter rejects is skipped rather than failing the whole message, as JsonObjectToUStruct does
+		FJsonObjectConverter::JsonValueToUProperty(JsonObject->TryGetField(TEXT("v")), Property, Value, 0, 0);
+		return true;
+	}
+};
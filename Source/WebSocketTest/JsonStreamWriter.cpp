@@ -0,0 +1,305 @@
+#include "JsonStreamWriter.h"
+#include "JsonObjectConverter.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include <cstdio>
+
+namespace
+{
+	template <typename... ArgTypes>
+	void AppendFormatted(TArray<ANSICHAR>& Buffer, const ANSICHAR* Format, ArgTypes... Args)
+	{
+		ANSICHAR Scratch[32];
+		const int32 Length = std::snprintf(Scratch, sizeof(Scratch), Format, Args...);
+		Buffer.Append(Scratch, FMath::Clamp<int32>(Length, 0, sizeof(Scratch) - 1));
+	}
+
+	void AppendUtf8(TArray<ANSICHAR>& Buffer, const uint32 CodePoint)
+	{
+		if (CodePoint < 0x80)
+		{
+			Buffer.Add(static_cast<ANSICHAR>(CodePoint));
+		}
+		else if (CodePoint < 0x800)
+		{
+			Buffer.Add(static_cast<ANSICHAR>(0xC0 | (CodePoint >> 6)));
+			Buffer.Add(static_cast<ANSICHAR>(0x80 | (CodePoint & 0x3F)));
+		}
+		else if (CodePoint < 0x10000)
+		{
+			Buffer.Add(static_cast<ANSICHAR>(0xE0 | (CodePoint >> 12)));
+			Buffer.Add(static_cast<ANSICHAR>(0x80 | ((CodePoint >> 6) & 0x3F)));
+			Buffer.Add(static_cast<ANSICHAR>(0x80 | (CodePoint & 0x3F)));
+		}
+		else
+		{
+			Buffer.Add(static_cast<ANSICHAR>(0xF0 | (CodePoint >> 18)));
+			Buffer.Add(static_cast<ANSICHAR>(0x80 | ((CodePoint >> 12) & 0x3F)));
+			Buffer.Add(static_cast<ANSICHAR>(0x80 | ((CodePoint >> 6) & 0x3F)));
+			Buffer.Add(static_cast<ANSICHAR>(0x80 | (CodePoint & 0x3F)));
+		}
+	}
+}
+
+void FJsonStreamWriter::BeginValue()
+{
+	if (NeedsComma)
+	{
+		Buffer.Add(',');
+	}
+	NeedsComma = true;
+}
+
+void FJsonStreamWriter::BeginObject()
+{
+	BeginValue();
+	Buffer.Add('{');
+	NeedsComma = false;
+}
+
+void FJsonStreamWriter::EndObject()
+{
+	Buffer.Add('}');
+	NeedsComma = true;
+}
+
+void FJsonStreamWriter::BeginArray()
+{
+	BeginValue();
+	Buffer.Add('[');
+	NeedsComma = false;
+}
+
+void FJsonStreamWriter::EndArray()
+{
+	Buffer.Add(']');
+	NeedsComma = true;
+}
+
+void FJsonStreamWriter::WriteKey(const ANSICHAR* Key)
+{
+	BeginValue();
+	Buffer.Add('"');
+	Buffer.Append(Key, FCStringAnsi::Strlen(Key));
+	Buffer.Add('"');
+	Buffer.Add(':');
+	NeedsComma = false;
+}
+
+void FJsonStreamWriter::WriteEncodedKey(const TArray<ANSICHAR>& Utf8Key)
+{
+	BeginValue();
+	Buffer.Append(Utf8Key);
+	Buffer.Add(':');
+	NeedsComma = false;
+}
+
+void FJsonStreamWriter::WriteNull()
+{
+	BeginValue();
+	Buffer.Append("null", 4);
+}
+
+void FJsonStreamWriter::WriteBool(const bool Value)
+{
+	BeginValue();
+	if (Value)
+	{
+		Buffer.Append("true", 4);
+	}
+	else
+	{
+		Buffer.Append("false", 5);
+	}
+}
+
+void FJsonStreamWriter::WriteInt(const int64 Value)
+{
+	BeginValue();
+	AppendFormatted(Buffer, "%lld", static_cast<long long>(Value));
+}
+
+void FJsonStreamWriter::WriteUInt(const uint64 Value)
+{
+	BeginValue();
+	AppendFormatted(Buffer, "%llu", static_cast<unsigned long long>(Value));
+}
+
+void FJsonStreamWriter::WriteFloat(const float Value)
+{
+	if (!FMath::IsFinite(Value))
+	{
+		WriteNull();
+		return;
+	}
+	BeginValue();
+	// 9 significant digits round-trip any float
+	AppendFormatted(Buffer, "%.9g", static_cast<double>(Value));
+}
+
+void FJsonStreamWriter::WriteDouble(const double Value)
+{
+	if (!FMath::IsFinite(Value))
+	{
+		WriteNull();
+		return;
+	}
+	BeginValue();
+	AppendFormatted(Buffer, "%.17g", Value);
+}
+
+void FJsonStreamWriter::WriteString(const FString& Value)
+{
+	BeginValue();
+	Buffer.Add('"');
+
+	const TCHAR* Chars = *Value;
+	const int32 Length = Value.Len();
+	for (int32 Index = 0; Index < Length; ++Index)
+	{
+		uint32 Char = static_cast<uint32>(Chars[Index]);
+		switch (Char)
+		{
+		case '"': Buffer.Append("\\\"", 2); continue;
+		case '\\': Buffer.Append("\\\\", 2); continue;
+		case '\b': Buffer.Append("\\b", 2); continue;
+		case '\f': Buffer.Append("\\f", 2); continue;
+		case '\n': Buffer.Append("\\n", 2); continue;
+		case '\r': Buffer.Append("\\r", 2); continue;
+		case '\t': Buffer.Append("\\t", 2); continue;
+		default: break;
+		}
+
+		if (Char < 0x20)
+		{
+			AppendFormatted(Buffer, "\\u%04x", Char);
+			continue;
+		}
+
+		// Join UTF-16 surrogate pairs; a lone surrogate is not encodable and becomes U+FFFD
+		if (Char >= 0xD800 && Char <= 0xDFFF)
+		{
+			const uint32 Low = Index + 1 < Length ? static_cast<uint32>(Chars[Index + 1]) : 0;
+			if (Char <= 0xDBFF && Low >= 0xDC00 && Low <= 0xDFFF)
+			{
+				Char = 0x10000 + ((Char - 0xD800) << 10) + (Low - 0xDC00);
+				++Index;
+			}
+			else
+			{
+				Char = 0xFFFD;
+			}
+		}
+		AppendUtf8(Buffer, Char);
+	}
+
+	Buffer.Add('"');
+}
+
+void FJsonStreamWriter::WriteRawValue(const ANSICHAR* Json, const int32 Length)
+{
+	BeginValue();
+	Buffer.Append(Json, Length);
+}
+
+void FJsonStreamWriter::WriteStruct(const UScriptStruct* Struct, const void* Data)
+{
+	BeginObject();
+	for (const FStructPlanField& Field : FStructPlan::Get(Struct).Fields)
+	{
+		WriteEncodedKey(Field.Utf8Key);
+		WriteField(Field, Field.Property->ContainerPtrToValuePtr<void>(Data));
+	}
+	EndObject();
+}
+
+void FJsonStreamWriter::WriteField(const FStructPlanField& Field, const void* Value)
+{
+	if (Field.Property->ArrayDim == 1)
+	{
+		WriteFieldValue(Field, Value);
+		return;
+	}
+
+	// Static arrays are written as JSON arrays, as FJsonObjectConverter does
+	BeginArray();
+	for (int32 Index = 0; Index < Field.Property->ArrayDim; ++Index)
+	{
+		WriteFieldValue(Field, static_cast<const uint8*>(Value) + Index * Field.Property->ElementSize);
+	}
+	EndArray();
+}
+
+void FJsonStreamWriter::WriteFieldValue(const FStructPlanField& Field, const void* Value)
+{
+	switch (Field.Kind)
+	{
+	case EStructPlanKind::Bool:
+		WriteBool(static_cast<const FBoolProperty*>(Field.Property)->GetPropertyValue(Value));
+		break;
+	case EStructPlanKind::SignedInt:
+		WriteInt(static_cast<const FNumericProperty*>(Field.Property)->GetSignedIntPropertyValue(Value));
+		break;
+	case EStructPlanKind::UnsignedInt:
+		WriteUInt(static_cast<const FNumericProperty*>(Field.Property)->GetUnsignedIntPropertyValue(Value));
+		break;
+	case EStructPlanKind::Float:
+		WriteFloat(static_cast<float>(static_cast<const FNumericProperty*>(Field.Property)->GetFloatingPointPropertyValue(Value)));
+		break;
+	case EStructPlanKind::Double:
+		WriteDouble(static_cast<const FNumericProperty*>(Field.Property)->GetFloatingPointPropertyValue(Value));
+		break;
+	case EStructPlanKind::String:
+		WriteString(*static_cast<const FString*>(Value));
+		break;
+	case EStructPlanKind::Name:
+		WriteString(static_cast<const FName*>(Value)->ToString());
+		break;
+	case EStructPlanKind::Text:
+		WriteString(static_cast<const FText*>(Value)->ToString());
+		break;
+	case EStructPlanKind::Enum:
+	{
+		const FEnumProperty* EnumProperty = CastField<FEnumProperty>(Field.Property);
+		const FNumericProperty* NumericProperty = EnumProperty
+			? EnumProperty->GetUnderlyingProperty()
+			: static_cast<const FNumericProperty*>(Field.Property);
+		WriteString(Field.Enum->GetNameStringByValue(NumericProperty->GetSignedIntPropertyValue(Value)));
+		break;
+	}
+	case EStructPlanKind::Struct:
+		WriteStruct(Field.Struct, Value);
+		break;
+	case EStructPlanKind::Array:
+	{
+		FScriptArrayHelper ArrayHelper(static_cast<const FArrayProperty*>(Field.Property), Value);
+		BeginArray();
+		for (int32 Index = 0; Index < ArrayHelper.Num(); ++Index)
+		{
+			WriteFieldValue(*Field.Element, ArrayHelper.GetRawPtr(Index));
+		}
+		EndArray();
+		break;
+	}
+	case EStructPlanKind::Fallback:
+	default:
+		WriteFallback(Field.Property, Value);
+		break;
+	}
+}
+
+void FJsonStreamWriter::WriteFallback(FProperty* Property, const void* Value)
+{
+	const TSharedPtr<FJsonValue> JsonValue = FJsonObjectConverter::UPropertyToJsonValue(Property, Value, 0, 0);
+	if (!JsonValue.IsValid())
+	{
+		WriteNull();
+		return;
+	}
+
+	FString Json;
+	const auto Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+	FJsonSerializer::Serialize(JsonValue, FString(), Writer);
+	const FTCHARToUTF8 Utf8Json(*Json);
+	WriteRawValue(Utf8Json.Get(), Utf8Json.Length());
+}
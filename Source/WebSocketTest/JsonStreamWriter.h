@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StructPlan.h"
+
+/**
+ * Writes condensed JSON straight into a caller-owned UTF-8 buffer. Reflected structs are written by walking
+ * their cached FStructPlan, so a request goes from UStruct to wire bytes in one pass with no intermediate
+ * FJsonObject DOM. The buffer is appended to, never reset, so callers can reuse it across messages.
+ */
+class WEBSOCKETTEST_API FJsonStreamWriter
+{
+	public:
+	explicit FJsonStreamWriter(TArray<ANSICHAR>& InBuffer) : Buffer(InBuffer) {}
+
+	void BeginObject();
+	void EndObject();
+	void BeginArray();
+	void EndArray();
+
+	// Key must be plain ASCII with nothing to escape, e.g. an envelope field name
+	void WriteKey(const ANSICHAR* Key);
+
+	// Key already encoded as a quoted UTF-8 JSON string
+	void WriteEncodedKey(const TArray<ANSICHAR>& Utf8Key);
+
+	void WriteNull();
+	void WriteBool(bool Value);
+	void WriteInt(int64 Value);
+	void WriteUInt(uint64 Value);
+	void WriteFloat(float Value);
+	void WriteDouble(double Value);
+	void WriteString(const FString& Value);
+
+	// Writes already-encoded JSON as the next value
+	void WriteRawValue(const ANSICHAR* Json, int32 Length);
+
+	void WriteStruct(const UScriptStruct* Struct, const void* Data);
+
+	template <typename TStruct>
+	void WriteStruct(const TStruct& Data)
+	{
+		WriteStruct(TStruct::StaticStruct(), &Data);
+	}
+
+	private:
+	TArray<ANSICHAR>& Buffer;
+	bool NeedsComma = false;
+
+	void BeginValue();
+	void WriteField(const FStructPlanField& Field, const void* Value);
+	void WriteFieldValue(const FStructPlanField& Field, const void* Value);
+	void WriteFallback(FProperty* Property, const void* Value);
+};
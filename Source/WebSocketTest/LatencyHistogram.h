@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Lock-free latency histogram in the style of HdrHistogram. Values are microseconds; each power of two is split into
+ * SubBuckets linear buckets, so any percentile is reported within 1/SubBuckets (about 6%) of the true value at a
+ * fixed size of NumBuckets counters, whatever the range recorded.
+ *
+ * Record is a few relaxed atomic adds and may be called from any thread. Reads are not a consistent snapshot of
+ * concurrent records, which is fine for monitoring.
+ */
+class FLatencyHistogram
+{
+	public:
+	static constexpr int32 SubBucketBits = 4;
+	static constexpr int32 SubBuckets = 1 << SubBucketBits;
+	// Values of 2^MaxExponent us (about 12 days) and up all land in the last bucket
+	static constexpr int32 MaxExponent = 40;
+	static constexpr int32 NumBuckets = (MaxExponent - SubBucketBits + 1) * SubBuckets;
+
+	void Record(const uint64 ValueUs)
+	{
+		Buckets[GetBucket(ValueUs)].fetch_add(1, std::memory_order_relaxed);
+		Count.fetch_add(1, std::memory_order_relaxed);
+		Sum.fetch_add(ValueUs, std::memory_order_relaxed);
+
+		uint64 Current = Max.load(std::memory_order_relaxed);
+		while (ValueUs > Current && !Max.compare_exchange_weak(Current, ValueUs, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	uint64 GetCount() const
+	{
+		return Count.load(std::memory_order_relaxed);
+	}
+
+	uint64 GetMax() const
+	{
+		return Max.load(std::memory_order_relaxed);
+	}
+
+	double GetMean() const
+	{
+		const uint64 N = GetCount();
+		return N > 0 ? static_cast<double>(Sum.load(std::memory_order_relaxed)) / N : 0.0;
+	}
+
+	// Upper bound of the bucket holding the given percentile (0-100), capped at the largest value recorded
+	uint64 GetPercentile(const double Percentile) const
+	{
+		const uint64 N = GetCount();
+		if (N == 0) return 0;
+
+		const uint64 Target = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(Percentile / 100.0 * N)));
+		uint64 Seen = 0;
+		for (int32 Index = 0; Index < NumBuckets; ++Index)
+		{
+			Seen += Buckets[Index].load(std::memory_order_relaxed);
+			if (Seen >= Target)
+			{
+				return FMath::Min(GetBucketUpperBound(Index), GetMax());
+			}
+		}
+		return GetMax();
+	}
+
+	private:
+	std::atomic<uint64> Buckets[NumBuckets] = {};
+	std::atomic<uint64> Count{0};
+	std::atomic<uint64> Sum{0};
+	std::atomic<uint64> Max{0};
+
+	static int32 GetBucket(const uint64 Value)
+	{
+		if (Value < SubBuckets) return static_cast<int32>(Value);
+
+		// Values in [SubBuckets << Shift, 2 * SubBuckets << Shift) share buckets 1 << Shift wide
+		const int32 Shift = static_cast<int32>(FPlatformMath::FloorLog2_64(Value)) - SubBucketBits;
+		const int32 Index = (Shift + 1) * SubBuckets + static_cast<int32>((Value >> Shift) - SubBuckets);
+		return FMath::Min(Index, NumBuckets - 1);
+	}
+
+	static uint64 GetBucketUpperBound(const int32 Index)
+	{
+		if (Index < SubBuckets) return Index;
+
+		const int32 Shift = Index / SubBuckets - 1;
+		const uint64 SubBucket = Index % SubBuckets + SubBuckets;
+		return ((SubBucket + 1) << Shift) - 1;
+	}
+};
@@ -0,0 +1,764 @@
+#include "MsgPackStream.h"
+#include "Dom/JsonObject.h"
+#include "JsonObjectConverter.h"
+
+namespace
+{
+	bool IsNumberByte(const uint8 Byte)
+	{
+		return Byte <= 0x7f || Byte >= 0xe0 || (Byte >= 0xca && Byte <= 0xd3);
+	}
+
+	bool IsMapByte(const uint8 Byte)
+	{
+		return (Byte & 0xf0) == 0x80 || Byte == 0xde || Byte == 0xdf;
+	}
+
+	bool IsArrayByte(const uint8 Byte)
+	{
+		return (Byte & 0xf0) == 0x90 || Byte == 0xdc || Byte == 0xdd;
+	}
+}
+
+void FMsgPackWriter::WriteByte(const uint8 Byte)
+{
+	Buffer.Add(static_cast<ANSICHAR>(Byte));
+}
+
+void FMsgPackWriter::WriteBigEndian(const uint64 Value, const int32 Bytes)
+{
+	for (int32 Shift = (Bytes - 1) * 8; Shift >= 0; Shift -= 8)
+	{
+		WriteByte(static_cast<uint8>(Value >> Shift));
+	}
+}
+
+void FMsgPackWriter::WriteMapHeader(const uint32 Count)
+{
+	if (Count < 16)
+	{
+		WriteByte(0x80 | Count);
+	}
+	else if (Count <= 0xffff)
+	{
+		WriteByte(0xde);
+		WriteBigEndian(Count, 2);
+	}
+	else
+	{
+		WriteByte(0xdf);
+		WriteBigEndian(Count, 4);
+	}
+}
+
+void FMsgPackWriter::WriteArrayHeader(const uint32 Count)
+{
+	if (Count < 16)
+	{
+		WriteByte(0x90 | Count);
+	}
+	else if (Count <= 0xffff)
+	{
+		WriteByte(0xdc);
+		WriteBigEndian(Count, 2);
+	}
+	else
+	{
+		WriteByte(0xdd);
+		WriteBigEndian(Count, 4);
+	}
+}
+
+void FMsgPackWriter::WriteNil()
+{
+	WriteByte(0xc0);
+}
+
+void FMsgPackWriter::WriteBool(const bool Value)
+{
+	WriteByte(Value ? 0xc3 : 0xc2);
+}
+
+void FMsgPackWriter::WriteInt(const int64 Value)
+{
+	if (Value >= 0)
+	{
+		WriteUInt(static_cast<uint64>(Value));
+	}
+	else if (Value >= -32)
+	{
+		WriteByte(static_cast<uint8>(Value));
+	}
+	else if (Value >= MIN_int8)
+	{
+		WriteByte(0xd0);
+		WriteBigEndian(static_cast<uint64>(Value), 1);
+	}
+	else if (Value >= MIN_int16)
+	{
+		WriteByte(0xd1);
+		WriteBigEndian(static_cast<uint64>(Value), 2);
+	}
+	else if (Value >= MIN_int32)
+	{
+		WriteByte(0xd2);
+		WriteBigEndian(static_cast<uint64>(Value), 4);
+	}
+	else
+	{
+		WriteByte(0xd3);
+		WriteBigEndian(static_cast<uint64>(Value), 8);
+	}
+}
+
+void FMsgPackWriter::WriteUInt(const uint64 Value)
+{
+	if (Value < 0x80)
+	{
+		WriteByte(static_cast<uint8>(Value));
+	}
+	else if (Value <= MAX_uint8)
+	{
+		WriteByte(0xcc);
+		WriteBigEndian(Value, 1);
+	}
+	else if (Value <= MAX_uint16)
+	{
+		WriteByte(0xcd);
+		WriteBigEndian(Value, 2);
+	}
+	else if (Value <= MAX_uint32)
+	{
+		WriteByte(0xce);
+		WriteBigEndian(Value, 4);
+	}
+	else
+	{
+		WriteByte(0xcf);
+		WriteBigEndian(Value, 8);
+	}
+}
+
+void FMsgPackWriter::WriteFloat(const float Value)
+{
+	uint32 Bits;
+	FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+	WriteByte(0xca);
+	WriteBigEndian(Bits, 4);
+}
+
+void FMsgPackWriter::WriteDouble(const double Value)
+{
+	uint64 Bits;
+	FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+	WriteByte(0xcb);
+	WriteBigEndian(Bits, 8);
+}
+
+void FMsgPackWriter::WriteString(const FString& Value)
+{
+	const FTCHARToUTF8 Utf8(*Value);
+	WriteString(Utf8.Get(), Utf8.Length());
+}
+
+void FMsgPackWriter::WriteString(const ANSICHAR* Utf8, const int32 Length)
+{
+	if (Length < 32)
+	{
+		WriteByte(0xa0 | Length);
+	}
+	else if (Length <= MAX_uint8)
+	{
+		WriteByte(0xd9);
+		WriteBigEndian(Length, 1);
+	}
+	else if (Length <= MAX_uint16)
+	{
+		WriteByte(0xda);
+		WriteBigEndian(Length, 2);
+	}
+	else
+	{
+		WriteByte(0xdb);
+		WriteBigEndian(Length, 4);
+	}
+	Buffer.Append(Utf8, Length);
+}
+
+void FMsgPackWriter::WriteJsonValue(const TSharedPtr<FJsonValue>& Value)
+{
+	if (!Value.IsValid())
+	{
+		WriteNil();
+		return;
+	}
+
+	switch (Value->Type)
+	{
+	case EJson::Boolean:
+		WriteBool(Value->AsBool());
+		break;
+	case EJson::Number:
+	{
+		const double Number = Value->AsNumber();
+		if (FMath::FloorToDouble(Number) == Number && FMath::Abs(Number) < 9007199254740992.0)
+		{
+			WriteInt(static_cast<int64>(Number));
+		}
+		else
+		{
+			WriteDouble(Number);
+		}
+		break;
+	}
+	case EJson::String:
+		WriteString(Value->AsString());
+		break;
+	case EJson::Array:
+	{
+		const TArray<TSharedPtr<FJsonValue>>& Values = Value->AsArray();
+		WriteArrayHeader(Values.Num());
+		for (const TSharedPtr<FJsonValue>& Element : Values)
+		{
+			WriteJsonValue(Element);
+		}
+		break;
+	}
+	case EJson::Object:
+	{
+		const TSharedPtr<FJsonObject>& Object = Value->AsObject();
+		WriteMapHeader(Object->Values.Num());
+		for (const auto& Pair : Object->Values)
+		{
+			WriteString(Pair.Key);
+			WriteJsonValue(Pair.Value);
+		}
+		break;
+	}
+	default:
+		WriteNil();
+		break;
+	}
+}
+
+void FMsgPackWriter::WriteStruct(const UScriptStruct* Struct, const void* Data)
+{
+	const FStructPlan& Plan = FStructPlan::Get(Struct);
+	WriteMapHeader(Plan.Fields.Num());
+	for (const FStructPlanField& Field : Plan.Fields)
+	{
+		// Utf8Key is quoted for the JSON writer; MessagePack wants the bare name
+		WriteString(Field.Utf8Key.GetData() + 1, Field.Utf8Key.Num() - 2);
+		WriteField(Field, Field.Property->ContainerPtrToValuePtr<void>(Data));
+	}
+}
+
+void FMsgPackWriter::WriteField(const FStructPlanField& Field, const void* Value)
+{
+	if (Field.Property->ArrayDim == 1)
+	{
+		WriteFieldValue(Field, Value);
+		return;
+	}
+
+	WriteArrayHeader(Field.Property->ArrayDim);
+	for (int32 Index = 0; Index < Field.Property->ArrayDim; ++Index)
+	{
+		WriteFieldValue(Field, static_cast<const uint8*>(Value) + Index * Field.Property->ElementSize);
+	}
+}
+
+void FMsgPackWriter::WriteFieldValue(const FStructPlanField& Field, const void* Value)
+{
+	switch (Field.Kind)
+	{
+	case EStructPlanKind::Bool:
+		WriteBool(static_cast<const FBoolProperty*>(Field.Property)->GetPropertyValue(Value));
+		break;
+	case EStructPlanKind::SignedInt:
+		WriteInt(static_cast<const FNumericProperty*>(Field.Property)->GetSignedIntPropertyValue(Value));
+		break;
+	case EStructPlanKind::UnsignedInt:
+		WriteUInt(static_cast<const FNumericProperty*>(Field.Property)->GetUnsignedIntPropertyValue(Value));
+		break;
+	case EStructPlanKind::Float:
+		WriteFloat(static_cast<float>(static_cast<const FNumericProperty*>(Field.Property)->GetFloatingPointPropertyValue(Value)));
+		break;
+	case EStructPlanKind::Double:
+		WriteDouble(static_cast<const FNumericProperty*>(Field.Property)->GetFloatingPointPropertyValue(Value));
+		break;
+	case EStructPlanKind::String:
+		WriteString(*static_cast<const FString*>(Value));
+		break;
+	case EStructPlanKind::Name:
+		WriteString(static_cast<const FName*>(Value)->ToString());
+		break;
+	case EStructPlanKind::Text:
+		WriteString(static_cast<const FText*>(Value)->ToString());
+		break;
+	case EStructPlanKind::Enum:
+	{
+		const FEnumProperty* EnumProperty = CastField<FEnumProperty>(Field.Property);
+		const FNumericProperty* NumericProperty = EnumProperty
+			? EnumProperty->GetUnderlyingProperty()
+			: static_cast<const FNumericProperty*>(Field.Property);
+		WriteString(Field.Enum->GetNameStringByValue(NumericProperty->GetSignedIntPropertyValue(Value)));
+		break;
+	}
+	case EStructPlanKind::Struct:
+		WriteStruct(Field.Struct, Value);
+		break;
+	case EStructPlanKind::Array:
+	{
+		FScriptArrayHelper ArrayHelper(static_cast<const FArrayProperty*>(Field.Property), Value);
+		WriteArrayHeader(ArrayHelper.Num());
+		for (int32 Index = 0; Index < ArrayHelper.Num(); ++Index)
+		{
+			WriteFieldValue(*Field.Element, ArrayHelper.GetRawPtr(Index));
+		}
+		break;
+	}
+	case EStructPlanKind::Fallback:
+	default:
+		WriteJsonValue(FJsonObjectConverter::UPropertyToJsonValue(Field.Property, Value, 0, 0));
+		break;
+	}
+}
+
+bool FMsgPackReader::IsString() const
+{
+	if (Cursor >= End) return false;
+	const uint8 Byte = *Cursor;
+	return (Byte >= 0xa0 && Byte <= 0xbf) || (Byte >= 0xd9 && Byte <= 0xdb);
+}
+
+bool FMsgPackReader::IsArray() const
+{
+	return Cursor < End && IsArrayByte(*Cursor);
+}
+
+bool FMsgPackReader::ReadBigEndian(const int32 Bytes, uint64& Out)
+{
+	if (End - Cursor < Bytes) return false;
+	Out = 0;
+	for (int32 Index = 0; Index < Bytes; ++Index)
+	{
+		Out = (Out << 8) | *Cursor++;
+	}
+	return true;
+}
+
+bool FMsgPackReader::ReadMapHeader(uint32& OutCount)
+{
+	if (Cursor >= End) return false;
+	const uint8 Byte = *Cursor++;
+	uint64 Count = 0;
+	if ((Byte & 0xf0) == 0x80) Count = Byte & 0x0f;
+	else if (Byte == 0xde) { if (!ReadBigEndian(2, Count)) return false; }
+	else if (Byte == 0xdf) { if (!ReadBigEndian(4, Count)) return false; }
+	else return false;
+
+	// Every entry takes at least a byte for its key and one for its value, so a count the frame cannot hold is
+	// rejected before anything is sized from it
+	if (static_cast<uint64>(End - Cursor) < Count * 2) return false;
+	OutCount = static_cast<uint32>(Count);
+	return true;
+}
+
+bool FMsgPackReader::ReadArrayHeader(uint32& OutCount)
+{
+	if (Cursor >= End) return false;
+	const uint8 Byte = *Cursor++;
+	uint64 Count = 0;
+	if ((Byte & 0xf0) == 0x90) Count = Byte & 0x0f;
+	else if (Byte == 0xdc) { if (!ReadBigEndian(2, Count)) return false; }
+	else if (Byte == 0xdd) { if (!ReadBigEndian(4, Count)) return false; }
+	else return false;
+
+	// Every element takes at least a byte
+	if (static_cast<uint64>(End - Cursor) < Count) return false;
+	OutCount = static_cast<uint32>(Count);
+	return true;
+}
+
+bool FMsgPackReader::ReadStringSpan(const ANSICHAR*& OutBegin, const ANSICHAR*& OutEnd)
+{
+	if (Cursor >= End) return false;
+	const uint8 Byte = *Cursor++;
+	uint64 Length = 0;
+	if (Byte >= 0xa0 && Byte <= 0xbf) Length = Byte & 0x1f;
+	else if (Byte == 0xd9) { if (!ReadBigEndian(1, Length)) return false; }
+	else if (Byte == 0xda) { if (!ReadBigEndian(2, Length)) return false; }
+	else if (Byte == 0xdb) { if (!ReadBigEndian(4, Length)) return false; }
+	else return false;
+
+	if (static_cast<uint64>(End - Cursor) < Length) return false;
+	OutBegin = reinterpret_cast<const ANSICHAR*>(Cursor);
+	Cursor += Length;
+	OutEnd = reinterpret_cast<const ANSICHAR*>(Cursor);
+	return true;
+}
+
+bool FMsgPackReader::ReadNumber(int64& OutInt, uint64& OutUInt, double& OutDouble, bool& bOutIsFloat, bool& bOutIsNegative)
+{
+	if (Cursor >= End) return false;
+	const uint8 Byte = *Cursor++;
+	bOutIsFloat = false;
+	bOutIsNegative = false;
+	uint64 Bits = 0;
+
+	if (Byte <= 0x7f)
+	{
+		OutUInt = Byte;
+		OutInt = Byte;
+	}
+	else if (Byte >= 0xe0)
+	{
+		OutInt = static_cast<int8>(Byte);
+		bOutIsNegative = true;
+	}
+	else if (Byte >= 0xcc && Byte <= 0xcf)
+	{
+		if (!ReadBigEndian(1 << (Byte - 0xcc), OutUInt)) return false;
+		OutInt = static_cast<int64>(OutUInt);
+	}
+	else if (Byte >= 0xd0 && Byte <= 0xd3)
+	{
+		const int32 Bytes = 1 << (Byte - 0xd0);
+		if (!ReadBigEndian(Bytes, Bits)) return false;
+		// Sign-extend from the encoded width
+		const int32 Shift = 64 - Bytes * 8;
+		OutInt = static_cast<int64>(Bits << Shift) >> Shift;
+		bOutIsNegative = OutInt < 0;
+		OutUInt = static_cast<uint64>(OutInt);
+	}
+	else if (Byte == 0xca)
+	{
+		if (!ReadBigEndian(4, Bits)) return false;
+		const uint32 FloatBits = static_cast<uint32>(Bits);
+		float Float;
+		FMemory::Memcpy(&Float, &FloatBits, sizeof(Float));
+		OutDouble = Float;
+		bOutIsFloat = true;
+		return true;
+	}
+	else if (Byte == 0xcb)
+	{
+		if (!ReadBigEndian(8, Bits)) return false;
+		FMemory::Memcpy(&OutDouble, &Bits, sizeof(OutDouble));
+		bOutIsFloat = true;
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+
+	OutDouble = bOutIsNegative ? static_cast<double>(OutInt) : static_cast<double>(OutUInt);
+	return true;
+}
+
+bool FMsgPackReader::ReadUInt64(uint64& Out)
+{
+	int64 Int = 0;
+	double Double = 0.0;
+	bool bIsFloat = false;
+	bool bIsNegative = false;
+	if (!ReadNumber(Int, Out, Double, bIsFloat, bIsNegative)) return false;
+	if (bIsFloat) Out = static_cast<uint64>(Double);
+	else if (bIsNegative) Out = static_cast<uint64>(Int);
+	return true;
+}
+
+bool FMsgPackReader::ReadString(FString& Out)
+{
+	const ANSICHAR* Begin = nullptr;
+	const ANSICHAR* StringEnd = nullptr;
+	if (!ReadStringSpan(Begin, StringEnd)) return false;
+	const FUTF8ToTCHAR Converted(Begin, static_cast<int32>(StringEnd - Begin));
+	Out.Reset(Converted.Length());
+	Out.AppendChars(Converted.Get(), Converted.Length());
+	return true;
+}
+
+bool FMsgPackReader::SkipValue()
+{
+	if (Cursor >= End) return false;
+	const uint8 Byte = *Cursor;
+	uint64 Length = 0;
+
+	if (IsNumberByte(Byte))
+	{
+		int64 Int;
+		uint64 UInt;
+		double Double;
+		bool bIsFloat;
+		bool bIsNegative;
+		return ReadNumber(Int, UInt, Double, bIsFloat, bIsNegative);
+	}
+	if (Byte == 0xc0 || Byte == 0xc2 || Byte == 0xc3)
+	{
+		++Cursor;
+		return true;
+	}
+	if (IsString())
+	{
+		const ANSICHAR* Begin;
+		const ANSICHAR* StringEnd;
+		return ReadStringSpan(Begin, StringEnd);
+	}
+	if (IsArrayByte(Byte))
+	{
+		uint32 Count = 0;
+		if (!ReadArrayHeader(Count)) return false;
+		for (uint32 Index = 0; Index < Count; ++Index)
+		{
+			if (!SkipValue()) return false;
+		}
+		return true;
+	}
+	if (IsMapByte(Byte))
+	{
+		uint32 Count = 0;
+		if (!ReadMapHeader(Count)) return false;
+		for (uint32 Index = 0; Index < Count * 2; ++Index)
+		{
+			if (!SkipValue()) return false;
+		}
+		return true;
+	}
+
+	++Cursor;
+	if (Byte >= 0xc4 && Byte <= 0xc6)
+	{
+		// bin 8/16/32
+		if (!ReadBigEndian(1 << (Byte - 0xc4), Length)) return false;
+	}
+	else if (Byte >= 0xc7 && Byte <= 0xc9)
+	{
+		// ext 8/16/32, plus the type byte
+		if (!ReadBigEndian(1 << (Byte - 0xc7), Length)) return false;
+		++Length;
+	}
+	else if (Byte >= 0xd4 && Byte <= 0xd8)
+	{
+		// fixext 1/2/4/8/16, plus the type byte
+		Length = (uint64(1) << (Byte - 0xd4)) + 1;
+	}
+	else
+	{
+		return false;
+	}
+
+	if (static_cast<uint64>(End - Cursor) < Length) return false;
+	Cursor += Length;
+	return true;
+}
+
+TSharedPtr<FJsonValue> FMsgPackReader::ReadJsonValue()
+{
+	if (Cursor >= End) return nullptr;
+	const uint8 Byte = *Cursor;
+
+	if (Byte == 0xc0)
+	{
+		++Cursor;
+		return MakeShared<FJsonValueNull>();
+	}
+	if (Byte == 0xc2 || Byte == 0xc3)
+	{
+		++Cursor;
+		return MakeShared<FJsonValueBoolean>(Byte == 0xc3);
+	}
+	if (IsNumberByte(Byte))
+	{
+		int64 Int;
+		uint64 UInt;
+		double Double;
+		bool bIsFloat;
+		bool bIsNegative;
+		if (!ReadNumber(Int, UInt, Double, bIsFloat, bIsNegative)) return nullptr;
+		return MakeShared<FJsonValueNumber>(Double);
+	}
+	if (IsString())
+	{
+		FString String;
+		if (!ReadString(String)) return nullptr;
+		return MakeShared<FJsonValueString>(String);
+	}
+	if (IsArrayByte(Byte))
+	{
+		uint32 Count = 0;
+		if (!ReadArrayHeader(Count)) return nullptr;
+		TArray<TSharedPtr<FJsonValue>> Values;
+		Values.Reserve(Count);
+		for (uint32 Index = 0; Index < Count; ++Index)
+		{
+			TSharedPtr<FJsonValue> Value = ReadJsonValue();
+			if (!Value.IsValid()) return nullptr;
+			Values.Add(Value);
+		}
+		return MakeShared<FJsonValueArray>(Values);
+	}
+	if (IsMapByte(Byte))
+	{
+		const TSharedPtr<FJsonObject> Object = MakeShared<FJsonObject>();
+		const bool bRead = ForEachMember([this, &Object](const ANSICHAR* KeyBegin, const ANSICHAR* KeyEnd)
+		{
+			const FUTF8ToTCHAR Key(KeyBegin, static_cast<int32>(KeyEnd - KeyBegin));
+			TSharedPtr<FJsonValue> Value = ReadJsonValue();
+			if (!Value.IsValid()) return false;
+			Object->SetField(FString(Key.Length(), Key.Get()), Value);
+			return true;
+		});
+		return bRead ? MakeShared<FJsonValueObject>(Object) : nullptr;
+	}
+
+	// Binary and extension values have no JSON equivalent
+	return SkipValue() ? MakeShared<FJsonValueNull>() : nullptr;
+}
+
+bool FMsgPackReader::ReadStruct(const UScriptStruct* Struct, void* Data)
+{
+	const FStructPlan& Plan = FStructPlan::Get(Struct);
+	return ForEachMember([this, &Plan, Data](const ANSICHAR* KeyBegin, const ANSICHAR* KeyEnd)
+	{
+		const int32 KeyLength = static_cast<int32>(KeyEnd - KeyBegin);
+		for (const FStructPlanField& Field : Plan.Fields)
+		{
+			if (Field.MatchesUtf8Key(KeyBegin, KeyLength))
+			{
+				return ReadField(Field, Field.Property->ContainerPtrToValuePtr<void>(Data));
+			}
+		}
+		return SkipValue();
+	});
+}
+
+bool FMsgPackReader::ReadField(const FStructPlanField& Field, void* Value)
+{
+	if (Field.Property->ArrayDim == 1)
+	{
+		return ReadFieldValue(Field, Value);
+	}
+	if (Cursor >= End || !IsArrayByte(*Cursor))
+	{
+		return ReadFallback(Field.Property, Value);
+	}
+
+	uint32 Count = 0;
+	if (!ReadArrayHeader(Count)) return false;
+	for (uint32 Index = 0; Index < Count; ++Index)
+	{
+		const bool bRead = static_cast<int32>(Index) < Field.Property->ArrayDim
+			? ReadFieldValue(Field, static_cast<uint8*>(Value) + Field.Property->ElementSize * Index)
+			: SkipValue();
+		if (!bRead) return false;
+	}
+	return true;
+}
+
+bool FMsgPackReader::ReadFieldValue(const FStructPlanField& Field, void* Value)
+{
+	if (Cursor >= End) return false;
+	const uint8 Byte = *Cursor;
+	if (Byte == 0xc0)
+	{
+		// Like JsonObjectToUStruct, nil leaves the property untouched
+		++Cursor;
+		return true;
+	}
+
+	switch (Field.Kind)
+	{
+	case EStructPlanKind::Bool:
+		if (Byte == 0xc2 || Byte == 0xc3)
+		{
+			++Cursor;
+			static_cast<FBoolProperty*>(Field.Property)->SetPropertyValue(Value, Byte == 0xc3);
+			return true;
+		}
+		break;
+	case EStructPlanKind::SignedInt:
+	case EStructPlanKind::UnsignedInt:
+	case EStructPlanKind::Float:
+	case EStructPlanKind::Double:
+		if (IsNumberByte(Byte))
+		{
+			int64 Int = 0;
+			uint64 UInt = 0;
+			double Double = 0.0;
+			bool bIsFloat = false;
+			bool bIsNegative = false;
+			if (!ReadNumber(Int, UInt, Double, bIsFloat, bIsNegative)) return false;
+
+			FNumericProperty* NumericProperty = static_cast<FNumericProperty*>(Field.Property);
+			if (NumericProperty->IsFloatingPoint())
+			{
+				NumericProperty->SetFloatingPointPropertyValue(Value, Double);
+			}
+			else if (bIsFloat)
+			{
+				NumericProperty->SetIntPropertyValue(Value, static_cast<int64>(Double));
+			}
+			else if (bIsNegative)
+			{
+				NumericProperty->SetIntPropertyValue(Value, Int);
+			}
+			else
+			{
+				NumericProperty->SetIntPropertyValue(Value, UInt);
+			}
+			return true;
+		}
+		break;
+	case EStructPlanKind::String:
+		if (IsString())
+		{
+			return ReadString(*static_cast<FString*>(Value));
+		}
+		break;
+	case EStructPlanKind::Name:
+		if (IsString())
+		{
+			FString Name;
+			if (!ReadString(Name)) return false;
+			*static_cast<FName*>(Value) = FName(*Name);
+			return true;
+		}
+		break;
+	case EStructPlanKind::Struct:
+		if (IsMapByte(Byte))
+		{
+			return ReadStruct(Field.Struct, Value);
+		}
+		break;
+	case EStructPlanKind::Array:
+		if (IsArrayByte(Byte))
+		{
+			uint32 Count = 0;
+			if (!ReadArrayHeader(Count)) return false;
+			FScriptArrayHelper ArrayHelper(static_cast<FArrayProperty*>(Field.Property), Value);
+			ArrayHelper.EmptyValues(Count);
+			for (uint32 Index = 0; Index < Count; ++Index)
+			{
+				const int32 ElementIndex = ArrayHelper.AddValue();
+				if (!ReadFieldValue(*Field.Element, ArrayHelper.GetRawPtr(ElementIndex))) return false;
+			}
+			return true;
+		}
+		break;
+	default:
+		break;
+	}
+	return ReadFallback(Field.Property, Value);
+}
+
+bool FMsgPackReader::ReadFallback(FProperty* Property, void* Value)
+{
+	const TSharedPtr<FJsonValue> JsonValue = ReadJsonValue();
+	if (!JsonValue.IsValid()) return false;
+	// A value the converter rejects is skipped rather than failing the whole message, as JsonObjectToUStruct does
+	FJsonObjectConverter::JsonValueToUProperty(JsonValue, Property, Value, 0, 0);
+	return true;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonValue.h"
+#include "StructPlan.h"
+
+/**
+ * Writes MessagePack into a caller-owned byte buffer. Structs are written as maps keyed by the same names the
+ * JSON writer uses, walking their cached FStructPlan, so both codecs carry identical envelopes and payloads.
+ */
+class WEBSOCKETTEST_API FMsgPackWriter
+{
+	public:
+	explicit FMsgPackWriter(TArray<ANSICHAR>& InBuffer) : Buffer(InBuffer) {}
+
+	void WriteMapHeader(uint32 Count);
+	void WriteArrayHeader(uint32 Count);
+	void WriteNil();
+	void WriteBool(bool Value);
+	void WriteInt(int64 Value);
+	void WriteUInt(uint64 Value);
+	void WriteFloat(float Value);
+	void WriteDouble(double Value);
+	void WriteString(const FString& Value);
+	void WriteString(const ANSICHAR* Utf8, int32 Length);
+	void WriteJsonValue(const TSharedPtr<FJsonValue>& Value);
+	void WriteStruct(const UScriptStruct* Struct, const void* Data);
+
+	template <typename TStruct>
+	void WriteStruct(const TStruct& Data)
+	{
+		WriteStruct(TStruct::StaticStruct(), &Data);
+	}
+
+	private:
+	TArray<ANSICHAR>& Buffer;
+
+	void WriteByte(uint8 Byte);
+	void WriteBigEndian(uint64 Value, int32 Bytes);
+	void WriteField(const FStructPlanField& Field, const void* Value);
+	void WriteFieldValue(const FStructPlanField& Field, const void* Value);
+};
+
+/**
+ * Pull parser over a MessagePack byte span that decodes straight into reflected structs, mirroring
+ * TJsonStreamReader: unknown keys are skipped, and values that do not fit their property's fast path are
+ * converted through FJsonObjectConverter.
+ */
+class WEBSOCKETTEST_API FMsgPackReader
+{
+	public:
+	FMsgPackReader(const ANSICHAR* InBegin, const ANSICHAR* InEnd)
+		: Cursor(reinterpret_cast<const uint8*>(InBegin)), End(reinterpret_cast<const uint8*>(InEnd)) {}
+
+	bool ReadStruct(const UScriptStruct* Struct, void* Data);
+
+	/**
+	 * Visits each member of the map at the cursor. Visit receives the UTF-8 key span and must consume the
+	 * member's value; members with non-string keys are skipped.
+	 */
+	template <typename FuncType>
+	bool ForEachMember(FuncType&& Visit)
+	{
+		uint32 Count = 0;
+		if (!ReadMapHeader(Count)) return false;
+		for (uint32 Index = 0; Index < Count; ++Index)
+		{
+			const ANSICHAR* KeyBegin = nullptr;
+			const ANSICHAR* KeyEnd = nullptr;
+			if (IsString())
+			{
+				if (!ReadStringSpan(KeyBegin, KeyEnd) || !Visit(KeyBegin, KeyEnd)) return false;
+			}
+			else if (!SkipValue() || !SkipValue())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Visits each element of the array at the cursor; Visit must consume the element
+	template <typename FuncType>
+	bool ForEachElement(FuncType&& Visit)
+	{
+		uint32 Count = 0;
+		if (!ReadArrayHeader(Count)) return false;
+		for (uint32 Index = 0; Index < Count; ++Index)
+		{
+			if (!Visit()) return false;
+		}
+		return true;
+	}
+
+	bool IsArray() const;
+
+	const ANSICHAR* GetCursor() const
+	{
+		return reinterpret_cast<const ANSICHAR*>(Cursor);
+	}
+
+	bool ReadUInt64(uint64& Out);
+	bool ReadString(FString& Out);
+	bool SkipValue();
+
+	// Reads any value into the JSON DOM, for values handed to FJsonObjectConverter
+	TSharedPtr<FJsonValue> ReadJsonValue();
+
+	private:
+	const uint8* Cursor;
+	const uint8* End;
+
+	bool IsString() const;
+	bool ReadBigEndian(int32 Bytes, uint64& Out);
+	bool ReadMapHeader(uint32& OutCount);
+	bool ReadArrayHeader(uint32& OutCount);
+	bool ReadStringSpan(const ANSICHAR*& OutBegin, const ANSICHAR*& OutEnd);
+	bool ReadNumber(int64& OutInt, uint64& OutUInt, double& OutDouble, bool& bOutIsFloat, bool& bOutIsNegative);
+	bool ReadField(const FStructPlanField& Field, void* Value);
+	bool ReadFieldValue(const FStructPlanField& Field, void* Value);
+	bool ReadFallback(FProperty* Property, void* Value);
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Containers/ContainerAllocationPolicies.h"
+#include <atomic>
+
+enum class EPendingRequestState : uint8
+{
+	Free,
+	Reserved,
+	Pending,
+	Completed,
+	TimedOut,
+	Cancelled
+};
+
+// What the release handler is told about a request as it resolves
+struct FPendingRequestRelease
+{
+	uint64 Id = 0;
+	int32 Channel = 0;
+	int32 Category = 0;
+	EPendingRequestState State = EPendingRequestState::Completed;
+	// Seconds from Add to resolution
+	double Elapsed = 0.0;
+};
+
+/**
+ * Receives the result of a request added without a future. The caller owns it, keeps it alive until Complete is
+ * called and may then reuse it for its next request. Complete runs on whichever thread resolves the request.
+ */
+template <typename ResultType>
+class TPendingRequestCompletion
+{
+	public:
+	virtual ~TPendingRequestCompletion() = default;
+
+	virtual void Complete(const ResultType& Result) = 0;
+};
+
+/**
+ * Fixed-capacity table of in-flight requests, indexed by id % capacity.
+ *
+ * Ids increase monotonically, so a slot only collides with the request issued Capacity ids earlier. Each slot
+ * carries a tag packing the owning id with its state; every transition is a CAS on that tag, so a stale completion
+ * or timeout for a recycled slot fails instead of resolving the wrong request. Whoever moves a slot out of Pending
+ * owns it, completes it and hands the slot back as Free. No locks are taken and the table itself never allocates
+ * after construction. A request added with a future allocates the promise's shared state; one added with a
+ * TPendingRequestCompletion allocates nothing.
+ */
+template <typename ResultType>
+class TPendingRequestTable
+{
+	public:
+	// The low bits of a tag hold the state, leaving 61 bits of id
+	static constexpr uint32 StateBits = 3;
+	static constexpr uint64 MaxId = (uint64(1) << (64 - StateBits)) - 1;
+
+	explicit TPendingRequestTable(const uint32 InCapacity)
+		: Capacity(FMath::Max<uint32>(InCapacity, 1))
+	{
+		Slots.SetNum(Capacity);
+	}
+
+	~TPendingRequestTable()
+	{
+		CancelAll();
+	}
+
+	uint32 GetCapacity() const
+	{
+		return Capacity;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Slots.GetAllocatedSize();
+	}
+
+	/**
+	 * Claims the slot for Id. Fails if the request that last used the slot is still pending, i.e. more than
+	 * Capacity requests are in flight. Channel and Category are handed back to the release handler once the request
+	 * resolves.
+	 */
+	bool Add(const uint64 Id, const double Deadline, TFuture<ResultType>& OutFuture, const int32 Channel = 0, const int32 Category = 0)
+	{
+		FSlot* Slot = Reserve(Id);
+		if (Slot == nullptr) return false;
+
+		Slot->Promise.Emplace();
+		OutFuture = Slot->Promise->GetFuture();
+		Publish(*Slot, Id, Deadline, Channel, Category);
+		return true;
+	}
+
+	// As above, but the request resolves into Completion rather than a future
+	bool Add(const uint64 Id, const double Deadline, TPendingRequestCompletion<ResultType>& Completion, const int32 Channel = 0, const int32 Category = 0)
+	{
+		FSlot* Slot = Reserve(Id);
+		if (Slot == nullptr) return false;
+
+		Slot->Completion = &Completion;
+		Publish(*Slot, Id, Deadline, Channel, Category);
+		return true;
+	}
+
+	/**
+	 * Called for every request as it resolves, however it resolves, with the result it resolves with. Runs before
+	 * the slot is handed back, so keep it short; set it before the first Add.
+	 */
+	void SetReleaseHandler(TFunction<void(const FPendingRequestRelease&, const ResultType&)> InReleaseHandler)
+	{
+		ReleaseHandler = MoveTemp(InReleaseHandler);
+	}
+
+	bool Complete(const uint64 Id, const ResultType& Result)
+	{
+		return Resolve(Id, EPendingRequestState::Completed, Result);
+	}
+
+	bool Expire(const uint64 Id)
+	{
+		return Resolve(Id, EPendingRequestState::TimedOut, ResultType());
+	}
+
+	bool Cancel(const uint64 Id, const ResultType& Result = ResultType())
+	{
+		return Resolve(Id, EPendingRequestState::Cancelled, Result);
+	}
+
+	// Times the request out if it is still pending and its deadline has passed
+	bool ExpireIfDue(const uint64 Id, const double Now)
+	{
+		const FSlot& Slot = GetSlot(Id);
+		return Slot.Tag.load(std::memory_order_acquire) == MakeTag(Id, EPendingRequestState::Pending)
+			&& Slot.Deadline.load(std::memory_order_relaxed) <= Now
+			&& Expire(Id);
+	}
+
+	bool IsPending(const uint64 Id) const
+	{
+		return GetSlot(Id).Tag.load(std::memory_order_acquire) == MakeTag(Id, EPendingRequestState::Pending);
+	}
+
+	// Moves the deadline of a pending request, e.g. to hold it while the connection is down
+	bool SetDeadline(const uint64 Id, const double Deadline)
+	{
+		FSlot& Slot = GetSlot(Id);
+		if (Slot.Tag.load(std::memory_order_acquire) != MakeTag(Id, EPendingRequestState::Pending))
+		{
+			return false;
+		}
+		Slot.Deadline.store(Deadline, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Cancels every pending request, e.g. when the client is torn down, completing each with MakeResult(Id)
+	template <typename FuncType>
+	void CancelAll(FuncType&& MakeResult)
+	{
+		for (uint32 Index = 0; Index < Capacity; ++Index)
+		{
+			const uint64 Tag = Slots[Index].Tag.load(std::memory_order_acquire);
+			if (GetState(Tag) == EPendingRequestState::Pending)
+			{
+				Cancel(GetId(Tag), MakeResult(GetId(Tag)));
+			}
+		}
+	}
+
+	void CancelAll()
+	{
+		CancelAll([](uint64) { return ResultType(); });
+	}
+
+	private:
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FSlot
+	{
+		std::atomic<uint64> Tag{0};
+		std::atomic<double> Deadline{0.0};
+		// One or the other, depending on how the request was added
+		TOptional<TPromise<ResultType>> Promise;
+		TPendingRequestCompletion<ResultType>* Completion = nullptr;
+		int32 Channel = 0;
+		int32 Category = 0;
+		double Added = 0.0;
+	};
+
+	const uint32 Capacity;
+	TArray<FSlot, TAlignedHeapAllocator<PLATFORM_CACHE_LINE_SIZE>> Slots;
+	TFunction<void(const FPendingRequestRelease&, const ResultType&)> ReleaseHandler;
+
+	static uint64 MakeTag(const uint64 Id, const EPendingRequestState State)
+	{
+		return (Id << StateBits) | static_cast<uint64>(State);
+	}
+
+	static uint64 GetId(const uint64 Tag)
+	{
+		return Tag >> StateBits;
+	}
+
+	static EPendingRequestState GetState(const uint64 Tag)
+	{
+		return static_cast<EPendingRequestState>(Tag & ((uint64(1) << StateBits) - 1));
+	}
+
+	FSlot& GetSlot(const uint64 Id)
+	{
+		return Slots[static_cast<int32>(Id % Capacity)];
+	}
+
+	const FSlot& GetSlot(const uint64 Id) const
+	{
+		return Slots[static_cast<int32>(Id % Capacity)];
+	}
+
+	FSlot* Reserve(const uint64 Id)
+	{
+		check(Id <= MaxId);
+		FSlot& Slot = GetSlot(Id);
+		uint64 Tag = Slot.Tag.load(std::memory_order_acquire);
+		if (GetState(Tag) != EPendingRequestState::Free
+			|| !Slot.Tag.compare_exchange_strong(Tag, MakeTag(Id, EPendingRequestState::Reserved), std::memory_order_acq_rel))
+		{
+			return nullptr;
+		}
+		return &Slot;
+	}
+
+	void Publish(FSlot& Slot, const uint64 Id, const double Deadline, const int32 Channel, const int32 Category)
+	{
+		Slot.Deadline.store(Deadline, std::memory_order_relaxed);
+		Slot.Channel = Channel;
+		Slot.Category = Category;
+		Slot.Added = FPlatformTime::Seconds();
+		Slot.Tag.store(MakeTag(Id, EPendingRequestState::Pending), std::memory_order_release);
+	}
+
+	bool Resolve(const uint64 Id, const EPendingRequestState FinalState, const ResultType& Result)
+	{
+		FSlot& Slot = GetSlot(Id);
+		uint64 Expected = MakeTag(Id, EPendingRequestState::Pending);
+		if (!Slot.Tag.compare_exchange_strong(Expected, MakeTag(Id, FinalState), std::memory_order_acq_rel))
+		{
+			return false;
+		}
+
+		// The slot is released before the request is completed since continuations run inline and may send again
+		TOptional<TPromise<ResultType>> Promise = MoveTemp(Slot.Promise);
+		Slot.Promise.Reset();
+		TPendingRequestCompletion<ResultType>* const Completion = Slot.Completion;
+		Slot.Completion = nullptr;
+		if (ReleaseHandler)
+		{
+			FPendingRequestRelease Release;
+			Release.Id = Id;
+			Release.Channel = Slot.Channel;
+			Release.Category = Slot.Category;
+			Release.State = FinalState;
+			Release.Elapsed = FPlatformTime::Seconds() - Slot.Added;
+			ReleaseHandler(Release, Result);
+		}
+		Slot.Tag.store(MakeTag(Id, EPendingRequestState::Free), std::memory_order_release);
+		if (Completion != nullptr)
+		{
+			Completion->Complete(Result);
+		}
+		else
+		{
+			Promise->SetValue(Result);
+		}
+		return true;
+	}
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <mutex>
+
+/**
+ * Lets a caller give up on requests it no longer cares about, e.g. when the UI action that sent them is cancelled.
+ * Copies share one state, so the token handed to SendAsync and the one kept by the caller cancel together.
+ * Cancelling frees the requests' pending slots right away and completes them with a "Cancelled" error.
+ *
+ * A default-constructed token never cancels; use Create for one that can.
+ */
+class FRequestCancellationToken
+{
+	public:
+	static FRequestCancellationToken Create()
+	{
+		FRequestCancellationToken Token;
+		Token.State = MakeShared<FState, ESPMode::ThreadSafe>();
+		return Token;
+	}
+
+	bool IsValid() const
+	{
+		return State.IsValid();
+	}
+
+	bool IsCancelled() const
+	{
+		if (!State.IsValid()) return false;
+		std::unique_lock<std::mutex> Lock(State->Mutex);
+		return State->bCancelled;
+	}
+
+	void Cancel() const
+	{
+		if (!State.IsValid()) return;
+
+		TMap<uint64, TFunction<void()>> Callbacks;
+		{
+			std::unique_lock<std::mutex> Lock(State->Mutex);
+			if (State->bCancelled) return;
+			State->bCancelled = true;
+			Callbacks = MoveTemp(State->Callbacks);
+		}
+		for (const TPair<uint64, TFunction<void()>>& Callback : Callbacks)
+		{
+			Callback.Value();
+		}
+	}
+
+	/**
+	 * Registers Callback to run on Cancel, returning the handle to remove it with. Returns 0, without registering
+	 * it, if the token is already cancelled or can never cancel.
+	 */
+	uint64 OnCancel(TFunction<void()> Callback) const
+	{
+		if (!State.IsValid()) return 0;
+		std::unique_lock<std::mutex> Lock(State->Mutex);
+		if (State->bCancelled) return 0;
+		const uint64 Handle = ++State->NextHandle;
+		State->Callbacks.Add(Handle, MoveTemp(Callback));
+		return Handle;
+	}
+
+	// Removes a callback once whatever it would cancel is done, so a long-lived token does not keep collecting them
+	void RemoveOnCancel(const uint64 Handle) const
+	{
+		if (!State.IsValid() || Handle == 0) return;
+		std::unique_lock<std::mutex> Lock(State->Mutex);
+		State->Callbacks.Remove(Handle);
+	}
+
+	private:
+	struct FState
+	{
+		std::mutex Mutex;
+		bool bCancelled = false;
+		uint64 NextHandle = 0;
+		TMap<uint64, TFunction<void()>> Callbacks;
+	};
+
+	TSharedPtr<FState, ESPMode::ThreadSafe> State;
+};
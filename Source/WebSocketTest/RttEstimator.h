@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <mutex>
+
+struct FWebSocketRttStats
+{
+	// Zero until the first sample
+	double SmoothedRttMs = 0.0;
+	double RttVarianceMs = 0.0;
+	double LastRttMs = 0.0;
+	// Add to local unix time to get the server's
+	double ClockOffsetMs = 0.0;
+	uint64 Samples = 0;
+};
+
+/**
+ * Round trip time of one connection, smoothed the way TCP does it (RFC 6298): SRTT and RTTVAR move by 1/8 and 1/4
+ * of each new sample. The server clock offset is smoothed the same way from the midpoint of each round trip.
+ *
+ * Samples come in on the receive path while any thread may ask for a timeout, hence the lock.
+ */
+class FRttEstimator
+{
+	public:
+	void AddSample(const double RttMs)
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		if (Stats.Samples == 0)
+		{
+			Stats.SmoothedRttMs = RttMs;
+			Stats.RttVarianceMs = RttMs / 2.0;
+		}
+		else
+		{
+			Stats.RttVarianceMs = 0.75 * Stats.RttVarianceMs + 0.25 * FMath::Abs(Stats.SmoothedRttMs - RttMs);
+			Stats.SmoothedRttMs = 0.875 * Stats.SmoothedRttMs + 0.125 * RttMs;
+		}
+		Stats.LastRttMs = RttMs;
+		++Stats.Samples;
+	}
+
+	// SentMs is local unix time when the probe went out, ServerMs the server's when it answered
+	void AddClockSample(const double SentMs, const double RttMs, const double ServerMs)
+	{
+		const double OffsetMs = ServerMs - (SentMs + RttMs / 2.0);
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Stats.ClockOffsetMs = bHasClockOffset ? 0.875 * Stats.ClockOffsetMs + 0.125 * OffsetMs : OffsetMs;
+		bHasClockOffset = true;
+	}
+
+	/**
+	 * A timeout a live server should answer well within: Multiplier round trips, or SRTT + 4 * RTTVAR if the link is
+	 * jittery, and never under MinMs. FallbackMs until there is a sample.
+	 */
+	uint32 GetTimeoutMs(const float Multiplier, const uint32 MinMs, const uint32 FallbackMs) const
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		if (Stats.Samples == 0) return FallbackMs;
+
+		const double TimeoutMs = FMath::Max(Multiplier * Stats.SmoothedRttMs, Stats.SmoothedRttMs + 4.0 * Stats.RttVarianceMs);
+		return FMath::Max(MinMs, static_cast<uint32>(FMath::CeilToDouble(TimeoutMs)));
+	}
+
+	FWebSocketRttStats GetStats() const
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		return Stats;
+	}
+
+	// Forgets the old link's samples, e.g. after failing over to another endpoint
+	void Reset()
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Stats = FWebSocketRttStats();
+		bHasClockOffset = false;
+	}
+
+	private:
+	mutable std::mutex Mutex;
+	FWebSocketRttStats Stats;
+	bool bHasClockOffset = false;
+};
@@ -181,7 +181,7 @@ FReply SClientWidget::OnConnectClicked() const
 
 void SClientWidget::HandleError(const FMgsError& Error) const
 {
-    AsyncTask(ENamedThreads::GameThread, [Error]()
+    Client->RunOnGameThread([Error]()
     {
         FMessageDialog().Debugf(FText::FromString(Error.Message));
     });
@@ -192,20 +192,19 @@ FReply SClientWidget::OnDebugLoginClicked() const
     if (Client->WebSocket && Client->IsConnected())
     {
         const FDebugLoginRequestData DebugLogin{"myToken"};
-        AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, DebugLogin]()
+        Client->SendNonBlocking<FDebugLoginRequestData, FDebugLoginResponseData>(DebugLogin, [this](const TValueOrError<FDebugLoginResponseData, FMgsError>& Login)
         {
-            try
+            if (Login.HasError())
             {
-                const auto Login = Client-> SendAsync<FDebugLoginRequestData, FDebugLoginResponseData>(DebugLogin, true);
-                UE_LOG(LogTemp, Log, TEXT("%s"), *Client-> SendAsync<FDebugLoginRequestData, FDebugLoginResponseData>(DebugLogin, true).Id);
-                AsyncTask(ENamedThreads::GameThread, [Login]()
-                {
-                    FMessageDialog().Debugf(FText::FromString("Logged in: " + Login.Id));
-                });
-            } catch (FMgsError e)
-            {
-                HandleError(e);
+                HandleError(Login.GetError());
+                return;
             }
+            const FString Id = Login.GetValue().Id;
+            UE_LOG(LogTemp, Log, TEXT("%s"), *Id);
+            Client->RunOnGameThread([Id]()
+            {
+                FMessageDialog().Debugf(FText::FromString("Logged in: " + Id));
+            });
         });
     } else
     {
@@ -220,20 +219,19 @@ FReply SClientWidget::OnEchoClicked() const
     if (Client->WebSocket && Client->IsConnected())
     {
         const FEchoRequestData Echo{"Testing...testing...1..2..3.."};
-        AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, Echo]()
+        Client->SendNonBlocking<FEchoRequestData, FEchoResponseData>(Echo, [this](const TValueOrError<FEchoResponseData, FMgsError>& Response)
         {
-            try
+            if (Response.HasError())
             {
-                const auto EchoResponse = Client->SendAsync<FEchoRequestData, FEchoResponseData>(Echo, true).Val;
-                UE_LOG(LogTemp, Log, TEXT("%s"), *EchoResponse);
-                AsyncTask(ENamedThreads::GameThread, [EchoResponse]()
-                {
-                    FMessageDialog().Debugf(FText::FromString(EchoResponse));
-                });
-            } catch (const FMgsError& e)
-            {
-                HandleError(e);
+                HandleError(Response.GetError());
+                return;
             }
+            const FString EchoResponse = Response.GetValue().Val;
+            UE_LOG(LogTemp, Log, TEXT("%s"), *EchoResponse);
+            Client->RunOnGameThread([EchoResponse]()
+            {
+                FMessageDialog().Debugf(FText::FromString(EchoResponse));
+            });
         });
 
     } else
@@ -276,7 +274,7 @@ void SClientWidget::Tick(const FGeometry& AllottedGeometry, const double InCurre
     SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
     if (Client->IsConnected())
     {
-        Client->ProcessPushMessages(1);
+        Client->DispatchPushMessages();
     }
 }
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,111 @@
+#include "StructPlan.h"
+#include "JsonObjectConverter.h"
+#include "Misc/ScopeRWLock.h"
+
+FStructPlan::FStructPlan(const UScriptStruct* Struct)
+{
+	for (TFieldIterator<FProperty> It(Struct); It; ++It)
+	{
+		Fields.Add(MakeField(*It));
+	}
+}
+
+const FStructPlan& FStructPlan::Get(const UScriptStruct* Struct)
+{
+	static FRWLock PlansLock;
+	static TMap<const UScriptStruct*, TUniquePtr<FStructPlan>> Plans;
+
+	{
+		FRWScopeLock Lock(PlansLock, SLT_ReadOnly);
+		if (const TUniquePtr<FStructPlan>* Plan = Plans.Find(Struct))
+		{
+			return **Plan;
+		}
+	}
+
+	// Built outside the lock; if another thread got there first its plan wins and ours is discarded
+	TUniquePtr<FStructPlan> NewPlan(new FStructPlan(Struct));
+	FRWScopeLock Lock(PlansLock, SLT_Write);
+	if (const TUniquePtr<FStructPlan>* Plan = Plans.Find(Struct))
+	{
+		return **Plan;
+	}
+	return *Plans.Add(Struct, MoveTemp(NewPlan));
+}
+
+FStructPlanField FStructPlan::MakeField(FProperty* Property)
+{
+	FStructPlanField Field;
+	Field.Property = Property;
+	Field.Name = FJsonObjectConverter::StandardizeCase(Property->GetName());
+
+	const FTCHARToUTF8 Utf8Name(*Field.Name);
+	Field.Utf8Key.Reserve(Utf8Name.Length() + 2);
+	Field.Utf8Key.Add('"');
+	Field.Utf8Key.Append(Utf8Name.Get(), Utf8Name.Length());
+	Field.Utf8Key.Add('"');
+
+	if (CastField<FBoolProperty>(Property))
+	{
+		Field.Kind = EStructPlanKind::Bool;
+	}
+	else if (const FEnumProperty* EnumProperty = CastField<FEnumProperty>(Property))
+	{
+		Field.Kind = EStructPlanKind::Enum;
+		Field.Enum = EnumProperty->GetEnum();
+	}
+	else if (const FNumericProperty* NumericProperty = CastField<FNumericProperty>(Property))
+	{
+		if (const UEnum* Enum = NumericProperty->GetIntPropertyEnum())
+		{
+			Field.Kind = EStructPlanKind::Enum;
+			Field.Enum = Enum;
+		}
+		else if (CastField<FFloatProperty>(Property))
+		{
+			Field.Kind = EStructPlanKind::Float;
+		}
+		else if (NumericProperty->IsFloatingPoint())
+		{
+			Field.Kind = EStructPlanKind::Double;
+		}
+		else if (CastField<FByteProperty>(Property) || CastField<FUInt16Property>(Property)
+			|| CastField<FUInt32Property>(Property) || CastField<FUInt64Property>(Property))
+		{
+			Field.Kind = EStructPlanKind::UnsignedInt;
+		}
+		else
+		{
+			Field.Kind = EStructPlanKind::SignedInt;
+		}
+	}
+	else if (CastField<FStrProperty>(Property))
+	{
+		Field.Kind = EStructPlanKind::String;
+	}
+	else if (CastField<FNameProperty>(Property))
+	{
+		Field.Kind = EStructPlanKind::Name;
+	}
+	else if (CastField<FTextProperty>(Property))
+	{
+		Field.Kind = EStructPlanKind::Text;
+	}
+	else if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+	{
+		// FJsonObjectConverter exports structs with ExportTextItem as strings, so leave those to it
+		const UScriptStruct::ICppStructOps* StructOps = StructProperty->Struct->GetCppStructOps();
+		if (!StructOps || !StructOps->HasExportTextItem())
+		{
+			Field.Kind = EStructPlanKind::Struct;
+			Field.Struct = StructProperty->Struct;
+		}
+	}
+	else if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+	{
+		Field.Kind = EStructPlanKind::Array;
+		Field.Element = MakeUnique<FStructPlanField>(MakeField(ArrayProperty->Inner));
+	}
+
+	return Field;
+}
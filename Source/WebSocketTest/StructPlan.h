@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Class.h"
+#include "UObject/UnrealType.h"
+
+enum class EStructPlanKind : uint8
+{
+	Bool,
+	SignedInt,
+	UnsignedInt,
+	Float,
+	Double,
+	String,
+	Name,
+	Text,
+	Enum,
+	Struct,
+	Array,
+	// Anything else (maps, sets, object references, structs with custom text export) goes through FJsonObjectConverter
+	Fallback
+};
+
+/**
+ * How to visit one reflected property. Element describes the inner property of arrays, whose values are
+ * addressed directly rather than through a container.
+ */
+struct FStructPlanField
+{
+	FProperty* Property = nullptr;
+	EStructPlanKind Kind = EStructPlanKind::Fallback;
+
+	// Key as FJsonObjectConverter names it, plus the same key pre-encoded as a quoted UTF-8 JSON string
+	FString Name;
+	TArray<ANSICHAR> Utf8Key;
+
+	// For Struct kind
+	const UScriptStruct* Struct = nullptr;
+
+	// For Enum kind
+	const UEnum* Enum = nullptr;
+
+	// For Array kind
+	TUniquePtr<FStructPlanField> Element;
+
+	// Matches an unquoted UTF-8 key the way JsonObjectToUStruct matches names, i.e. ignoring case
+	bool MatchesUtf8Key(const ANSICHAR* Key, const int32 Length) const
+	{
+		// Property names are identifiers, so ASCII case folding is enough
+		return Length == Utf8Key.Num() - 2 && FCStringAnsi::Strnicmp(Key, Utf8Key.GetData() + 1, Length) == 0;
+	}
+};
+
+/**
+ * The property-visit plan for a UScriptStruct: its properties pre-classified by kind with their wire keys
+ * pre-encoded. Plans are built once per struct and cached, so serializers never re-walk reflection data or
+ * re-derive key names on the hot path.
+ */
+class WEBSOCKETTEST_API FStructPlan
+{
+	public:
+	TArray<FStructPlanField> Fields;
+
+	static const FStructPlan& Get(const UScriptStruct* Struct);
+
+	// Classifies a single property; used for top-level fields and array elements alike
+	static FStructPlanField MakeField(FProperty* Property);
+
+	private:
+	explicit FStructPlan(const UScriptStruct* Struct);
+};
@@ -0,0 +1,147 @@
+#include "AllocationCounter.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTLS.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/**
+	 * Forwards to the allocator it wraps, adding each allocation to the count the calling thread has running, if
+	 * any. The count is found through a TLS slot, so threads never touch each other's counts.
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+		public:
+		explicit FCountingMalloc(FMalloc* InInner)
+			: Inner(InInner), TlsSlot(FPlatformTLS::AllocTlsSlot())
+		{
+		}
+
+		void SetCount(FAllocationCount* Count) const
+		{
+			FPlatformTLS::SetTlsValue(TlsSlot, Count);
+		}
+
+		virtual void* Malloc(const SIZE_T Count, const uint32 Alignment) override
+		{
+			CountAllocation(Count);
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, const SIZE_T Count, const uint32 Alignment) override
+		{
+			// Growing a buffer costs as much as allocating one
+			if (Count > 0)
+			{
+				CountAllocation(Count);
+			}
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override
+		{
+			Inner->Free(Original);
+		}
+
+		virtual SIZE_T QuantizeSize(const SIZE_T Count, const uint32 Alignment) override
+		{
+			return Inner->QuantizeSize(Count, Alignment);
+		}
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+		{
+			return Inner->GetAllocationSize(Original, SizeOut);
+		}
+
+		virtual void Trim(const bool bTrimThreadCaches) override
+		{
+			Inner->Trim(bTrimThreadCaches);
+		}
+
+		virtual void SetupTLSCachesOnCurrentThread() override
+		{
+			Inner->SetupTLSCachesOnCurrentThread();
+		}
+
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+		{
+			Inner->ClearAndDisableTLSCachesOnCurrentThread();
+		}
+
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return Inner->IsInternallyThreadSafe();
+		}
+
+		virtual bool ValidateHeap() override
+		{
+			return Inner->ValidateHeap();
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return Inner->GetDescriptiveName();
+		}
+
+		private:
+		FMalloc* const Inner;
+		const uint32 TlsSlot;
+
+		void CountAllocation(const SIZE_T Bytes) const
+		{
+			if (FAllocationCount* Count = static_cast<FAllocationCount*>(FPlatformTLS::GetTlsValue(TlsSlot)))
+			{
+				++Count->Allocations;
+				Count->Bytes += Bytes;
+			}
+		}
+	};
+
+	// Installed on first use and never taken out, so blocks allocated through it can be freed from anywhere
+	FCountingMalloc& GetCountingMalloc()
+	{
+		static FCountingMalloc* const Counting = []()
+		{
+			FCountingMalloc* const Installed = new FCountingMalloc(GMalloc);
+			FPlatformAtomics::InterlockedExchangePtr(reinterpret_cast<void**>(&GMalloc), Installed);
+			return Installed;
+		}();
+		return *Counting;
+	}
+}
+
+FAllocationCounter::FAllocationCounter()
+{
+	Resume();
+}
+
+FAllocationCounter::~FAllocationCounter()
+{
+	Pause();
+}
+
+void FAllocationCounter::Pause()
+{
+	if (bRunning)
+	{
+		GetCountingMalloc().SetCount(nullptr);
+		bRunning = false;
+	}
+}
+
+void FAllocationCounter::Resume()
+{
+	GetCountingMalloc().SetCount(&Count);
+	bRunning = true;
+}
+
+FAllocationCount CountAllocations(const TFunctionRef<void()> Body)
+{
+	FAllocationCounter Counter;
+	Body();
+	Counter.Pause();
+	return Counter.Get();
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+struct FAllocationCount
+{
+	uint64 Allocations = 0;
+	uint64 Bytes = 0;
+
+	FAllocationCount operator-(const FAllocationCount& Other) const
+	{
+		return {Allocations - Other.Allocations, Bytes - Other.Bytes};
+	}
+};
+
+/**
+ * Counts the heap allocations made on the thread that created it, while it is running; other threads are never
+ * counted. Growing a buffer counts as an allocation of its new size. Only one counter per thread may run at a time,
+ * though paused ones may stay around.
+ *
+ * The first counter puts a forwarding allocator in front of GMalloc, which stays for the rest of the process, so no
+ * thread ever frees a block through a different allocator than the one it came from.
+ */
+class FAllocationCounter
+{
+	public:
+	// Starts counting straight away
+	FAllocationCounter();
+
+	~FAllocationCounter();
+
+	// Stops counting until Resume, e.g. around work of a test's own stand-in server on the same thread
+	void Pause();
+
+	void Resume();
+
+	FAllocationCount Get() const
+	{
+		return Count;
+	}
+
+	private:
+	FAllocationCount Count;
+	bool bRunning = false;
+};
+
+// Allocations Body makes on the calling thread
+FAllocationCount CountAllocations(TFunctionRef<void()> Body);
+
+#endif
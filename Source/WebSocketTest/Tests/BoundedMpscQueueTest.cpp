@@ -0,0 +1,97 @@
+#include "Async/Async.h"
+#include "BoundedMpscQueue.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBoundedMpscQueueOrderTest, "WebSocketTest.BoundedMpscQueue.Order", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBoundedMpscQueueOrderTest::RunTest(const FString& Parameters)
+{
+	TBoundedMpscQueue<int32> Queue(3);
+	TestEqual(TEXT("Capacity rounded up to a power of two"), static_cast<int32>(Queue.GetCapacity()), 4);
+
+	// Several laps round the ring, so every cell's sequence number wraps at least once
+	int32 Next = 0;
+	int32 Expected = 0;
+	for (int32 Lap = 0; Lap < 10; ++Lap)
+	{
+		for (int32 Index = 0; Index < 4; ++Index)
+		{
+			int32 Value = Next++;
+			TestTrue(TEXT("Enqueue"), Queue.TryEnqueue(MoveTemp(Value)));
+		}
+		int32 Overflow = -1;
+		TestFalse(TEXT("Full ring refuses"), Queue.TryEnqueue(MoveTemp(Overflow)));
+		TestEqual(TEXT("Refused element untouched"), Overflow, -1);
+		TestEqual(TEXT("Num when full"), Queue.Num(), 4);
+
+		int32 Value = 0;
+		while (Queue.TryDequeue(Value))
+		{
+			TestEqual(TEXT("First in, first out"), Value, Expected++);
+		}
+		TestEqual(TEXT("Num when empty"), Queue.Num(), 0);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBoundedMpscQueueProducersTest, "WebSocketTest.BoundedMpscQueue.Producers", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBoundedMpscQueueProducersTest::RunTest(const FString& Parameters)
+{
+	// Producer threads race each other and a consumer that makes room as they go, the way the socket thread, the
+	// decode worker and the game thread share a push queue
+	constexpr int32 NumProducers = 8;
+	constexpr int32 PerProducer = 20000;
+	TBoundedMpscQueue<int32> Queue(64);
+	TArray<TFuture<void>> Producers;
+	for (int32 Producer = 0; Producer < NumProducers; ++Producer)
+	{
+		Producers.Add(Async(EAsyncExecution::Thread, [&Queue, Producer]()
+		{
+			for (int32 Index = 0; Index < PerProducer; ++Index)
+			{
+				int32 Value = Producer * PerProducer + Index;
+				while (!Queue.TryEnqueue(MoveTemp(Value)))
+				{
+					FPlatformProcess::Yield();
+				}
+			}
+		}));
+	}
+
+	TArray<int32> LastSeen;
+	LastSeen.Init(-1, NumProducers);
+	int32 Received = 0;
+	bool bInOrder = true;
+	const double Deadline = FPlatformTime::Seconds() + 30.0;
+	int32 Value = 0;
+	while (Received < NumProducers * PerProducer && FPlatformTime::Seconds() < Deadline)
+	{
+		if (!Queue.TryDequeue(Value))
+		{
+			FPlatformProcess::Yield();
+			continue;
+		}
+		// Each producer's values must come out in the order it pushed them
+		const int32 Producer = Value / PerProducer;
+		bInOrder &= Value % PerProducer > LastSeen[Producer];
+		LastSeen[Producer] = Value % PerProducer;
+		++Received;
+	}
+	// Still drained after a timeout, so no producer is left spinning on a full ring
+	for (TFuture<void>& Producer : Producers)
+	{
+		while (!Producer.WaitFor(FTimespan::FromMilliseconds(1)))
+		{
+			Queue.TryDequeue(Value);
+		}
+	}
+
+	TestEqual(TEXT("Nothing lost or duplicated"), Received, NumProducers * PerProducer);
+	TestTrue(TEXT("Per-producer order kept"), bInOrder);
+	return true;
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "Async/Async.h"
+#include "DeadlineWheel.h"
+#include "LatencyHistogram.h"
+#include "Misc/AutomationTest.h"
+#include "PendingRequestTable.h"
+#include "RequestCancellationToken.h"
+#include "WebSocketClient.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// Quarter-second ticks keep every time in these tests exact in binary
+	constexpr double Resolution = 0.25;
+
+	TArray<uint64> AdvanceTo(FDeadlineWheel& Wheel, const double Now)
+	{
+		TArray<uint64> Expired;
+		Wheel.Advance(Now, [&Expired](const uint64 Id)
+		{
+			Expired.Add(Id);
+		});
+		return Expired;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeadlineWheelExpiryOrderTest, "WebSocketTest.DeadlineWheel.ExpiryOrder", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FDeadlineWheelExpiryOrderTest::RunTest(const FString& Parameters)
+{
+	FDeadlineWheel Wheel(Resolution, 4, 0.0);
+
+	// Scheduled out of order, some more than a rotation ahead
+	Wheel.Schedule(3, 1.5);
+	Wheel.Schedule(1, 0.375);
+	Wheel.Schedule(4, 2.25);
+	Wheel.Schedule(2, 0.625);
+
+	TArray<uint64> Order;
+	for (double Now = Resolution; Now <= 3.0; Now += Resolution)
+	{
+		for (const uint64 Id : AdvanceTo(Wheel, Now))
+		{
+			Order.Add(Id);
+
+			// Never before the deadline, and no later than the tick it falls in
+			const double Deadline = Id == 1 ? 0.375 : Id == 2 ? 0.625 : Id == 3 ? 1.5 : 2.25;
+			TestTrue(FString::Printf(TEXT("Request %llu not expired early"), Id), Now >= Deadline);
+			TestTrue(FString::Printf(TEXT("Request %llu expired within a tick"), Id), Now < Deadline + Resolution);
+		}
+	}
+	TestTrue(TEXT("Expired in deadline order"), Order == TArray<uint64>({1, 2, 3, 4}));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeadlineWheelOverdueTest, "WebSocketTest.DeadlineWheel.Overdue", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FDeadlineWheelOverdueTest::RunTest(const FString& Parameters)
+{
+	FDeadlineWheel Wheel(Resolution, 4, 0.0);
+	TestEqual(TEXT("Nothing to expire"), AdvanceTo(Wheel, 1.0).Num(), 0);
+
+	// A deadline already behind the wheel goes out on the next tick rather than a rotation later
+	Wheel.Schedule(1, 0.25);
+	TestEqual(TEXT("Not in the tick already visited"), AdvanceTo(Wheel, 1.0).Num(), 0);
+	TestTrue(TEXT("Next tick"), AdvanceTo(Wheel, 1.25) == TArray<uint64>({1}));
+
+	// After a stall of many rotations every due entry comes out in one call, and later ones stay
+	Wheel.Schedule(2, 2.0);
+	Wheel.Schedule(3, 3.75);
+	Wheel.Schedule(4, 100.0);
+	TArray<uint64> Stalled = AdvanceTo(Wheel, 50.0);
+	Stalled.Sort();
+	TestTrue(TEXT("Everything due after a stall"), Stalled == TArray<uint64>({2, 3}));
+	TestTrue(TEXT("Later deadline kept"), AdvanceTo(Wheel, 100.0) == TArray<uint64>({4}));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRequestCancellationTokenTest, "WebSocketTest.RequestCancellationToken.Callbacks", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRequestCancellationTokenTest::RunTest(const FString& Parameters)
+{
+	const FRequestCancellationToken Never;
+	TestTrue(TEXT("A default token takes no callbacks"), Never.OnCancel([]() {}) == 0);
+
+	const FRequestCancellationToken Token = FRequestCancellationToken::Create();
+	int32 Kept = 0;
+	int32 Removed = 0;
+	Token.OnCancel([&Kept]() { ++Kept; });
+	const uint64 Handle = Token.OnCancel([&Removed]() { ++Removed; });
+	TestTrue(TEXT("Handle"), Handle != 0);
+
+	// A request that finished unregisters itself, so only the one still in flight hears about the cancel
+	Token.RemoveOnCancel(Handle);
+	const FRequestCancellationToken Copy = Token;
+	Copy.Cancel();
+	Token.Cancel();
+	TestEqual(TEXT("Registered callback ran once"), Kept, 1);
+	TestEqual(TEXT("Removed callback did not run"), Removed, 0);
+	TestTrue(TEXT("Copies share the cancel"), Token.IsCancelled());
+	TestTrue(TEXT("Cancelled token takes no callbacks"), Token.OnCancel([]() {}) == 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRequestCancellationRaceTest, "WebSocketTest.RequestCancellationToken.Race", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRequestCancellationRaceTest::RunTest(const FString& Parameters)
+{
+	// A cancel racing the responses must resolve each request exactly once, with either its response or the cancel
+	constexpr int32 NumRequests = 1024;
+	TPendingRequestTable<int32> Table(NumRequests);
+	const FRequestCancellationToken Token = FRequestCancellationToken::Create();
+	TArray<TFuture<int32>> Futures;
+	Futures.SetNum(NumRequests);
+	for (int32 Index = 0; Index < NumRequests; ++Index)
+	{
+		const uint64 Id = Index + 1;
+		Table.Add(Id, TNumericLimits<double>::Max(), Futures[Index]);
+		Token.OnCancel([&Table, Id]()
+		{
+			Table.Cancel(Id, -1);
+		});
+	}
+
+	TFuture<void> Responses = Async(EAsyncExecution::Thread, [&Table]()
+	{
+		for (uint64 Id = 1; Id <= NumRequests; ++Id)
+		{
+			Table.Complete(Id, 1);
+		}
+	});
+	Token.Cancel();
+	Responses.Wait();
+
+	int32 Answered = 0;
+	int32 Cancelled = 0;
+	for (TFuture<int32>& Future : Futures)
+	{
+		const int32 Result = Future.Get();
+		Answered += Result == 1 ? 1 : 0;
+		Cancelled += Result == -1 ? 1 : 0;
+	}
+	TestEqual(TEXT("Every request resolved once"), Answered + Cancelled, NumRequests);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeadlineWheelLatenessTest, "WebSocketTest.DeadlineWheel.Lateness", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FDeadlineWheelLatenessTest::RunTest(const FString& Parameters)
+{
+	// The client's own wheel, on the real clock, with deadlines spread over two seconds
+	constexpr int32 NumDeadlines = 10000;
+	constexpr double SpreadSeconds = 2.0;
+	const FWebSocketConfiguration Config;
+	const double Start = FPlatformTime::Seconds();
+	FDeadlineWheel Wheel(Config.Timer_Resolution_Ms / 1000.0, Config.Timer_Wheel_Buckets, Start);
+	FRandomStream Random(NumDeadlines);
+	TArray<double> Deadlines;
+	Deadlines.SetNum(NumDeadlines);
+	for (int32 Index = 0; Index < NumDeadlines; ++Index)
+	{
+		Deadlines[Index] = Start + 0.01 + Random.FRand() * SpreadSeconds;
+		Wheel.Schedule(Index, Deadlines[Index]);
+	}
+
+	// Ticked about once a millisecond, like a fast game loop; lateness is measured from each deadline to the tick
+	// that saw it through
+	FLatencyHistogram LatenessUs;
+	FLatencyHistogram TickUs;
+	int32 Expired = 0;
+	int32 Early = 0;
+	int32 Ticks = 0;
+	const double Deadline = Start + SpreadSeconds + 5.0;
+	while (Expired < NumDeadlines && FPlatformTime::Seconds() < Deadline)
+	{
+		FPlatformProcess::Sleep(0.001f);
+		const double Now = FPlatformTime::Seconds();
+		Wheel.Advance(Now, [&](const uint64 Id)
+		{
+			++Expired;
+			Early += Now < Deadlines[Id] ? 1 : 0;
+			LatenessUs.Record(static_cast<uint64>(FMath::Max(Now - Deadlines[Id], 0.0) * 1000000.0));
+		});
+		TickUs.Record(static_cast<uint64>((FPlatformTime::Seconds() - Now) * 1000000.0));
+		++Ticks;
+	}
+
+	AddInfo(FString::Printf(TEXT("%d deadlines at %d ms resolution: late by p50 %.3fms p99 %.3fms max %.3fms"),
+		NumDeadlines, Config.Timer_Resolution_Ms, LatenessUs.GetPercentile(50.0) / 1000.0, LatenessUs.GetPercentile(99.0) / 1000.0, LatenessUs.GetMax() / 1000.0));
+	AddInfo(FString::Printf(TEXT("%d ticks: p50 %lluus p99 %lluus max %lluus each"),
+		Ticks, TickUs.GetPercentile(50.0), TickUs.GetPercentile(99.0), TickUs.GetMax()));
+	TestEqual(TEXT("Every deadline expired"), Expired, NumDeadlines);
+	TestEqual(TEXT("None expired early"), Early, 0);
+	return true;
+}
+
+#endif
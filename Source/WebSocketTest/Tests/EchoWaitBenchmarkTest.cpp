@@ -0,0 +1,61 @@
+#include "Misc/AutomationTest.h"
+#include "WebSocketBenchmarkCommandlet.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	constexpr uint32 EchoWaitPort = 18772;
+	constexpr int32 EchoWaitConcurrency = 16;
+	constexpr int32 EchoWaitPayloadBytes = 16;
+	constexpr double EchoWaitSeconds = 2.0;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEchoWaitBenchmarkTest, "WebSocketTest.Benchmark.EchoWait", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FEchoWaitBenchmarkTest::RunTest(const FString& Parameters)
+{
+	FWebSocketStandInServer Server;
+	if (!TestTrue(TEXT("Stand-in server started"), Server.Start(EchoWaitPort)))
+	{
+		return false;
+	}
+
+	FWebSocketConfiguration Config;
+	Config.Url = FWebSocketStandInServer::GetUrl(EchoWaitPort);
+	Config.Endpoint_Cache_File = FString();
+	FWebSocketClient Client(Config);
+	Client.ConnectToServer();
+
+	double LastTickTime = FPlatformTime::Seconds();
+	const double ConnectDeadline = LastTickTime + 10.0;
+	while (!Client.IsConnected() && FPlatformTime::Seconds() < ConnectDeadline)
+	{
+		UWebSocketBenchmarkCommandlet::PumpFrame(Server, LastTickTime);
+	}
+	if (!TestTrue(TEXT("Connected to the stand-in server"), Client.IsConnected()))
+	{
+		Client.Quit();
+		return false;
+	}
+
+	// The same load before and after: the old 10 ms polling wait, then the promises that replaced it
+	const FWebSocketBenchmarkRun Poll = UWebSocketBenchmarkCommandlet::RunEchoes(Server, Client, EWebSocketEchoWait::Poll, 1, EchoWaitConcurrency, EchoWaitPayloadBytes, EchoWaitSeconds, LastTickTime);
+	const FWebSocketBenchmarkRun Promise = UWebSocketBenchmarkCommandlet::RunEchoes(Server, Client, EWebSocketEchoWait::Promise, 1, EchoWaitConcurrency, EchoWaitPayloadBytes, EchoWaitSeconds, LastTickTime);
+	Client.Quit();
+
+	for (const FWebSocketBenchmarkRun* Run : {&Poll, &Promise})
+	{
+		AddInfo(FString::Printf(TEXT("%s wait: %.0f requests/s, p50 %.3fms p99 %.3fms max %.3fms, %llu errors"),
+			Run == &Poll ? TEXT("Poll") : TEXT("Promise"), Run->Requests / Run->Seconds, Run->P50Ms, Run->P99Ms, Run->MaxMs, Run->Errors));
+		TestTrue(TEXT("Echoes answered"), Run->Requests > 0);
+		TestTrue(TEXT("No echo failed"), Run->Errors == 0);
+	}
+	// Polling adds half an interval on average, so the promises must come in ahead at the median
+	TestTrue(TEXT("Promise p50 below the polling wait's"), Promise.P50Ms < Poll.P50Ms);
+	return true;
+}
+
+#endif
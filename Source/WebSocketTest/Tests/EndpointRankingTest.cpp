@@ -0,0 +1,241 @@
+#include "EndpointRanking.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "StandInTestCommand.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const FString NearUrl = TEXT("ws://near.example/");
+	const FString FarUrl = TEXT("ws://far.example/");
+	const FString NewUrl = TEXT("ws://new.example/");
+
+	// Handshake and response delays of three stand-in servers, fastest first
+	constexpr float Delays[] = {0.0f, 0.2f, 0.4f};
+	constexpr int32 NumDelayedServers = UE_ARRAY_COUNT(Delays);
+
+	FString TestCacheFile(const TCHAR* Name)
+	{
+		return FPaths::AutomationTransientDir() / Name;
+	}
+
+	// One server per delay on consecutive ports from FirstPort, or none if any of them fails to start
+	TArray<TSharedRef<FWebSocketStandInServer>> StartDelayedServers(const uint32 FirstPort)
+	{
+		TArray<TSharedRef<FWebSocketStandInServer>> Servers;
+		for (int32 Index = 0; Index < NumDelayedServers; ++Index)
+		{
+			const TSharedRef<FWebSocketStandInServer> Server = MakeShared<FWebSocketStandInServer>(0.0f, Delays[Index]);
+			if (!Server->Start(FirstPort + Index))
+			{
+				return TArray<TSharedRef<FWebSocketStandInServer>>();
+			}
+			Servers.Add(Server);
+		}
+		return Servers;
+	}
+
+	// The servers' urls slowest first, so the configured order is the opposite of the probed one
+	TArray<FString> GetSlowestFirst(const uint32 FirstPort)
+	{
+		TArray<FString> Urls;
+		for (int32 Index = NumDelayedServers - 1; Index >= 0; --Index)
+		{
+			Urls.Add(FWebSocketStandInServer::GetUrl(FirstPort + Index));
+		}
+		return Urls;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEndpointRankingOrderTest, "WebSocketTest.EndpointRanking.Order", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FEndpointRankingOrderTest::RunTest(const FString& Parameters)
+{
+	// Without a cache the configured order stands and nothing has a handshake time yet
+	const FEndpointRanking Configured({FarUrl, NearUrl}, FString());
+	TestFalse(TEXT("Not ranked without a probe"), Configured.IsRanked());
+	TestEqual(TEXT("Configured order"), Configured.GetBest(), FarUrl);
+	TestEqual(TEXT("Next"), Configured.GetNext(FarUrl), NearUrl);
+	TestEqual(TEXT("Next wraps round to the best"), Configured.GetNext(NearUrl), FarUrl);
+	TestEqual(TEXT("Next of an unknown endpoint is the best"), Configured.GetNext(NewUrl), FarUrl);
+	TestTrue(TEXT("No handshake time"), Configured.GetRttMs(NearUrl) < 0.0);
+	TestTrue(TEXT("Unknown endpoint"), Configured.GetRttMs(NewUrl) < 0.0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEndpointRankingCacheTest, "WebSocketTest.EndpointRanking.Cache", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FEndpointRankingCacheTest::RunTest(const FString& Parameters)
+{
+	// An earlier session found near faster than far, and knew an endpoint no longer configured
+	const FString CacheFile = TestCacheFile(TEXT("EndpointRankingCache.txt"));
+	const TArray<FString> Lines = {
+		FString::Printf(TEXT("%s\t%f"), *NearUrl, 12.5),
+		TEXT("ws://gone.example/\t3.0"),
+		FString::Printf(TEXT("%s\t%f"), *FarUrl, 80.0),
+		TEXT("not a cache line")
+	};
+	if (!TestTrue(TEXT("Cache written"), FFileHelper::SaveStringArrayToFile(Lines, *CacheFile)))
+	{
+		return false;
+	}
+
+	const FEndpointRanking Ranking({FarUrl, NewUrl, NearUrl}, CacheFile);
+	IFileManager::Get().Delete(*CacheFile);
+
+	TestTrue(TEXT("Ranked from the cache"), Ranking.IsRanked());
+	TestEqual(TEXT("Configured endpoints only"), Ranking.Num(), 3);
+	TestEqual(TEXT("Cached best first"), Ranking.GetBest(), NearUrl);
+	TestEqual(TEXT("Then the cached order"), Ranking.GetNext(NearUrl), FarUrl);
+	TestEqual(TEXT("Endpoints new to the cache go last"), Ranking.GetNext(FarUrl), NewUrl);
+	TestEqual(TEXT("Cached handshake time"), Ranking.GetRttMs(NearUrl), 12.5);
+	TestTrue(TEXT("No handshake time for a new endpoint"), Ranking.GetRttMs(NewUrl) < 0.0);
+	TestTrue(TEXT("Endpoints no longer configured are ignored"), Ranking.GetRttMs(TEXT("ws://gone.example/")) < 0.0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEndpointRankingProbeTest, "WebSocketTest.EndpointRanking.Probe", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FEndpointRankingProbeTest::RunTest(const FString& Parameters)
+{
+	const TSharedRef<FWebSocketStandInServer> Server = MakeShared<FWebSocketStandInServer>();
+	if (!TestTrue(TEXT("Stand-in server started"), Server->Start(18768)))
+	{
+		return false;
+	}
+
+	// The endpoint that refuses is configured first, so only the probe can put the live one ahead of it
+	const FString LiveUrl = FWebSocketStandInServer::GetUrl(18768);
+	const FString DeadUrl = FWebSocketStandInServer::GetUrl(18769);
+	const FString CacheFile = TestCacheFile(TEXT("EndpointRankingProbe.txt"));
+	IFileManager::Get().Delete(*CacheFile);
+
+	const TSharedRef<FEndpointRanking> Ranking = MakeShared<FEndpointRanking>(TArray<FString>({DeadUrl, LiveUrl}), CacheFile);
+	const TSharedRef<bool> bRanked = MakeShared<bool>(false);
+	Ranking->Probe(FWebSocketsModule::Get(), TArray<FString>(), 5.0f, [bRanked]()
+	{
+		*bRanked = true;
+	});
+
+	// Once the probe settles, check its ranking and that a ranking built from the saved cache starts out the same
+	ADD_LATENT_AUTOMATION_COMMAND(FStandInTestCommand(this, {Server}, nullptr, [this, Ranking, bRanked, LiveUrl, DeadUrl, CacheFile]()
+	{
+		if (!*bRanked) return false;
+
+		TestTrue(TEXT("Ranked by the probe"), Ranking->IsRanked());
+		TestFalse(TEXT("Probe finished"), Ranking->IsProbing());
+		TestEqual(TEXT("Answering endpoint first"), Ranking->GetBest(), LiveUrl);
+		TestTrue(TEXT("Handshake time of the answering endpoint"), Ranking->GetRttMs(LiveUrl) >= 0.0);
+		TestTrue(TEXT("No time for the endpoint that refused"), Ranking->GetRttMs(DeadUrl) < 0.0);
+
+		const FEndpointRanking Reloaded({DeadUrl, LiveUrl}, CacheFile);
+		TestTrue(TEXT("Cached ranking counts as ranked"), Reloaded.IsRanked());
+		TestEqual(TEXT("Cached ranking keeps the probed order"), Reloaded.GetBest(), LiveUrl);
+		IFileManager::Get().Delete(*CacheFile);
+		return true;
+	}, []()
+	{
+		return FString(TEXT("endpoint probe never finished"));
+	}));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEndpointRankingDelayOrderTest, "WebSocketTest.EndpointRanking.DelayOrder", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FEndpointRankingDelayOrderTest::RunTest(const FString& Parameters)
+{
+	constexpr uint32 FirstPort = 18773;
+	const TArray<TSharedRef<FWebSocketStandInServer>> Servers = StartDelayedServers(FirstPort);
+	if (!TestEqual(TEXT("Stand-in servers started"), Servers.Num(), NumDelayedServers))
+	{
+		return false;
+	}
+
+	const TSharedRef<FEndpointRanking> Ranking = MakeShared<FEndpointRanking>(GetSlowestFirst(FirstPort), FString());
+	const TSharedRef<bool> bRanked = MakeShared<bool>(false);
+	Ranking->Probe(FWebSocketsModule::Get(), TArray<FString>(), 5.0f, [bRanked]()
+	{
+		*bRanked = true;
+	});
+
+	ADD_LATENT_AUTOMATION_COMMAND(FStandInTestCommand(this, Servers, nullptr, [this, Ranking, bRanked, FirstPort]()
+	{
+		if (!*bRanked) return false;
+
+		// Each server's handshake waits out its delay, so the ranking must follow the delays
+		FString Url = Ranking->GetBest();
+		for (int32 Index = 0; Index < NumDelayedServers; ++Index)
+		{
+			TestEqual(FString::Printf(TEXT("Server delayed %.1fs ranked %d"), Delays[Index], Index + 1), Url, FWebSocketStandInServer::GetUrl(FirstPort + Index));
+			AddInfo(FString::Printf(TEXT("%s delayed %.1fs: handshake %.1fms"), *Url, Delays[Index], Ranking->GetRttMs(Url)));
+			Url = Ranking->GetNext(Url);
+		}
+		return true;
+	}, []()
+	{
+		return FString(TEXT("endpoint probe never finished"));
+	}));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEndpointRankingFailOverTest, "WebSocketTest.EndpointRanking.FailOver", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FEndpointRankingFailOverTest::RunTest(const FString& Parameters)
+{
+	constexpr uint32 FirstPort = 18776;
+	const TArray<TSharedRef<FWebSocketStandInServer>> Servers = StartDelayedServers(FirstPort);
+	if (!TestEqual(TEXT("Stand-in servers started"), Servers.Num(), NumDelayedServers))
+	{
+		return false;
+	}
+
+	FWebSocketConfiguration Config;
+	Config.Endpoints = GetSlowestFirst(FirstPort);
+	Config.Endpoint_Cache_File = FString();
+	Config.Heartbeat_Interval_Ms = 0;
+	Config.Reconnect_Base_Delay = 0.1f;
+	const TSharedRef<FWebSocketClient> Client = MakeShared<FWebSocketClient>(Config);
+	Client->ConnectToServer();
+
+	// Connect to the fastest server once the probe has ranked them, lose it, and carry on with the next best
+	const FString Best = FWebSocketStandInServer::GetUrl(FirstPort);
+	const FString Next = FWebSocketStandInServer::GetUrl(FirstPort + 1);
+	const TSharedRef<int32> Stage = MakeShared<int32>(0);
+	const TSharedRef<uint64> SlowestAccepted = MakeShared<uint64>(0);
+	const TSharedRef<TFuture<TValueOrError<FEchoResponseData, FMgsError>>> Echo = MakeShared<TFuture<TValueOrError<FEchoResponseData, FMgsError>>>();
+	ADD_LATENT_AUTOMATION_COMMAND(FStandInTestCommand(this, Servers, Client, [this, Servers, Client, Best, Next, Stage, SlowestAccepted, Echo]()
+	{
+		switch (*Stage)
+		{
+		case 0:
+			if (!Client->IsConnected()) return false;
+			TestEqual(TEXT("Connected to the fastest server"), Client->GetEndpoint(), Best);
+			*SlowestAccepted = Servers.Last()->GetConnectionsAccepted();
+			Servers[0]->Stop();
+			++*Stage;
+			return false;
+		case 1:
+			if (!Client->IsConnected() || Client->GetEndpoint() == Best) return false;
+			TestEqual(TEXT("Failed over to the next best server"), Client->GetEndpoint(), Next);
+			*Echo = Client->SendNonBlocking(FEchoRequestData(), 5000);
+			++*Stage;
+			return false;
+		default:
+			if (!Echo->IsReady()) return false;
+			TestTrue(TEXT("Echo answered after failing over"), Echo->Get().HasValue());
+			TestTrue(TEXT("No probe after failing over"), Servers.Last()->GetConnectionsAccepted() == *SlowestAccepted);
+			TestTrue(TEXT("Only the probe and no connection reached the slowest server"), *SlowestAccepted == 1);
+			return true;
+		}
+	}, [Client, Stage]()
+	{
+		return FString::Printf(TEXT("stage %d, connected %d to %s"), *Stage, Client->IsConnected(), *Client->GetEndpoint());
+	}, 20.0));
+	return true;
+}
+
+#endif
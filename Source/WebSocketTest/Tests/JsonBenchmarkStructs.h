@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JsonBenchmarkStructs.generated.h"
+
+// A larger, nested payload than any message in the schema, for comparing serializers where structure dominates
+
+USTRUCT()
+struct FJsonBenchmarkItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Name;
+
+	UPROPERTY()
+	int32 Count = 0;
+
+	UPROPERTY()
+	double Score = 0.0;
+
+	UPROPERTY()
+	bool bEquipped = false;
+
+	UPROPERTY()
+	TArray<FString> Tags;
+};
+
+USTRUCT()
+struct FJsonBenchmarkInventory
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Owner;
+
+	UPROPERTY()
+	uint64 Revision = 0;
+
+	UPROPERTY()
+	TArray<int32> Slots;
+
+	UPROPERTY()
+	TArray<FJsonBenchmarkItem> Items;
+};
@@ -0,0 +1,200 @@
+#include "AllocationCounter.h"
+#include "JsonBenchmarkStructs.h"
+#include "JsonObjectConverter.h"
+#include "JsonStreamWriter.h"
+#include "Misc/AutomationTest.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "WebSocketStructs.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// Reparses JSON and prints it condensed, so two writers' output compares equal whatever their spacing or escaping
+	FString Normalize(const FString& Json)
+	{
+		TSharedPtr<FJsonObject> Object;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Object) || !Object.IsValid())
+		{
+			return FString();
+		}
+		FString Normalized;
+		FJsonSerializer::Serialize(Object.ToSharedRef(), TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Normalized));
+		return Normalized;
+	}
+
+	template <typename TStruct>
+	FString WriteStreamed(const TStruct& Data)
+	{
+		TArray<ANSICHAR> Buffer;
+		FJsonStreamWriter Writer(Buffer);
+		Writer.WriteStruct(Data);
+		return FString(FUTF8ToTCHAR(Buffer.GetData(), Buffer.Num()));
+	}
+
+	template <typename TStruct>
+	FString WriteConverted(const TStruct& Data)
+	{
+		FString Json;
+		FJsonObjectConverter::UStructToJsonObjectString(Data, Json);
+		return Json;
+	}
+
+	FJsonBenchmarkInventory MakeInventory()
+	{
+		FJsonBenchmarkInventory Inventory;
+		Inventory.Owner = TEXT("player-0001");
+		Inventory.Revision = 1234567;
+		for (int32 Index = 0; Index < 32; ++Index)
+		{
+			Inventory.Slots.Add(Index * 3);
+			FJsonBenchmarkItem& Item = Inventory.Items.AddDefaulted_GetRef();
+			Item.Name = FString::Printf(TEXT("item-%02d"), Index);
+			Item.Count = Index;
+			Item.Score = Index * 1.25;
+			Item.bEquipped = Index % 4 == 0;
+			Item.Tags = {TEXT("common"), TEXT("tradable"), FString::Printf(TEXT("set-%d"), Index % 5)};
+		}
+		return Inventory;
+	}
+
+	struct FSerializerCost
+	{
+		double NsPerWrite = 0.0;
+		double AllocationsPerWrite = 0.0;
+		double BytesPerWrite = 0.0;
+		int32 OutputBytes = 0;
+	};
+
+	// Iterations writes of Data after one to warm up, timed and allocation-counted together
+	template <typename TStruct, typename WriteType>
+	FSerializerCost Measure(const TStruct& Data, const int32 Iterations, WriteType&& Write)
+	{
+		FSerializerCost Cost;
+		Cost.OutputBytes = Write(Data);
+		const double Start = FPlatformTime::Seconds();
+		const FAllocationCount Count = CountAllocations([&Data, Iterations, &Write]()
+		{
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				Write(Data);
+			}
+		});
+		Cost.NsPerWrite = (FPlatformTime::Seconds() - Start) * 1e9 / Iterations;
+		Cost.AllocationsPerWrite = static_cast<double>(Count.Allocations) / Iterations;
+		Cost.BytesPerWrite = static_cast<double>(Count.Bytes) / Iterations;
+		return Cost;
+	}
+
+	// The struct plan into a reused buffer, as the send path writes every request
+	template <typename TStruct>
+	FSerializerCost MeasureStreamed(const TStruct& Data, const int32 Iterations)
+	{
+		TArray<ANSICHAR> Buffer;
+		return Measure(Data, Iterations, [&Buffer](const TStruct& Value)
+		{
+			Buffer.Reset();
+			FJsonStreamWriter(Buffer).WriteStruct(Value);
+			return Buffer.Num();
+		});
+	}
+
+	// The path the struct plan replaced: a DOM from UStructToJsonObject, printed by TJsonWriter and encoded as UTF-8
+	template <typename TStruct>
+	FSerializerCost MeasureConverted(const TStruct& Data, const int32 Iterations)
+	{
+		return Measure(Data, Iterations, [](const TStruct& Value)
+		{
+			const TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+			FJsonObjectConverter::UStructToJsonObject(TStruct::StaticStruct(), &Value, Object, 0, 0);
+			FString Json;
+			FJsonSerializer::Serialize(Object, TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json));
+			const FTCHARToUTF8 Utf8(*Json);
+			return Utf8.Length();
+		});
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJsonStreamWriterMatchesConverterTest, "WebSocketTest.JsonStreamWriter.MatchesConverter", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJsonStreamWriterMatchesConverterTest::RunTest(const FString& Parameters)
+{
+	// The server was written against FJsonObjectConverter's output, so the streamed bytes must mean the same thing
+	FDebugLogin Login;
+	Login.Id = 17;
+	Login.Ack = 1;
+	Login.MsgType = TEXT("DebugLogin");
+	Login.Data.Token = TEXT("token");
+	TestEqual(TEXT("Nested struct"), Normalize(WriteStreamed(Login)), Normalize(WriteConverted(Login)));
+
+	FHeartbeatRequestData Heartbeat;
+	Heartbeat.ClientTime = 1700000000123.5;
+	TestEqual(TEXT("Double"), Normalize(WriteStreamed(Heartbeat)), Normalize(WriteConverted(Heartbeat)));
+
+	FFlowControlRequestData FlowControl;
+	FlowControl.Paused = true;
+	TestEqual(TEXT("Bool"), Normalize(WriteStreamed(FlowControl)), Normalize(WriteConverted(FlowControl)));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJsonStreamWriterEscapingTest, "WebSocketTest.JsonStreamWriter.Escaping", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJsonStreamWriterEscapingTest::RunTest(const FString& Parameters)
+{
+	FChatMessage Message;
+	Message.Message = TEXT("quote \" backslash \\ newline \n tab \t control \x01 caf\u00e9 \u2713");
+	Message.SenderId = TEXT("\U0001F600");
+
+	const FString Json = WriteStreamed(Message);
+	TestEqual(TEXT("Same as the converter"), Normalize(Json), Normalize(WriteConverted(Message)));
+
+	FChatMessage Parsed;
+	TestTrue(TEXT("Parses"), FJsonObjectConverter::JsonObjectStringToUStruct(Json, &Parsed, 0, 0));
+	TestEqual(TEXT("Message survives"), Parsed.Message, Message.Message);
+	TestEqual(TEXT("Surrogate pair survives"), Parsed.SenderId, Message.SenderId);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJsonStreamWriterAppendsTest, "WebSocketTest.JsonStreamWriter.Appends", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJsonStreamWriterAppendsTest::RunTest(const FString& Parameters)
+{
+	// The send path resets and reuses one buffer, so a reset must leave no trace of the previous message
+	TArray<ANSICHAR> Buffer;
+	FEchoRequestData Long;
+	Long.Val = FString::ChrN(1000, TEXT('x'));
+	FJsonStreamWriter(Buffer).WriteStruct(Long);
+	const int32 Capacity = Buffer.Max();
+
+	Buffer.Reset();
+	FEchoRequestData Short;
+	Short.Val = TEXT("y");
+	FJsonStreamWriter(Buffer).WriteStruct(Short);
+	TestEqual(TEXT("Only the new message"), FString(FUTF8ToTCHAR(Buffer.GetData(), Buffer.Num())), FString(TEXT("{\"val\":\"y\"}")));
+	TestEqual(TEXT("Allocation kept"), Buffer.Max(), Capacity);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJsonStreamWriterCostTest, "WebSocketTest.JsonStreamWriter.Cost", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJsonStreamWriterCostTest::RunTest(const FString& Parameters)
+{
+	FEchoRequestData Echo;
+	Echo.Val = FString::ChrN(256, TEXT('x'));
+	const FJsonBenchmarkInventory Inventory = MakeInventory();
+	TestEqual(TEXT("Inventory written the same either way"), Normalize(WriteStreamed(Inventory)), Normalize(WriteConverted(Inventory)));
+
+	const auto Report = [this](const TCHAR* Name, const FSerializerCost& Streamed, const FSerializerCost& Converted)
+	{
+		AddInfo(FString::Printf(TEXT("%s, %d bytes: struct plan %.0fns, %.2f allocations (%.0f bytes); converter %.0fns, %.2f allocations (%.0f bytes)"),
+			Name, Streamed.OutputBytes, Streamed.NsPerWrite, Streamed.AllocationsPerWrite, Streamed.BytesPerWrite, Converted.NsPerWrite, Converted.AllocationsPerWrite, Converted.BytesPerWrite));
+		TestTrue(FString::Printf(TEXT("%s: no allocations per write through the struct plan"), Name), Streamed.AllocationsPerWrite == 0.0);
+		TestTrue(FString::Printf(TEXT("%s: fewer allocations than the converter"), Name), Streamed.AllocationsPerWrite < Converted.AllocationsPerWrite);
+	};
+	Report(TEXT("FEchoRequestData"), MeasureStreamed(Echo, 100000), MeasureConverted(Echo, 100000));
+	Report(TEXT("FJsonBenchmarkInventory"), MeasureStreamed(Inventory, 10000), MeasureConverted(Inventory, 10000));
+	return true;
+}
+
+#endif
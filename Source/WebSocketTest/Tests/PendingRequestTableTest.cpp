@@ -0,0 +1,378 @@
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Misc/AutomationTest.h"
+#include "PendingRequestTable.h"
+#include "StandInTestCommand.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+#include <shared_mutex>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	constexpr uint32 StandInEchoesPort = 18771;
+	constexpr int32 NumStandInEchoes = 1000;
+	constexpr double ThroughputSeconds = 1.0;
+
+	// The table acked requests had before the ring: promises in a TMap behind one reader-writer lock
+	class FLockedPendingMap
+	{
+		public:
+		bool Add(const uint64 Id, const double Deadline, TFuture<int32>& OutFuture)
+		{
+			std::unique_lock<std::shared_timed_mutex> Lock(Mutex);
+			if (Pending.Contains(Id)) return false;
+			OutFuture = Pending.Add(Id).GetFuture();
+			return true;
+		}
+
+		bool Complete(const uint64 Id, const int32 Result)
+		{
+			TPromise<int32> Promise;
+			{
+				std::unique_lock<std::shared_timed_mutex> Lock(Mutex);
+				TPromise<int32>* Found = Pending.Find(Id);
+				if (Found == nullptr) return false;
+				Promise = MoveTemp(*Found);
+				Pending.Remove(Id);
+			}
+			Promise.SetValue(Result);
+			return true;
+		}
+
+		bool IsPending(const uint64 Id) const
+		{
+			std::shared_lock<std::shared_timed_mutex> Lock(Mutex);
+			return Pending.Contains(Id);
+		}
+
+		private:
+		mutable std::shared_timed_mutex Mutex;
+		TMap<uint64, TPromise<int32>> Pending;
+	};
+
+	/**
+	 * Round trips per second through Table from Pairs requester threads, each with one request in flight that it polls
+	 * with IsPending, the way waiters used to, and as many responder threads completing them. Id N + k * Pairs always
+	 * belongs to pair N, so the ring's slots never collide between pairs.
+	 */
+	template <typename TableType>
+	double MeasureRoundTripsPerSecond(TableType& Table, const int32 Pairs)
+	{
+		std::atomic<bool> bStopRequests{false};
+		std::atomic<bool> bStopResponses{false};
+		std::atomic<uint64> RoundTrips{0};
+		TUniquePtr<std::atomic<uint64>[]> Mailboxes(new std::atomic<uint64>[Pairs]);
+		TArray<TFuture<void>> Requesters;
+		TArray<TFuture<void>> Responders;
+		for (int32 Pair = 0; Pair < Pairs; ++Pair)
+		{
+			Mailboxes[Pair].store(0);
+			std::atomic<uint64>& Mailbox = Mailboxes[Pair];
+			Requesters.Add(Async(EAsyncExecution::Thread, [&Table, &Mailbox, &bStopRequests, &RoundTrips, Pair, Pairs]()
+			{
+				uint64 Done = 0;
+				for (uint64 Id = Pair + 1; !bStopRequests.load(std::memory_order_relaxed); Id += Pairs)
+				{
+					TFuture<int32> Future;
+					Table.Add(Id, TNumericLimits<double>::Max(), Future);
+					Mailbox.store(Id, std::memory_order_release);
+					while (Table.IsPending(Id))
+					{
+						FPlatformProcess::Yield();
+					}
+					++Done;
+				}
+				RoundTrips += Done;
+			}));
+			Responders.Add(Async(EAsyncExecution::Thread, [&Table, &Mailbox, &bStopResponses]()
+			{
+				uint64 Answered = 0;
+				while (!bStopResponses.load(std::memory_order_relaxed))
+				{
+					const uint64 Id = Mailbox.load(std::memory_order_acquire);
+					if (Id == Answered)
+					{
+						FPlatformProcess::Yield();
+						continue;
+					}
+					Table.Complete(Id, 1);
+					Answered = Id;
+				}
+			}));
+		}
+
+		// Responders outlive the requesters, so no request is left with a promise nobody keeps
+		const double Start = FPlatformTime::Seconds();
+		FPlatformProcess::Sleep(ThroughputSeconds);
+		bStopRequests = true;
+		for (TFuture<void>& Requester : Requesters)
+		{
+			Requester.Wait();
+		}
+		const double Seconds = FPlatformTime::Seconds() - Start;
+		bStopResponses = true;
+		for (TFuture<void>& Responder : Responders)
+		{
+			Responder.Wait();
+		}
+		return RoundTrips.load() / Seconds;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingRequestTableCompleteTest, "WebSocketTest.PendingRequestTable.Complete", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingRequestTableCompleteTest::RunTest(const FString& Parameters)
+{
+	TPendingRequestTable<int32> Table(8);
+	TArray<FPendingRequestRelease> Releases;
+	Table.SetReleaseHandler([&Releases](const FPendingRequestRelease& Release, const int32&)
+	{
+		Releases.Add(Release);
+	});
+
+	// The future is the only way a waiter hears back, so it must be ready the moment Complete returns
+	TFuture<int32> Future;
+	TestTrue(TEXT("Add"), Table.Add(1, TNumericLimits<double>::Max(), Future, 2, 3));
+	TestTrue(TEXT("Pending after Add"), Table.IsPending(1));
+	TestFalse(TEXT("Not ready before Complete"), Future.IsReady());
+	TestTrue(TEXT("Complete"), Table.Complete(1, 42));
+	TestTrue(TEXT("Ready after Complete"), Future.IsReady());
+	TestEqual(TEXT("Result"), Future.Get(), 42);
+	TestFalse(TEXT("Not pending after Complete"), Table.IsPending(1));
+	TestFalse(TEXT("A second completion fails"), Table.Complete(1, 7));
+
+	if (TestEqual(TEXT("Releases"), Releases.Num(), 1))
+	{
+		TestTrue(TEXT("Released id"), Releases[0].Id == 1);
+		TestEqual(TEXT("Released channel"), Releases[0].Channel, 2);
+		TestEqual(TEXT("Released category"), Releases[0].Category, 3);
+		TestTrue(TEXT("Released as completed"), Releases[0].State == EPendingRequestState::Completed);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingRequestTableExpireTest, "WebSocketTest.PendingRequestTable.Expire", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingRequestTableExpireTest::RunTest(const FString& Parameters)
+{
+	TPendingRequestTable<int32> Table(8);
+
+	TFuture<int32> Future;
+	Table.Add(1, 10.0, Future);
+	TestFalse(TEXT("Not due before its deadline"), Table.ExpireIfDue(1, 9.0));
+	TestTrue(TEXT("Due at its deadline"), Table.ExpireIfDue(1, 10.0));
+	TestTrue(TEXT("Ready after expiring"), Future.IsReady());
+	TestEqual(TEXT("Expired with the default result"), Future.Get(), 0);
+
+	// A response that arrives after the timeout has nobody left to complete
+	TestFalse(TEXT("Late completion fails"), Table.Complete(1, 42));
+
+	TFuture<int32> Moved;
+	Table.Add(2, 10.0, Moved);
+	TestTrue(TEXT("SetDeadline"), Table.SetDeadline(2, 20.0));
+	TestFalse(TEXT("Not due before its moved deadline"), Table.ExpireIfDue(2, 10.0));
+	TestTrue(TEXT("Cancel"), Table.Cancel(2, -1));
+	TestEqual(TEXT("Cancelled with the given result"), Moved.Get(), -1);
+	TestFalse(TEXT("SetDeadline after resolving fails"), Table.SetDeadline(2, 30.0));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingRequestTableConcurrentWaitersTest, "WebSocketTest.PendingRequestTable.ConcurrentWaiters", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingRequestTableConcurrentWaitersTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumRequests = 256;
+	TPendingRequestTable<int32> Table(NumRequests);
+
+	TArray<TFuture<int32>> Futures;
+	Futures.SetNum(NumRequests);
+	for (int32 Index = 0; Index < NumRequests; ++Index)
+	{
+		TestTrue(TEXT("Add"), Table.Add(Index + 1, TNumericLimits<double>::Max(), Futures[Index]));
+	}
+
+	// Responses come back out of order and from several threads, and each must reach its own waiter
+	std::atomic<int32> Matched{0};
+	TArray<TFuture<void>> Continuations;
+	for (int32 Index = 0; Index < NumRequests; ++Index)
+	{
+		Continuations.Add(Futures[Index].Next([&Matched, Expected = Index * 10](const int32 Result)
+		{
+			Matched += Result == Expected ? 1 : 0;
+		}));
+	}
+	ParallelFor(NumRequests, [&Table](const int32 Index)
+	{
+		const int32 Reversed = NumRequests - 1 - Index;
+		Table.Complete(Reversed + 1, Reversed * 10);
+	});
+
+	for (TFuture<void>& Continuation : Continuations)
+	{
+		Continuation.Wait();
+	}
+	TestEqual(TEXT("Every waiter got its own result"), Matched.load(), NumRequests);
+	for (int32 Index = 0; Index < NumRequests; ++Index)
+	{
+		TestFalse(TEXT("Resolved"), Table.IsPending(Index + 1));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingRequestTableSlotReuseTest, "WebSocketTest.PendingRequestTable.SlotReuse", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingRequestTableSlotReuseTest::RunTest(const FString& Parameters)
+{
+	TPendingRequestTable<int32> Table(4);
+
+	// Id 5 maps onto id 1's slot, which is still taken
+	TFuture<int32> First;
+	TFuture<int32> Colliding;
+	TestTrue(TEXT("Add"), Table.Add(1, TNumericLimits<double>::Max(), First));
+	TestFalse(TEXT("Add into an occupied slot fails"), Table.Add(5, TNumericLimits<double>::Max(), Colliding));
+	TestTrue(TEXT("Complete"), Table.Complete(1, 1));
+
+	// Once recycled, the slot's tag names the new id, so anything still addressed to the old one is refused
+	TFuture<int32> Reused;
+	TestTrue(TEXT("Add into the freed slot"), Table.Add(5, TNumericLimits<double>::Max(), Reused));
+	TestFalse(TEXT("Stale completion fails"), Table.Complete(1, 99));
+	TestFalse(TEXT("Stale expiry fails"), Table.ExpireIfDue(1, TNumericLimits<double>::Max()));
+	TestFalse(TEXT("Stale cancel fails"), Table.Cancel(1));
+	TestTrue(TEXT("New request still pending"), Table.IsPending(5));
+	TestTrue(TEXT("Complete the new request"), Table.Complete(5, 5));
+	TestEqual(TEXT("New request's result"), Reused.Get(), 5);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingRequestTableContentionTest, "WebSocketTest.PendingRequestTable.Contention", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingRequestTableContentionTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 Capacity = 64;
+	constexpr int32 Rounds = 200;
+	TPendingRequestTable<int32> Table(Capacity);
+	std::atomic<int32> Released{0};
+	Table.SetReleaseHandler([&Released](const FPendingRequestRelease&, const int32&)
+	{
+		++Released;
+	});
+
+	// Every round fills the ring, then a response, a timeout and a cancel race for each request; exactly one of them
+	// may resolve it, however they interleave
+	std::atomic<int32> Resolved{0};
+	uint64 NextId = 1;
+	for (int32 Round = 0; Round < Rounds; ++Round)
+	{
+		const uint64 FirstId = NextId;
+		TArray<TFuture<int32>> Futures;
+		Futures.SetNum(Capacity);
+		for (int32 Index = 0; Index < Capacity; ++Index)
+		{
+			TestTrue(TEXT("Add"), Table.Add(NextId++, 0.0, Futures[Index]));
+		}
+		ParallelFor(Capacity * 3, [&Table, &Resolved, FirstId](const int32 Index)
+		{
+			const uint64 Id = FirstId + Index / 3;
+			bool bResolved = false;
+			switch (Index % 3)
+			{
+			case 0:
+				bResolved = Table.Complete(Id, 1);
+				break;
+			case 1:
+				bResolved = Table.ExpireIfDue(Id, 1.0);
+				break;
+			default:
+				bResolved = Table.Cancel(Id, 2);
+				break;
+			}
+			Resolved += bResolved ? 1 : 0;
+		});
+		for (TFuture<int32>& Future : Futures)
+		{
+			TestTrue(TEXT("Resolved"), Future.IsReady());
+		}
+	}
+
+	TestEqual(TEXT("Each request resolved once"), Resolved.load(), Capacity * Rounds);
+	TestEqual(TEXT("Each request released once"), Released.load(), Capacity * Rounds);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingRequestTableStandInEchoesTest, "WebSocketTest.PendingRequestTable.StandInEchoes", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingRequestTableStandInEchoesTest::RunTest(const FString& Parameters)
+{
+	const TSharedRef<FWebSocketStandInServer> Server = MakeShared<FWebSocketStandInServer>();
+	if (!TestTrue(TEXT("Stand-in server started"), Server->Start(StandInEchoesPort)))
+	{
+		return false;
+	}
+
+	FWebSocketConfiguration Config;
+	Config.Url = FWebSocketStandInServer::GetUrl(StandInEchoesPort);
+	Config.Endpoint_Cache_File = FString();
+	const TSharedRef<FWebSocketClient> Client = MakeShared<FWebSocketClient>(Config);
+	Client->ConnectToServer();
+
+	// All of them in flight at once, so every response has to find its own slot among the others
+	using FEchoFuture = TFuture<TValueOrError<FEchoResponseData, FMgsError>>;
+	const TSharedRef<TArray<FEchoFuture>> Echoes = MakeShared<TArray<FEchoFuture>>();
+	ADD_LATENT_AUTOMATION_COMMAND(FStandInTestCommand(this, {Server}, Client, [this, Client, Echoes]()
+	{
+		if (Echoes->Num() == 0)
+		{
+			if (!Client->IsConnected()) return false;
+			for (int32 Index = 0; Index < NumStandInEchoes; ++Index)
+			{
+				FEchoRequestData Request;
+				Request.Val = FString::Printf(TEXT("echo-%d"), Index);
+				Echoes->Add(Client->SendNonBlocking(Request, 10000));
+			}
+			return false;
+		}
+		if (Echoes->ContainsByPredicate([](const FEchoFuture& Echo) { return !Echo.IsReady(); })) return false;
+
+		int32 Matched = 0;
+		for (int32 Index = 0; Index < NumStandInEchoes; ++Index)
+		{
+			const TValueOrError<FEchoResponseData, FMgsError>& Response = (*Echoes)[Index].Get();
+			Matched += Response.HasValue() && Response.GetValue().Val == FString::Printf(TEXT("echo-%d"), Index) ? 1 : 0;
+		}
+		TestEqual(TEXT("Every echo answered with its own value"), Matched, NumStandInEchoes);
+		return true;
+	}, [Client, Echoes]()
+	{
+		int32 Ready = 0;
+		for (const FEchoFuture& Echo : *Echoes)
+		{
+			Ready += Echo.IsReady() ? 1 : 0;
+		}
+		return FString::Printf(TEXT("connected %d, %d of %d echoes sent, %d answered"), Client->IsConnected(), Echoes->Num(), NumStandInEchoes, Ready);
+	}, 30.0));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingRequestTableThroughputTest, "WebSocketTest.PendingRequestTable.Throughput", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingRequestTableThroughputTest::RunTest(const FString& Parameters)
+{
+	// The same load on the ring and on the locked map it replaced, from a few threads to many more than cores
+	for (const int32 Pairs : {2, 8, 32})
+	{
+		TPendingRequestTable<int32> Ring(4096);
+		const double RingPerSecond = MeasureRoundTripsPerSecond(Ring, Pairs);
+		FLockedPendingMap Locked;
+		const double LockedPerSecond = MeasureRoundTripsPerSecond(Locked, Pairs);
+
+		AddInfo(FString::Printf(TEXT("%d requesters and %d responders: ring %.0f round trips/s, locked map %.0f round trips/s (%.2fx)"),
+			Pairs, Pairs, RingPerSecond, LockedPerSecond, LockedPerSecond > 0.0 ? RingPerSecond / LockedPerSecond : 0.0));
+		TestTrue(TEXT("Ring made progress"), RingPerSecond > 0.0);
+		TestTrue(TEXT("Locked map made progress"), LockedPerSecond > 0.0);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "Misc/AutomationTest.h"
+#include "WebSocketClient.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FReconnectBackoffTest, "WebSocketTest.ReconnectBackoff.Bounds", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FReconnectBackoffTest::RunTest(const FString& Parameters)
+{
+	constexpr float BaseDelay = 0.5f;
+	constexpr float MaxDelay = 30.0f;
+	constexpr int32 Draws = 2000;
+
+	// Attempts past the cap, and far enough past it that an unclamped 2^attempt would overflow
+	for (const int32 Attempt : {0, 1, 3, 5, 6, 10, 64})
+	{
+		const float Ceiling = FMath::Min(MaxDelay, BaseDelay * FMath::Pow(2.0f, Attempt));
+		float Min = TNumericLimits<float>::Max();
+		float Max = 0.0f;
+		double Sum = 0.0;
+		for (int32 Draw = 0; Draw < Draws; ++Draw)
+		{
+			const float Delay = FWebSocketClient::DrawReconnectDelay(BaseDelay, MaxDelay, Attempt);
+			Min = FMath::Min(Min, Delay);
+			Max = FMath::Max(Max, Delay);
+			Sum += Delay;
+		}
+
+		// Full jitter spreads the whole range rather than clustering at the ceiling, which is what keeps clients apart
+		TestTrue(FString::Printf(TEXT("Attempt %d never negative"), Attempt), Min >= 0.0f);
+		TestTrue(FString::Printf(TEXT("Attempt %d never over the ceiling"), Attempt), Max <= Ceiling);
+		TestTrue(FString::Printf(TEXT("Attempt %d reaches the bottom of the range"), Attempt), Min < 0.1f * Ceiling);
+		TestTrue(FString::Printf(TEXT("Attempt %d reaches the top of the range"), Attempt), Max > 0.9f * Ceiling);
+		TestTrue(FString::Printf(TEXT("Attempt %d averages half the ceiling"), Attempt), FMath::Abs(Sum / Draws - 0.5 * Ceiling) < 0.1 * Ceiling);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include "Misc/AutomationTest.h"
+#include "RttEstimator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRttEstimatorConvergenceTest, "WebSocketTest.RttEstimator.Convergence", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRttEstimatorConvergenceTest::RunTest(const FString& Parameters)
+{
+	FRttEstimator Rtt;
+	TestTrue(TEXT("Fallback before any sample"), Rtt.GetTimeoutMs(4.0f, 50, 5000) == 5000);
+
+	// RFC 6298: the first sample sets SRTT to R and RTTVAR to R/2
+	Rtt.AddSample(100.0);
+	FWebSocketRttStats Stats = Rtt.GetStats();
+	TestEqual(TEXT("First SRTT"), Stats.SmoothedRttMs, 100.0);
+	TestEqual(TEXT("First RTTVAR"), Stats.RttVarianceMs, 50.0);
+	TestTrue(TEXT("First timeout is four round trips"), Rtt.GetTimeoutMs(4.0f, 50, 5000) == 400);
+
+	// A link that settles at 20ms pulls SRTT down to it and RTTVAR towards nothing, never overshooting
+	bool bMonotonic = true;
+	for (int32 Sample = 0; Sample < 40; ++Sample)
+	{
+		const double Previous = Rtt.GetStats().SmoothedRttMs;
+		Rtt.AddSample(20.0);
+		bMonotonic &= Rtt.GetStats().SmoothedRttMs < Previous && Rtt.GetStats().SmoothedRttMs > 20.0;
+	}
+	Stats = Rtt.GetStats();
+	TestTrue(TEXT("SRTT falls towards the new round trip"), bMonotonic);
+	TestTrue(TEXT("SRTT converged"), FMath::Abs(Stats.SmoothedRttMs - 20.0) < 1.0);
+	TestTrue(TEXT("RTTVAR converged"), Stats.RttVarianceMs < 2.0);
+	TestEqual(TEXT("Last sample"), Stats.LastRttMs, 20.0);
+	TestTrue(TEXT("Sample count"), Stats.Samples == 41);
+
+	// On a steady link the multiplier decides, and MinMs is the floor under it
+	TestTrue(TEXT("Multiplier on a steady link"), Rtt.GetTimeoutMs(4.0f, 50, 5000) == static_cast<uint32>(FMath::CeilToDouble(4.0 * Stats.SmoothedRttMs)));
+	TestTrue(TEXT("Never under MinMs"), Rtt.GetTimeoutMs(4.0f, 500, 5000) == 500);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRttEstimatorJitterTest, "WebSocketTest.RttEstimator.Jitter", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRttEstimatorJitterTest::RunTest(const FString& Parameters)
+{
+	// Round trips swinging between 10ms and 190ms: SRTT + 4 * RTTVAR outgrows four round trips and takes over
+	FRttEstimator Rtt;
+	for (int32 Sample = 0; Sample < 64; ++Sample)
+	{
+		Rtt.AddSample(Sample % 2 == 0 ? 10.0 : 190.0);
+	}
+	const FWebSocketRttStats Stats = Rtt.GetStats();
+	const uint32 Timeout = Rtt.GetTimeoutMs(4.0f, 50, 5000);
+	TestTrue(TEXT("Variance larger than on a steady link"), Stats.RttVarianceMs > 50.0);
+	TestTrue(TEXT("Variance rule on a jittery link"), Timeout == static_cast<uint32>(FMath::CeilToDouble(Stats.SmoothedRttMs + 4.0 * Stats.RttVarianceMs)));
+	TestTrue(TEXT("Longer than the multiplier alone"), Timeout > static_cast<uint32>(FMath::CeilToDouble(4.0 * Stats.SmoothedRttMs)));
+	TestTrue(TEXT("Covers the slowest round trip"), Timeout > 190);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRttEstimatorClockTest, "WebSocketTest.RttEstimator.Clock", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRttEstimatorClockTest::RunTest(const FString& Parameters)
+{
+	FRttEstimator Rtt;
+
+	// Sent at 1000, answered in 100ms with the server at 5050: it stamped the reply at our 1050, 4000ms ahead
+	Rtt.AddClockSample(1000.0, 100.0, 5050.0);
+	TestEqual(TEXT("First offset taken as is"), Rtt.GetStats().ClockOffsetMs, 4000.0);
+	Rtt.AddClockSample(2000.0, 100.0, 6850.0);
+	TestEqual(TEXT("Later offsets smoothed by 1/8"), Rtt.GetStats().ClockOffsetMs, 4100.0);
+
+	// After a failover the old link's samples say nothing about the new one
+	Rtt.AddSample(30.0);
+	Rtt.Reset();
+	TestTrue(TEXT("Samples forgotten"), Rtt.GetStats().Samples == 0);
+	TestTrue(TEXT("Fallback again"), Rtt.GetTimeoutMs(4.0f, 50, 5000) == 5000);
+	Rtt.AddClockSample(1000.0, 0.0, 900.0);
+	TestEqual(TEXT("Offset starts over"), Rtt.GetStats().ClockOffsetMs, -100.0);
+	return true;
+}
+
+#endif
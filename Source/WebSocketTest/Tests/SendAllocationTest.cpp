@@ -0,0 +1,305 @@
+#include "AllocationCounter.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+#include "Misc/AutomationTest.h"
+#include "PendingRequestTable.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	constexpr int32 NumSends = 100000;
+	constexpr int32 NumRoundTrips = 100000;
+	constexpr int32 NumWarmUpRoundTrips = 1000;
+	// Round trips through futures, only to show what the receivers save
+	constexpr int32 NumFutureRoundTrips = 10000;
+	constexpr int32 NumInFlight = 64;
+	constexpr int32 NumIdleFrames = 1000;
+	constexpr uint32 RoundTripPort = 18770;
+	constexpr double RoundTripTimeoutSeconds = 120.0;
+
+	// An echo with its own value, checked against the answer and sent again from the game loop once answered
+	class FEchoReceiver final : public TWebSocketResponseReceiver<FEchoResponseData>
+	{
+		public:
+		FEchoRequestData Request;
+		bool bInFlight = false;
+		int32 Answered = 0;
+		int32 Failed = 0;
+
+		protected:
+		virtual void OnResponse() override
+		{
+			bInFlight = false;
+			if (HasValue() && Data.Val == Request.Val)
+			{
+				++Answered;
+			}
+			else
+			{
+				++Failed;
+			}
+		}
+	};
+
+	class FIntCompletion final : public TPendingRequestCompletion<int32>
+	{
+		public:
+		int32 Completed = 0;
+
+		virtual void Complete(const int32& Result) override
+		{
+			Completed += Result;
+		}
+	};
+
+	/**
+	 * Runs the client's side of one frame, counted: the core ticker, which delivers socket events and runs the
+	 * client's timers, then game thread tasks. The stand-in server shares the thread, so it is ticked uncounted.
+	 */
+	void PumpFrame(FWebSocketStandInServer& Server, FAllocationCounter& Counter, double& LastTickTime)
+	{
+		const double Now = FPlatformTime::Seconds();
+		FTicker::GetCoreTicker().Tick(static_cast<float>(Now - LastTickTime));
+		LastTickTime = Now;
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		Counter.Pause();
+		Server.Tick();
+		Counter.Resume();
+	}
+
+	// Keeps every receiver busy until Count more echoes have been answered or have failed; returns the frames it took
+	int32 RunEchoes(FWebSocketStandInServer& Server, FWebSocketClient& Client, TArray<FEchoReceiver>& Receivers, const int32 Count, FAllocationCounter& Counter, double& LastTickTime)
+	{
+		int32 Sent = 0;
+		int32 Frames = 0;
+		const double Deadline = FPlatformTime::Seconds() + RoundTripTimeoutSeconds;
+		while (FPlatformTime::Seconds() < Deadline)
+		{
+			bool bAnyInFlight = false;
+			for (FEchoReceiver& Receiver : Receivers)
+			{
+				if (!Receiver.bInFlight && Sent < Count)
+				{
+					Receiver.bInFlight = true;
+					++Sent;
+					Client.SendNonBlocking(Receiver.Request, Receiver, 10000);
+				}
+				bAnyInFlight |= Receiver.bInFlight;
+			}
+			if (!bAnyInFlight) break;
+			PumpFrame(Server, Counter, LastTickTime);
+			++Frames;
+		}
+		return Frames;
+	}
+
+	// What is left per operation once Baseline has been taken off, never below zero
+	double PerOperation(const uint64 Total, const double Baseline, const int32 Operations)
+	{
+		return FMath::Max(static_cast<double>(Total) - Baseline, 0.0) / Operations;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRoundTripAllocationTest, "WebSocketTest.Allocations.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRoundTripAllocationTest::RunTest(const FString& Parameters)
+{
+	FWebSocketStandInServer Server;
+	if (!TestTrue(TEXT("Stand-in server started"), Server.Start(RoundTripPort)))
+	{
+		return false;
+	}
+
+	// Heartbeats would add allocations of their own on a timer, which have nothing to do with the echoes
+	FWebSocketConfiguration Config;
+	Config.Url = FWebSocketStandInServer::GetUrl(RoundTripPort);
+	Config.Endpoint_Cache_File = FString();
+	Config.Heartbeat_Interval_Ms = 0;
+	FWebSocketClient Client(Config);
+	Client.ConnectToServer();
+
+	// The test drives the frames itself, so everything the client does on this thread between sends is counted
+	double LastTickTime = FPlatformTime::Seconds();
+	FAllocationCounter Uncounted;
+	Uncounted.Pause();
+	const double ConnectDeadline = LastTickTime + 10.0;
+	while (!Client.IsConnected() && FPlatformTime::Seconds() < ConnectDeadline)
+	{
+		PumpFrame(Server, Uncounted, LastTickTime);
+	}
+	if (!TestTrue(TEXT("Connected to the stand-in server"), Client.IsConnected()))
+	{
+		Client.Quit();
+		return false;
+	}
+
+	TArray<FEchoReceiver> Receivers;
+	Receivers.SetNum(NumInFlight);
+	for (int32 Index = 0; Index < NumInFlight; ++Index)
+	{
+		Receivers[Index].Request.Val = FString::Printf(TEXT("echo-%03d-%s"), Index, *FString::ChrN(64, TEXT('x')));
+	}
+
+	// Fills the pools, the stats and the timer wheel's buckets, and lets the engine's sockets settle
+	RunEchoes(Server, Client, Receivers, NumWarmUpRoundTrips, Uncounted, LastTickTime);
+	Uncounted.Pause();
+
+	// Other tickers run in the same frames, so what idle frames cost is taken off
+	FAllocationCounter Idle;
+	for (int32 Frame = 0; Frame < NumIdleFrames; ++Frame)
+	{
+		PumpFrame(Server, Idle, LastTickTime);
+	}
+	Idle.Pause();
+	const double IdlePerFrame = static_cast<double>(Idle.Get().Allocations) / NumIdleFrames;
+
+	// The engine's socket copies every frame it is given into its own queue; Post allocates nothing of its own on the
+	// client, which Allocations.Codecs and the send path share, so what it costs is that copy
+	const uint64 PostFramesBefore = Client.GetOutboxStats().FramesSent;
+	FAllocationCounter Posts;
+	for (int32 Post = 0; Post < NumInFlight; ++Post)
+	{
+		Client.Post(Receivers[Post].Request);
+	}
+	Posts.Pause();
+	const uint64 PostFrames = Client.GetOutboxStats().FramesSent - PostFramesBefore;
+	const double SocketPerFrame = PostFrames > 0 ? static_cast<double>(Posts.Get().Allocations) / PostFrames : 0.0;
+	PumpFrame(Server, Uncounted, LastTickTime);
+	Uncounted.Pause();
+
+	for (FEchoReceiver& Receiver : Receivers)
+	{
+		Receiver.Answered = 0;
+		Receiver.Failed = 0;
+	}
+	const uint64 FramesBefore = Client.GetOutboxStats().FramesSent;
+	FAllocationCounter Counter;
+	const int32 Frames = RunEchoes(Server, Client, Receivers, NumRoundTrips, Counter, LastTickTime);
+	Counter.Pause();
+	const uint64 FramesSent = Client.GetOutboxStats().FramesSent - FramesBefore;
+
+	int32 Answered = 0;
+	int32 Failed = 0;
+	for (const FEchoReceiver& Receiver : Receivers)
+	{
+		Answered += Receiver.Answered;
+		Failed += Receiver.Failed;
+	}
+	TestEqual(TEXT("Every echo answered with its own value"), Answered, NumRoundTrips);
+	TestEqual(TEXT("No echo failed"), Failed, 0);
+
+	const FAllocationCount Total = Counter.Get();
+	const double PerRoundTrip = PerOperation(Total.Allocations, IdlePerFrame * Frames + SocketPerFrame * FramesSent, NumRoundTrips);
+	AddInfo(FString::Printf(TEXT("%llu allocations (%llu bytes) on the game thread over %d round trips in %d frames"), Total.Allocations, Total.Bytes, NumRoundTrips, Frames));
+	AddInfo(FString::Printf(TEXT("Baselines: %.2f allocations per idle frame, %.2f per frame handed to the socket (%llu frames)"), IdlePerFrame, SocketPerFrame, FramesSent));
+	AddInfo(FString::Printf(TEXT("%.4f allocations per round trip left to the client"), PerRoundTrip));
+	// Zero per request; the slack only absorbs other tickers that do not allocate in every frame
+	TestTrue(TEXT("No allocations per steady-state round trip"), PerRoundTrip < 0.01);
+
+	// The same echoes through futures, for comparison
+	TArray<TFuture<TValueOrError<FEchoResponseData, FMgsError>>> Futures;
+	Futures.Reserve(NumInFlight);
+	const uint64 FutureFramesBefore = Client.GetOutboxStats().FramesSent;
+	FAllocationCounter FutureCounter;
+	int32 FutureFrames = 0;
+	int32 FuturesAnswered = 0;
+	for (int32 Sent = 0; Sent < NumFutureRoundTrips; Sent += NumInFlight)
+	{
+		for (int32 Index = 0; Index < NumInFlight; ++Index)
+		{
+			Futures.Add(Client.SendNonBlocking(Receivers[Index].Request, 10000));
+		}
+		const double Deadline = FPlatformTime::Seconds() + RoundTripTimeoutSeconds;
+		while (Futures.ContainsByPredicate([](const TFuture<TValueOrError<FEchoResponseData, FMgsError>>& Future) { return !Future.IsReady(); })
+			&& FPlatformTime::Seconds() < Deadline)
+		{
+			PumpFrame(Server, FutureCounter, LastTickTime);
+			++FutureFrames;
+		}
+		for (const TFuture<TValueOrError<FEchoResponseData, FMgsError>>& Future : Futures)
+		{
+			FuturesAnswered += Future.IsReady() && Future.Get().HasValue() ? 1 : 0;
+		}
+		Futures.Reset();
+	}
+	FutureCounter.Pause();
+	const int32 NumFutures = FMath::DivideAndRoundUp(NumFutureRoundTrips, NumInFlight) * NumInFlight;
+	const uint64 FutureFramesSent = Client.GetOutboxStats().FramesSent - FutureFramesBefore;
+	TestEqual(TEXT("Every future answered"), FuturesAnswered, NumFutures);
+	AddInfo(FString::Printf(TEXT("Futures: %.2f allocations per round trip left to the client"), PerOperation(FutureCounter.Get().Allocations, IdlePerFrame * FutureFrames + SocketPerFrame * FutureFramesSent, NumFutures)));
+
+	Client.Quit();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCodecAllocationTest, "WebSocketTest.Allocations.Codecs", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCodecAllocationTest::RunTest(const FString& Parameters)
+{
+	// Writing an envelope into a buffer that already has room, as the send path and the outbox do, in either codec
+	FEchoRequestData Request;
+	Request.Val = FString::ChrN(256, TEXT('x'));
+	const FString IdempotencyKey = TEXT("client-1");
+	for (const IWebSocketCodec* Codec : {&IWebSocketCodec::Json(), &IWebSocketCodec::MsgPack()})
+	{
+		TArray<ANSICHAR> Buffer;
+		Codec->WriteRequest(1, true, TWebSocketMessage<FEchoRequestData>::GetMsgType(), IdempotencyKey, FEchoRequestData::StaticStruct(), &Request, Buffer);
+
+		const FAllocationCount Count = CountAllocations([Codec, &Request, &IdempotencyKey, &Buffer]()
+		{
+			for (uint64 Id = 1; Id <= static_cast<uint64>(NumSends); ++Id)
+			{
+				Buffer.Reset();
+				Codec->WriteRequest(Id, true, TWebSocketMessage<FEchoRequestData>::GetMsgType(), IdempotencyKey, FEchoRequestData::StaticStruct(), &Request, Buffer);
+			}
+		});
+		AddInfo(FString::Printf(TEXT("%s: %llu allocations over %d requests written"), Codec->GetName(), Count.Allocations, NumSends));
+		TestTrue(FString::Printf(TEXT("No allocations per request written in %s"), Codec->GetName()), Count.Allocations == 0);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPendingAllocationTest, "WebSocketTest.Allocations.Pending", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPendingAllocationTest::RunTest(const FString& Parameters)
+{
+	// A request added with a completion lives entirely in its preallocated slot
+	TPendingRequestTable<int32> Table(256);
+	FIntCompletion Completion;
+	for (uint64 Id = 1; Id <= 1000; ++Id)
+	{
+		Table.Add(Id, TNumericLimits<double>::Max(), Completion);
+		Table.Complete(Id, 1);
+	}
+
+	const FAllocationCount Count = CountAllocations([&Table, &Completion]()
+	{
+		for (uint64 Id = 1001; Id <= 1000 + static_cast<uint64>(NumSends); ++Id)
+		{
+			Table.Add(Id, TNumericLimits<double>::Max(), Completion);
+			Table.Complete(Id, 1);
+		}
+	});
+	AddInfo(FString::Printf(TEXT("%llu allocations over %d requests added and completed"), Count.Allocations, NumSends));
+	TestTrue(TEXT("No allocations per request"), Count.Allocations == 0);
+	TestEqual(TEXT("Every request completed"), Completion.Completed, 1000 + NumSends);
+
+	// One added with a future still allocates the promise's shared state, which UE 4.26 futures give no way to pool
+	TFuture<int32> Future;
+	const FAllocationCount FutureCount = CountAllocations([&Table, &Future]()
+	{
+		for (uint64 Id = 2001 + static_cast<uint64>(NumSends); Id <= 2000 + 2 * static_cast<uint64>(NumSends); ++Id)
+		{
+			Table.Add(Id, TNumericLimits<double>::Max(), Future);
+			Table.Complete(Id, 1);
+			Future = TFuture<int32>();
+		}
+	});
+	AddInfo(FString::Printf(TEXT("Futures: %llu allocations over %d requests added and completed"), FutureCount.Allocations, NumSends));
+	return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Drives a test against stand-in servers a frame at a time: every update ticks the servers, dispatches the client's
+ * pushes and calls Step, until Step returns true or TimeoutSeconds pass. The sockets and the client's tickers only
+ * make progress between updates. Either way the client quits at the end; Describe says how far the test got when it
+ * times out.
+ */
+class FStandInTestCommand : public IAutomationLatentCommand
+{
+	public:
+	FStandInTestCommand(FAutomationTestBase* InTest, const TArray<TSharedRef<FWebSocketStandInServer>>& InServers, const TSharedPtr<FWebSocketClient>& InClient, TFunction<bool()> InStep, TFunction<FString()> InDescribe, const double InTimeoutSeconds = 10.0)
+		: Test(InTest), Servers(InServers), Client(InClient), Step(MoveTemp(InStep)), Describe(MoveTemp(InDescribe)), TimeoutSeconds(InTimeoutSeconds)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		for (const TSharedRef<FWebSocketStandInServer>& Server : Servers)
+		{
+			Server->Tick();
+		}
+		if (Client.IsValid())
+		{
+			Client->DispatchPushMessages();
+		}
+
+		if (GetCurrentRunTime() > TimeoutSeconds)
+		{
+			Test->AddError(FString::Printf(TEXT("Stand-in test timed out: %s"), *Describe()));
+		}
+		else if (!Step())
+		{
+			return false;
+		}
+
+		if (Client.IsValid())
+		{
+			Client->Quit();
+		}
+		return true;
+	}
+
+	private:
+	FAutomationTestBase* Test;
+	// Members go in reverse order, so whatever Step holds on to goes first, then the client, then its servers
+	TArray<TSharedRef<FWebSocketStandInServer>> Servers;
+	TSharedPtr<FWebSocketClient> Client;
+	TFunction<bool()> Step;
+	TFunction<FString()> Describe;
+	const double TimeoutSeconds;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "Misc/AutomationTest.h"
+#include "StandInTestCommand.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	constexpr int32 PoolSize = 4;
+	constexpr int32 NumRequests = 64;
+	constexpr int32 NumShards = 8;
+
+	FString GetShardKey(const int32 Index)
+	{
+		return FString::Printf(TEXT("player-%d"), Index % NumShards);
+	}
+
+	// Echoes each socket should carry, smallest first, since the server cannot tell which socket of the pool is which
+	TArray<uint64> GetExpectedSpread(const EPoolRouting Routing)
+	{
+		TArray<uint64> Spread;
+		Spread.SetNumZeroed(PoolSize);
+		for (int32 Index = 0; Index < NumRequests; ++Index)
+		{
+			// The burst goes out in one frame, so no echo resolves in between and least-in-flight deals them round
+			const int32 Connection = Routing == EPoolRouting::ShardKey
+				? static_cast<int32>(GetTypeHash(GetShardKey(Index)) % static_cast<uint32>(PoolSize))
+				: Index % PoolSize;
+			++Spread[Connection];
+		}
+		Spread.Sort();
+		return Spread;
+	}
+
+	/**
+	 * Opens a pool to the stand-in server and, once every socket is up, puts a burst of echoes on it at once. Ids are
+	 * shared by the pool, so each echo must come back with its own value whichever socket it went out on, and the
+	 * server must have seen them spread over the sockets as the routing says.
+	 */
+	bool StartPool(FAutomationTestBase* Test, const EPoolRouting Routing, const uint32 Port)
+	{
+		const TSharedRef<FWebSocketStandInServer> Server = MakeShared<FWebSocketStandInServer>();
+		if (!Test->TestTrue(TEXT("Stand-in server started"), Server->Start(Port)))
+		{
+			return false;
+		}
+
+		FWebSocketConfiguration Config;
+		Config.Url = FWebSocketStandInServer::GetUrl(Port);
+		Config.Endpoint_Cache_File = FString();
+		Config.Pool_Size = PoolSize;
+		Config.Pool_Routing = Routing;
+		// A heartbeat in flight would skew least-in-flight routing of the burst
+		Config.Heartbeat_Interval_Ms = 0;
+		const TSharedRef<FWebSocketClient> Client = MakeShared<FWebSocketClient>(Config);
+		Client->ConnectToServer();
+
+		const TSharedRef<TArray<TFuture<TValueOrError<FEchoResponseData, FMgsError>>>> Echoes = MakeShared<TArray<TFuture<TValueOrError<FEchoResponseData, FMgsError>>>>();
+		ADD_LATENT_AUTOMATION_COMMAND(FStandInTestCommand(Test, {Server}, Client, [Test, Server, Client, Echoes, Routing, Port]()
+		{
+			if (Echoes->Num() == 0)
+			{
+				if (Server->GetNumClients() < PoolSize || !Client->IsConnected()) return false;
+
+				for (int32 Index = 0; Index < NumRequests; ++Index)
+				{
+					FEchoRequestData Request;
+					Request.Val = FString::Printf(TEXT("echo-%d"), Index);
+					const FString ShardKey = Routing == EPoolRouting::ShardKey ? GetShardKey(Index) : FString();
+					Echoes->Add(Client->SendNonBlocking(Request, 5000, EResendPolicy::Resend, FRequestCancellationToken(), ShardKey));
+				}
+				return false;
+			}
+			for (const TFuture<TValueOrError<FEchoResponseData, FMgsError>>& Echo : *Echoes)
+			{
+				if (!Echo.IsReady()) return false;
+			}
+
+			int32 Matched = 0;
+			for (int32 Index = 0; Index < NumRequests; ++Index)
+			{
+				const TValueOrError<FEchoResponseData, FMgsError>& Response = (*Echoes)[Index].Get();
+				Matched += Response.HasValue() && Response.GetValue().Val == FString::Printf(TEXT("echo-%d"), Index) ? 1 : 0;
+			}
+			Test->TestEqual(TEXT("Every echo answered with its own value"), Matched, NumRequests);
+			Test->TestTrue(TEXT("Server saw every echo"), Server->GetRequestsHandled() >= static_cast<uint64>(NumRequests));
+			for (int32 Connection = 0; Connection < PoolSize; ++Connection)
+			{
+				Test->TestEqual(TEXT("Pooled socket on the configured endpoint"), Client->GetEndpoint(Connection), FWebSocketStandInServer::GetUrl(Port));
+			}
+
+			TArray<uint64> Spread = Server->GetEchoesPerClient();
+			Spread.Sort();
+			const TArray<uint64> Expected = GetExpectedSpread(Routing);
+			Test->TestEqual(TEXT("One server socket per pooled socket"), Spread.Num(), PoolSize);
+			Test->TestTrue(TEXT("Echoes spread over the sockets as routed"), Spread == Expected);
+			Test->TestTrue(TEXT("More than one socket carried echoes"), Expected.Num() > 1 && Expected[Expected.Num() - 2] > 0);
+			for (int32 Connection = 0; Connection < Spread.Num(); ++Connection)
+			{
+				Test->AddInfo(FString::Printf(TEXT("Socket %d carried %llu echoes"), Connection, Spread[Connection]));
+			}
+			return true;
+		}, [Server, Echoes]()
+		{
+			return FString::Printf(TEXT("%d of %d sockets open, %d echoes sent"), Server->GetNumClients(), PoolSize, Echoes->Num());
+		}));
+		return true;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketClientPoolLeastInFlightTest, "WebSocketTest.Pool.LeastInFlight", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketClientPoolLeastInFlightTest::RunTest(const FString& Parameters)
+{
+	return StartPool(this, EPoolRouting::LeastInFlight, 18766);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketClientPoolShardKeyTest, "WebSocketTest.Pool.ShardKey", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketClientPoolShardKeyTest::RunTest(const FString& Parameters)
+{
+	return StartPool(this, EPoolRouting::ShardKey, 18767);
+}
+
+#endif
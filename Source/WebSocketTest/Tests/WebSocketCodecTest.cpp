@@ -0,0 +1,290 @@
+#include "Misc/AutomationTest.h"
+#include "WebSocketBenchmarkCommandlet.h"
+#include "WebSocketClient.h"
+#include "WebSocketCodec.h"
+#include "WebSocketResponse.h"
+#include "WebSocketStandInServer.h"
+#include "WebSocketStructs.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const IWebSocketCodec* const Codecs[] = {&IWebSocketCodec::Json(), &IWebSocketCodec::MsgPack()};
+
+	template <typename T>
+	bool DecodeRequestData(const IWebSocketCodec& Codec, const TArray<ANSICHAR>& Frame, const FWebSocketRequestHeader& Request, T& OutData)
+	{
+		return Request.DataStart != INDEX_NONE && Codec.DecodeData(Frame.GetData() + Request.DataStart, Request.DataLength, T::StaticStruct(), &OutData);
+	}
+
+	TArray<ANSICHAR> MakeFrame(std::initializer_list<uint8> Bytes)
+	{
+		TArray<ANSICHAR> Frame;
+		for (const uint8 Byte : Bytes)
+		{
+			Frame.Add(static_cast<ANSICHAR>(Byte));
+		}
+		return Frame;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketCodecRequestRoundTripTest, "WebSocketTest.Codec.RequestRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketCodecRequestRoundTripTest::RunTest(const FString& Parameters)
+{
+	for (const IWebSocketCodec* Codec : Codecs)
+	{
+		const FString Prefix = Codec->GetName();
+
+		FEchoRequestData Echo;
+		Echo.Val = TEXT("caf\u00e9 \"quoted\" \U0001F600");
+		TArray<ANSICHAR> Frame;
+		Codec->WriteRequest(TNumericLimits<uint32>::Max() + uint64(5), true, TWebSocketMessage<FEchoRequestData>::GetMsgType(), TEXT("key-1"), FEchoRequestData::StaticStruct(), &Echo, Frame);
+
+		FWebSocketRequestHeader Request;
+		FEchoRequestData Decoded;
+		TestTrue(Prefix + TEXT(" scan"), Codec->ScanRequest(Frame.GetData(), Frame.Num(), Request));
+		TestTrue(Prefix + TEXT(" 64-bit id"), Request.Id == TNumericLimits<uint32>::Max() + uint64(5));
+		TestTrue(Prefix + TEXT(" ack"), Request.bAck);
+		TestEqual(Prefix + TEXT(" msgType"), Request.MsgType, FString(TEXT("Echo")));
+		TestEqual(Prefix + TEXT(" key"), Request.IdempotencyKey, FString(TEXT("key-1")));
+		TestTrue(Prefix + TEXT(" decode"), DecodeRequestData(*Codec, Frame, Request, Decoded));
+		TestEqual(Prefix + TEXT(" data"), Decoded.Val, Echo.Val);
+
+		// Doubles such as clock samples must come back bit for bit
+		FHeartbeatRequestData Heartbeat;
+		Heartbeat.ClientTime = 1700000000123.456;
+		Frame.Reset();
+		Codec->WriteRequest(1, false, TWebSocketMessage<FHeartbeatRequestData>::GetMsgType(), FString(), FHeartbeatRequestData::StaticStruct(), &Heartbeat, Frame);
+		FWebSocketRequestHeader HeartbeatRequest;
+		FHeartbeatRequestData DecodedHeartbeat;
+		TestTrue(Prefix + TEXT(" scan heartbeat"), Codec->ScanRequest(Frame.GetData(), Frame.Num(), HeartbeatRequest));
+		TestFalse(Prefix + TEXT(" no ack"), HeartbeatRequest.bAck);
+		TestTrue(Prefix + TEXT(" no key"), HeartbeatRequest.IdempotencyKey.IsEmpty());
+		TestTrue(Prefix + TEXT(" decode heartbeat"), DecodeRequestData(*Codec, Frame, HeartbeatRequest, DecodedHeartbeat));
+		TestTrue(Prefix + TEXT(" double"), DecodedHeartbeat.ClientTime == Heartbeat.ClientTime);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketCodecResponseRoundTripTest, "WebSocketTest.Codec.ResponseRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketCodecResponseRoundTripTest::RunTest(const FString& Parameters)
+{
+	for (const IWebSocketCodec* Codec : Codecs)
+	{
+		const FString Prefix = Codec->GetName();
+
+		FDebugLoginResponseData Login;
+		Login.Id = TEXT("user-1");
+		Login.Name = TEXT("N\u00e4me");
+		Login.Created = TEXT("2020-01-01T00:00:00.000Z");
+		TArray<ANSICHAR> Frame;
+		Codec->WriteResponse(9, TEXT("DebugLogin"), FDebugLoginResponseData::StaticStruct(), &Login, Frame);
+
+		FWebSocketResponse Response;
+		TestTrue(Prefix + TEXT(" detected"), &IWebSocketCodec::Detect(Frame.GetData(), Frame.Num()) == Codec);
+		TestTrue(Prefix + TEXT(" scan"), Response.Scan(*Codec, Frame.GetData(), Frame.Num()));
+		TestTrue(Prefix + TEXT(" id"), Response.Id == 9);
+		TestEqual(Prefix + TEXT(" event"), Response.Event, FString(TEXT("DebugLogin")));
+		Response.Retain(Frame.GetData(), Frame.Num());
+		FDebugLoginResponseData Decoded;
+		TestTrue(Prefix + TEXT(" decode"), Response.DecodeData(Decoded));
+		TestEqual(Prefix + TEXT(" name"), Decoded.Name, Login.Name);
+		TestEqual(Prefix + TEXT(" created"), Decoded.Created, Login.Created);
+
+		// A push without data
+		Frame.Reset();
+		Codec->WriteResponse(0, TEXT("Ping"), nullptr, nullptr, Frame);
+		FWebSocketResponse Push;
+		TestTrue(Prefix + TEXT(" scan push"), Push.Scan(*Codec, Frame.GetData(), Frame.Num()));
+		TestTrue(Prefix + TEXT(" push id"), Push.Id == 0);
+		TestTrue(Prefix + TEXT(" push has no data"), Push.DataStart == INDEX_NONE);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketCodecBatchTest, "WebSocketTest.Codec.Batch", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketCodecBatchTest::RunTest(const FString& Parameters)
+{
+	for (const IWebSocketCodec* Codec : Codecs)
+	{
+		const FString Prefix = Codec->GetName();
+
+		TArray<ANSICHAR> Frame;
+		Codec->BeginBatch(Frame);
+		for (uint64 Id = 1; Id <= 3; ++Id)
+		{
+			if (Id > 1)
+			{
+				Codec->WriteBatchSeparator(Frame);
+			}
+			FEchoRequestData Echo;
+			Echo.Val = LexToString(Id);
+			Codec->WriteRequest(Id, true, TWebSocketMessage<FEchoRequestData>::GetMsgType(), FString(), FEchoRequestData::StaticStruct(), &Echo, Frame);
+		}
+		Codec->EndBatch(3, Frame);
+
+		TArray<uint64> Ids;
+		TestTrue(Prefix + TEXT(" is a batch"), Codec->SplitBatch(Frame.GetData(), Frame.Num(), [this, Codec, &Ids, &Prefix](const ANSICHAR* Message, const int32 Length)
+		{
+			FWebSocketRequestHeader Request;
+			TestTrue(Prefix + TEXT(" scan batched request"), Codec->ScanRequest(Message, Length, Request));
+			Ids.Add(Request.Id);
+		}));
+		TestTrue(Prefix + TEXT(" every request in order"), Ids == TArray<uint64>({1, 2, 3}));
+
+		// A single request is not mistaken for a batch
+		TArray<ANSICHAR> Single;
+		FEchoRequestData Echo;
+		Codec->WriteRequest(4, true, TWebSocketMessage<FEchoRequestData>::GetMsgType(), FString(), FEchoRequestData::StaticStruct(), &Echo, Single);
+		TestFalse(Prefix + TEXT(" single request"), Codec->SplitBatch(Single.GetData(), Single.Num(), [](const ANSICHAR*, int32) {}));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketCodecDetectTest, "WebSocketTest.Codec.Detect", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketCodecDetectTest::RunTest(const FString& Parameters)
+{
+	const TArray<ANSICHAR> Json = MakeFrame({'{', '}'});
+	const TArray<ANSICHAR> Bom = MakeFrame({0xef, 0xbb, 0xbf, '{', '}'});
+	const TArray<ANSICHAR> MsgPack = MakeFrame({0x80});
+	TestTrue(TEXT("JSON"), &IWebSocketCodec::Detect(Json.GetData(), Json.Num()) == &IWebSocketCodec::Json());
+	TestTrue(TEXT("JSON after a byte order mark"), &IWebSocketCodec::Detect(Bom.GetData(), Bom.Num()) == &IWebSocketCodec::Json());
+	TestTrue(TEXT("MessagePack"), &IWebSocketCodec::Detect(MsgPack.GetData(), MsgPack.Num()) == &IWebSocketCodec::MsgPack());
+	TestTrue(TEXT("Empty frame"), &IWebSocketCodec::Detect(nullptr, 0) == &IWebSocketCodec::Json());
+
+	const ANSICHAR* Data = Bom.GetData();
+	int32 Length = Bom.Num();
+	IWebSocketCodec::SkipByteOrderMark(Data, Length);
+	TestTrue(TEXT("Byte order mark skipped"), Data == Bom.GetData() + 3 && Length == 2);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketCodecMalformedTest, "WebSocketTest.Codec.Malformed", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketCodecMalformedTest::RunTest(const FString& Parameters)
+{
+	const IWebSocketCodec& Codec = IWebSocketCodec::MsgPack();
+
+	// Five bytes claiming some four billion entries must be refused before anything is reserved for them
+	const TArray<ANSICHAR> Map32 = MakeFrame({0xdf, 0xff, 0xff, 0xff, 0xff});
+	FWebSocketResponse Response;
+	TestFalse(TEXT("Oversized map header"), Response.Scan(Codec, Map32.GetData(), Map32.Num()));
+	FEchoResponseData Data;
+	TestFalse(TEXT("Oversized map as data"), Codec.DecodeData(Map32.GetData(), Map32.Num(), FEchoResponseData::StaticStruct(), &Data));
+
+	const TArray<ANSICHAR> Array32 = MakeFrame({0xdd, 0xff, 0xff, 0xff, 0xff});
+	int32 Visited = 0;
+	Codec.SplitBatch(Array32.GetData(), Array32.Num(), [&Visited](const ANSICHAR*, int32) { ++Visited; });
+	TestEqual(TEXT("Oversized batch header"), Visited, 0);
+
+	// A string running past the end of the frame
+	const TArray<ANSICHAR> String = MakeFrame({0x81, 0xa2, 'i', 'd', 0xa5, 'a'});
+	FWebSocketResponse Truncated;
+	TestFalse(TEXT("Truncated string"), Truncated.Scan(Codec, String.GetData(), String.Num()));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketCodecComparisonTest, "WebSocketTest.Codec.Comparison", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketCodecComparisonTest::RunTest(const FString& Parameters)
+{
+	// Reports frame size and encode and decode time per codec for small and large echoes
+	constexpr int32 Iterations = 2000;
+	for (const int32 PayloadBytes : {16, 1024})
+	{
+		FEchoRequestData Echo;
+		Echo.Val = FString::ChrN(PayloadBytes, TEXT('a'));
+		int32 Sizes[UE_ARRAY_COUNT(Codecs)] = {};
+		for (int32 Index = 0; Index < UE_ARRAY_COUNT(Codecs); ++Index)
+		{
+			const IWebSocketCodec& Codec = *Codecs[Index];
+			TArray<ANSICHAR> Frame;
+			const double EncodeStart = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				Frame.Reset();
+				Codec.WriteRequest(Iteration + 1, true, TWebSocketMessage<FEchoRequestData>::GetMsgType(), FString(), FEchoRequestData::StaticStruct(), &Echo, Frame);
+			}
+			const double EncodeUs = (FPlatformTime::Seconds() - EncodeStart) * 1000000.0 / Iterations;
+
+			FEchoRequestData Decoded;
+			const double DecodeStart = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				FWebSocketRequestHeader Request;
+				Codec.ScanRequest(Frame.GetData(), Frame.Num(), Request);
+				Codec.DecodeData(Frame.GetData() + Request.DataStart, Request.DataLength, FEchoRequestData::StaticStruct(), &Decoded);
+			}
+			const double DecodeUs = (FPlatformTime::Seconds() - DecodeStart) * 1000000.0 / Iterations;
+
+			TestEqual(FString(Codec.GetName()) + TEXT(" decodes"), Decoded.Val, Echo.Val);
+			Sizes[Index] = Frame.Num();
+			AddInfo(FString::Printf(TEXT("%s, %d byte payload: %d byte frame, %.2fus encode, %.2fus decode"), Codec.GetName(), PayloadBytes, Frame.Num(), EncodeUs, DecodeUs));
+		}
+		TestTrue(FString::Printf(TEXT("MessagePack no larger than JSON at %d bytes"), PayloadBytes), Sizes[1] <= Sizes[0]);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketCodecStandInRoundTripTest, "WebSocketTest.Codec.StandInRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketCodecStandInRoundTripTest::RunTest(const FString& Parameters)
+{
+	// The stand-in server cannot negotiate, so each client is held to one codec, which the server answers in
+	constexpr uint32 FirstPort = 18782;
+	constexpr int32 PayloadBytes = 1024;
+	double BytesPerFrame[UE_ARRAY_COUNT(Codecs)] = {};
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(Codecs); ++Index)
+	{
+		const IWebSocketCodec& Codec = *Codecs[Index];
+		FWebSocketStandInServer Server;
+		if (!TestTrue(TEXT("Stand-in server started"), Server.Start(FirstPort + Index)))
+		{
+			return false;
+		}
+
+		FWebSocketConfiguration Config;
+		Config.Url = FWebSocketStandInServer::GetUrl(FirstPort + Index);
+		Config.Endpoint_Cache_File = FString();
+		Config.Heartbeat_Interval_Ms = 0;
+		Config.Codecs = {Codec.GetName()};
+		Config.Negotiate_Codecs = false;
+		FWebSocketClient Client(Config);
+		Client.ConnectToServer();
+
+		double LastTickTime = FPlatformTime::Seconds();
+		const double ConnectDeadline = LastTickTime + 10.0;
+		while (!Client.IsConnected() && FPlatformTime::Seconds() < ConnectDeadline)
+		{
+			UWebSocketBenchmarkCommandlet::PumpFrame(Server, LastTickTime);
+		}
+		if (!TestTrue(FString::Printf(TEXT("%s client connected"), Codec.GetName()), Client.IsConnected()))
+		{
+			Client.Quit();
+			return false;
+		}
+
+		const FWebSocketClientStats Before = Client.GetStats();
+		const FWebSocketBenchmarkRun Run = UWebSocketBenchmarkCommandlet::RunEchoes(Server, Client, EWebSocketEchoWait::Promise, 1, 1, PayloadBytes, 1.0, LastTickTime);
+		const FWebSocketClientStats After = Client.GetStats();
+		Client.Quit();
+
+		const uint64 Frames = (After.FramesSent - Before.FramesSent) + (After.FramesReceived - Before.FramesReceived);
+		const uint64 Bytes = (After.BytesSent - Before.BytesSent) + (After.BytesReceived - Before.BytesReceived);
+		BytesPerFrame[Index] = Frames > 0 ? static_cast<double>(Bytes) / Frames : 0.0;
+		AddInfo(FString::Printf(TEXT("%s, %d byte echoes: %.1f bytes per frame, round trip p50 %.3fms p99 %.3fms over %llu echoes"),
+			Codec.GetName(), PayloadBytes, BytesPerFrame[Index], Run.P50Ms, Run.P99Ms, Run.Requests));
+		TestTrue(FString::Printf(TEXT("%s echoes answered"), Codec.GetName()), Run.Requests > 0);
+		TestTrue(FString::Printf(TEXT("No %s echo failed"), Codec.GetName()), Run.Errors == 0);
+	}
+	// Only the envelope and keys differ for a string payload, but that is enough to tell the codecs apart on the wire
+	TestTrue(TEXT("MessagePack frames smaller than JSON"), BytesPerFrame[1] < BytesPerFrame[0]);
+	return true;
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "AllocationCounter.h"
+#include "JsonObjectConverter.h"
+#include "Misc/AutomationTest.h"
+#include "WebSocketResponse.h"
+#include "WebSocketStructs.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// A receive buffer as the socket hands it over: UTF-8 bytes, not terminated, with stale bytes after the frame
+	TArray<ANSICHAR> MakeReceiveBuffer(const FString& Frame, const ANSICHAR* Trailing)
+	{
+		const FTCHARToUTF8 Utf8(*Frame);
+		TArray<ANSICHAR> Buffer;
+		Buffer.Append(Utf8.Get(), Utf8.Length());
+		Buffer.Append(Trailing, FCStringAnsi::Strlen(Trailing));
+		return Buffer;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketResponseRawUtf8Test, "WebSocketTest.WebSocketResponse.RawUtf8", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketResponseRawUtf8Test::RunTest(const FString& Parameters)
+{
+	const FString Frame = TEXT("{\"id\":12,\"event\":\"Echo\",\"data\":{\"val\":\"gr\u00fc\u00dfe \u2713 \U0001F600\"}}");
+	TArray<ANSICHAR> Buffer = MakeReceiveBuffer(Frame, ",\"id\":99}");
+	const int32 Length = FTCHARToUTF8(*Frame).Length();
+
+	FWebSocketResponse Response;
+	TestTrue(TEXT("Scan"), Response.Scan(IWebSocketCodec::Json(), Buffer.GetData(), Length));
+	TestTrue(TEXT("Id"), Response.Id == 12);
+	TestEqual(TEXT("Event"), Response.Event, FString(TEXT("Echo")));
+	TestTrue(TEXT("Nothing copied by the scan"), Response.Frame.Num() == 0);
+
+	// The socket reuses its buffer for the next frame, so only a retained copy may be decoded later
+	Response.Retain(Buffer.GetData(), Length);
+	FMemory::Memset(Buffer.GetData(), 'x', Buffer.Num());
+	FEchoResponseData Data;
+	TestTrue(TEXT("Decode"), Response.DecodeData(Data));
+	TestEqual(TEXT("Multi-byte characters decoded"), Data.Val, FString(TEXT("gr\u00fc\u00dfe \u2713 \U0001F600")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketResponseNoDataTest, "WebSocketTest.WebSocketResponse.NoData", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketResponseNoDataTest::RunTest(const FString& Parameters)
+{
+	const TArray<ANSICHAR> Buffer = MakeReceiveBuffer(TEXT("{\"id\":3,\"event\":\"Error\"}"), "");
+
+	FWebSocketResponse Response;
+	TestTrue(TEXT("Scan"), Response.Scan(IWebSocketCodec::Json(), Buffer.GetData(), Buffer.Num()));
+	TestTrue(TEXT("Error event"), Response.IsError());
+	Response.Retain(Buffer.GetData(), Buffer.Num());
+	FMgsError Error;
+	TestFalse(TEXT("Nothing to decode"), Response.DecodeData(Error));
+
+	// Cut short mid-frame, as a fragment would be if reassembly went wrong
+	FWebSocketResponse Truncated;
+	TestFalse(TEXT("Truncated frame is rejected"), Truncated.Scan(IWebSocketCodec::Json(), Buffer.GetData(), Buffer.Num() / 2));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketResponseReceiveCostTest, "WebSocketTest.WebSocketResponse.ReceiveCost", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketResponseReceiveCostTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumFrames = 10000;
+	const FString Frame = FString::Printf(TEXT("{\"id\":12,\"event\":\"Echo\",\"data\":{\"val\":\"%s\"}}"), *FString::ChrN(256, TEXT('x')));
+	const TArray<ANSICHAR> Buffer = MakeReceiveBuffer(Frame, "");
+
+	// What every frame used to cost from OnMessage on: the socket's UTF-8 widened into an FString, parsed into a
+	// DOM, then converted into the waiter's struct
+	const auto ReceiveString = [&Buffer]()
+	{
+		const FUTF8ToTCHAR Converted(Buffer.GetData(), Buffer.Num());
+		const FString Message(Converted.Length(), Converted.Get());
+		TSharedPtr<FJsonObject> Object;
+		FEchoResponseData Data;
+		if (FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Message), Object) && Object->GetIntegerField(TEXT("id")) != 0)
+		{
+			FJsonObjectConverter::JsonObjectToUStruct(Object->GetObjectField(TEXT("data")).ToSharedRef(), &Data);
+		}
+		return Data.Val.Len();
+	};
+
+	// What OnRawMessage costs now: the envelope scanned in place, the frame retained and decoded into a pooled
+	// response and a reused struct
+	FWebSocketResponse Response;
+	FEchoResponseData Data;
+	const auto ReceiveRaw = [&Buffer, &Response, &Data]()
+	{
+		if (Response.Scan(IWebSocketCodec::Json(), Buffer.GetData(), Buffer.Num()) && Response.Id != 0)
+		{
+			Response.Retain(Buffer.GetData(), Buffer.Num());
+			Response.DecodeData(Data);
+		}
+		return Data.Val.Len();
+	};
+
+	TestEqual(TEXT("Both paths decode the same value"), ReceiveRaw(), ReceiveString());
+	const FAllocationCount String = CountAllocations([&ReceiveString]()
+	{
+		for (int32 Index = 0; Index < NumFrames; ++Index)
+		{
+			ReceiveString();
+		}
+	});
+	const FAllocationCount Raw = CountAllocations([&ReceiveRaw]()
+	{
+		for (int32 Index = 0; Index < NumFrames; ++Index)
+		{
+			ReceiveRaw();
+		}
+	});
+
+	AddInfo(FString::Printf(TEXT("%d-byte frame: OnMessage path %.2f allocations (%.0f bytes), raw path %.2f allocations (%.0f bytes) per frame"),
+		Buffer.Num(), static_cast<double>(String.Allocations) / NumFrames, static_cast<double>(String.Bytes) / NumFrames,
+		static_cast<double>(Raw.Allocations) / NumFrames, static_cast<double>(Raw.Bytes) / NumFrames));
+	TestTrue(TEXT("No allocations per frame on the raw path"), Raw.Allocations == 0);
+	TestTrue(TEXT("Fewer allocations than the OnMessage path"), Raw.Allocations < String.Allocations);
+	return true;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "Misc/AutomationTest.h"
+#include "StandInTestCommand.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	constexpr uint32 StandInPort = 18765;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWebSocketStandInServerEchoTest, "WebSocketTest.StandInServer.Echo", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWebSocketStandInServerEchoTest::RunTest(const FString& Parameters)
+{
+	const TSharedRef<FWebSocketStandInServer> Server = MakeShared<FWebSocketStandInServer>(0.05f);
+	if (!TestTrue(TEXT("Stand-in server started"), Server->Start(StandInPort)))
+	{
+		return false;
+	}
+
+	FWebSocketConfiguration Config;
+	Config.Url = FWebSocketStandInServer::GetUrl(StandInPort);
+	Config.Endpoint_Cache_File = FString();
+	const TSharedRef<FWebSocketClient> Client = MakeShared<FWebSocketClient>(Config);
+	const TSharedRef<int32> Pushes = MakeShared<int32>(0);
+	Client->On<FChatMessage>(TEXT("ChatMessage"), [Pushes](const FChatMessage&)
+	{
+		++*Pushes;
+	});
+	Client->ConnectToServer();
+
+	// Connect, echo a request, then wait for a pushed chat message
+	const TSharedRef<TFuture<TValueOrError<FEchoResponseData, FMgsError>>> Echo = MakeShared<TFuture<TValueOrError<FEchoResponseData, FMgsError>>>();
+	ADD_LATENT_AUTOMATION_COMMAND(FStandInTestCommand(this, {Server}, Client, [this, Client, Pushes, Echo]()
+	{
+		if (!Echo->IsValid())
+		{
+			if (Client->IsConnected())
+			{
+				FEchoRequestData Request;
+				Request.Val = TEXT("stand-in");
+				*Echo = Client->SendNonBlocking(Request, 5000);
+			}
+			return false;
+		}
+		if (!Echo->IsReady() || *Pushes == 0) return false;
+
+		const TValueOrError<FEchoResponseData, FMgsError>& Response = Echo->Get();
+		if (TestTrue(TEXT("Echo answered"), Response.HasValue()))
+		{
+			TestEqual(TEXT("Echo value"), Response.GetValue().Val, FString(TEXT("stand-in")));
+		}
+		return true;
+	}, [Client, Pushes, Echo]()
+	{
+		return FString::Printf(TEXT("connected %d, echoed %d, pushes %d"), Client->IsConnected(), Echo->IsValid() && Echo->IsReady(), *Pushes);
+	}));
+	return true;
+}
+
+#endif
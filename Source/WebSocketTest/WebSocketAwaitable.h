@@ -0,0 +1,106 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "Async/Future.h"
+#include "Templates/ValueOrError.h"
+#include "WebSocketStructs.h"
+
+// Coroutine support needs C++20, e.g. CppStandard = CppStandardVersion.Latest in the module rules
+#ifndef WEBSOCKET_WITH_COROUTINES
+	#if defined(__cpp_impl_coroutine) && defined(__has_include)
+		#if __has_include(<coroutine>)
+			#define WEBSOCKET_WITH_COROUTINES 1
+		#endif
+	#endif
+#endif
+#ifndef WEBSOCKET_WITH_COROUTINES
+	#define WEBSOCKET_WITH_COROUTINES 0
+#endif
+
+#if WEBSOCKET_WITH_COROUTINES
+#include <coroutine>
+#include <exception>
+
+/**
+ * Fire-and-forget coroutine for request flows, e.g. login, then fetch the profile, then subscribe, written as
+ * straight-line code over FWebSocketClient::SendAwaitable. It starts running when called and frees itself when done.
+ */
+struct FWebSocketTask
+{
+	struct promise_type
+	{
+		FWebSocketTask get_return_object()
+		{
+			return {};
+		}
+
+		std::suspend_never initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		std::suspend_never final_suspend() noexcept
+		{
+			return {};
+		}
+
+		void return_void()
+		{
+		}
+
+		void unhandled_exception()
+		{
+			std::terminate();
+		}
+	};
+};
+
+/**
+ * Awaits a request sent by FWebSocketClient::SendAwaitable. No thread waits while it is in flight: whichever thread
+ * completes the request hands the resume to Dispatch, which queues it on the thread the caller asked for.
+ */
+template <typename TResponseData>
+class TWebSocketRequestAwaitable
+{
+	public:
+	using FResult = TValueOrError<TResponseData, FMgsError>;
+
+	using FDispatch = TFunction<void(TUniqueFunction<void()>&&)>;
+
+	TWebSocketRequestAwaitable(TFuture<FResult>&& InFuture, FDispatch&& InDispatch)
+		: Future(MoveTemp(InFuture)), Dispatch(MoveTemp(InDispatch))
+	{
+	}
+
+	bool await_ready() const
+	{
+		return false;
+	}
+
+	void await_suspend(const std::coroutine_handle<> Handle)
+	{
+		// The coroutine may resume, destroying this awaitable, as soon as the resume is queued, so the future and
+		// dispatch are moved out and nothing here is touched after Next
+		TFuture<FResult> Pending = MoveTemp(Future);
+		Pending.Next([this, Handle, Resume = MoveTemp(Dispatch)](const FResult& InResult)
+		{
+			Result.Emplace(InResult);
+			Resume([Handle]()
+			{
+				Handle.resume();
+			});
+		});
+	}
+
+	FResult await_resume()
+	{
+		return MoveTemp(Result.GetValue());
+	}
+
+	private:
+	TFuture<FResult> Future;
+	FDispatch Dispatch;
+	TOptional<FResult> Result;
+};
+#endif
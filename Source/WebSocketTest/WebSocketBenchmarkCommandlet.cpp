@@ -0,0 +1,302 @@
+#include "WebSocketBenchmarkCommandlet.h"
+#include "Async/Async.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+#include "LatencyHistogram.h"
+#include "Misc/FileHelper.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+namespace
+{
+	// Traffic before each run is measured, so first-use costs and the ramp up to full concurrency stay out of it
+	constexpr double WarmUpSeconds = 0.5;
+
+	// Long enough that a loaded run measures latency rather than counting timeouts
+	constexpr uint32 EchoTimeoutMs = 10000;
+
+	// How long a pool gets to open all its sockets, and the last one to close them all again
+	constexpr double ConnectTimeoutSeconds = 10.0;
+
+	// How often the old wait looked for a response
+	constexpr float PollIntervalSeconds = 0.01f;
+
+	using FEchoFuture = TFuture<TValueOrError<FEchoResponseData, FMgsError>>;
+
+	struct FInFlightEcho
+	{
+		FEchoFuture Future;
+		// With the polling wait: when the poller saw the response, and whether it was answered
+		TFuture<TPair<double, bool>> Polled;
+		double Sent = 0.0;
+	};
+
+	// The wait acked requests had before they completed through promises, which held a pool thread per request
+	TFuture<TPair<double, bool>> PollUntilReady(FEchoFuture&& Echo)
+	{
+		return Async(EAsyncExecution::ThreadPool, [Echo = MoveTemp(Echo)]()
+		{
+			while (!Echo.IsReady())
+			{
+				FPlatformProcess::Sleep(PollIntervalSeconds);
+			}
+			return TPair<double, bool>(FPlatformTime::Seconds(), Echo.Get().HasValue());
+		});
+	}
+
+	const TCHAR* GetWaitName(const EWebSocketEchoWait Wait)
+	{
+		return Wait == EWebSocketEchoWait::Poll ? TEXT("poll") : TEXT("promise");
+	}
+
+	TArray<EWebSocketEchoWait> ParseWaits(const FString& Params)
+	{
+		FString Value;
+		TArray<FString> Items;
+		if (FParse::Value(*Params, TEXT("Wait="), Value, false))
+		{
+			Value.ParseIntoArray(Items, TEXT(","));
+		}
+		TArray<EWebSocketEchoWait> Waits;
+		for (const FString& Item : Items)
+		{
+			if (Item.Equals(TEXT("Promise"), ESearchCase::IgnoreCase))
+			{
+				Waits.AddUnique(EWebSocketEchoWait::Promise);
+			}
+			else if (Item.Equals(TEXT("Poll"), ESearchCase::IgnoreCase))
+			{
+				Waits.AddUnique(EWebSocketEchoWait::Poll);
+			}
+		}
+		return Waits.Num() > 0 ? Waits : TArray<EWebSocketEchoWait>{EWebSocketEchoWait::Promise};
+	}
+
+	// A comma separated list of positive numbers, or Default if the parameter is missing or has none
+	TArray<int32> ParseList(const FString& Params, const TCHAR* Name, const TArray<int32>& Default)
+	{
+		FString Value;
+		if (!FParse::Value(*Params, Name, Value, false)) return Default;
+
+		TArray<FString> Items;
+		Value.ParseIntoArray(Items, TEXT(","));
+		TArray<int32> List;
+		for (const FString& Item : Items)
+		{
+			const int32 Number = FCString::Atoi(*Item);
+			if (Number > 0)
+			{
+				List.Add(Number);
+			}
+		}
+		return List.Num() > 0 ? List : Default;
+	}
+
+	FString ToJson(const TArray<FWebSocketBenchmarkRun>& Runs)
+	{
+		FString Json;
+		const TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("server"), FString(TEXT("stand-in")));
+		Writer->WriteArrayStart(TEXT("runs"));
+		for (const FWebSocketBenchmarkRun& Run : Runs)
+		{
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("wait"), FString(GetWaitName(Run.Wait)));
+			Writer->WriteValue(TEXT("poolSize"), Run.PoolSize);
+			Writer->WriteValue(TEXT("concurrency"), Run.Concurrency);
+			Writer->WriteValue(TEXT("payloadBytes"), Run.PayloadBytes);
+			Writer->WriteValue(TEXT("requests"), static_cast<int64>(Run.Requests));
+			Writer->WriteValue(TEXT("errors"), static_cast<int64>(Run.Errors));
+			Writer->WriteValue(TEXT("seconds"), Run.Seconds);
+			Writer->WriteValue(TEXT("requestsPerSecond"), Run.Requests / Run.Seconds);
+			Writer->WriteValue(TEXT("p50Ms"), Run.P50Ms);
+			Writer->WriteValue(TEXT("p90Ms"), Run.P90Ms);
+			Writer->WriteValue(TEXT("p99Ms"), Run.P99Ms);
+			Writer->WriteValue(TEXT("maxMs"), Run.MaxMs);
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+		Writer->WriteObjectEnd();
+		Writer->Close();
+		return Json;
+	}
+}
+
+void UWebSocketBenchmarkCommandlet::PumpFrame(FWebSocketStandInServer& Server, double& LastTickTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	FTicker::GetCoreTicker().Tick(static_cast<float>(Now - LastTickTime));
+	LastTickTime = Now;
+	FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+	Server.Tick();
+}
+
+FWebSocketBenchmarkRun UWebSocketBenchmarkCommandlet::RunEchoes(FWebSocketStandInServer& Server, FWebSocketClient& Client, const EWebSocketEchoWait Wait, const int32 PoolSize, const int32 Concurrency, const int32 PayloadBytes, const double Duration, double& LastTickTime)
+{
+	FWebSocketBenchmarkRun Result;
+	Result.Wait = Wait;
+	Result.PoolSize = PoolSize;
+	Result.Concurrency = Concurrency;
+	Result.PayloadBytes = PayloadBytes;
+	Result.Seconds = Duration;
+
+	FEchoRequestData Request;
+	Request.Val = FString::ChrN(PayloadBytes, TEXT('x'));
+	FLatencyHistogram LatencyUs;
+
+	const double MeasureFrom = FPlatformTime::Seconds() + WarmUpSeconds;
+	const double End = MeasureFrom + Duration;
+	const auto Send = [&Client, &Request, Wait](FInFlightEcho& Echo)
+	{
+		Echo.Sent = FPlatformTime::Seconds();
+		Echo.Future = Client.SendNonBlocking(Request, EchoTimeoutMs);
+		if (Wait == EWebSocketEchoWait::Poll)
+		{
+			Echo.Polled = PollUntilReady(MoveTemp(Echo.Future));
+		}
+	};
+	TArray<FInFlightEcho> InFlight;
+	InFlight.SetNum(Concurrency);
+	for (FInFlightEcho& Echo : InFlight)
+	{
+		Send(Echo);
+	}
+
+	// Every answer is replaced by a new request straight away, until the run ends; then the rest drain
+	int32 Outstanding = Concurrency;
+	while (Outstanding > 0 && FPlatformTime::Seconds() < End + EchoTimeoutMs / 1000.0)
+	{
+		PumpFrame(Server, LastTickTime);
+		for (FInFlightEcho& Echo : InFlight)
+		{
+			// A polled echo is done when its poller saw the answer, not when this loop gets to it
+			double Done = 0.0;
+			bool bAnswered = false;
+			if (Wait == EWebSocketEchoWait::Poll)
+			{
+				if (!Echo.Polled.IsValid() || !Echo.Polled.IsReady()) continue;
+				Done = Echo.Polled.Get().Key;
+				bAnswered = Echo.Polled.Get().Value;
+			}
+			else
+			{
+				if (!Echo.Future.IsValid() || !Echo.Future.IsReady()) continue;
+				Done = FPlatformTime::Seconds();
+				bAnswered = Echo.Future.Get().HasValue();
+			}
+
+			if (Echo.Sent >= MeasureFrom && Done <= End)
+			{
+				if (bAnswered)
+				{
+					LatencyUs.Record(static_cast<uint64>((Done - Echo.Sent) * 1000000.0));
+					++Result.Requests;
+				}
+				else
+				{
+					++Result.Errors;
+				}
+			}
+
+			if (FPlatformTime::Seconds() < End)
+			{
+				Send(Echo);
+			}
+			else
+			{
+				Echo.Future = FEchoFuture();
+				Echo.Polled = TFuture<TPair<double, bool>>();
+				--Outstanding;
+			}
+		}
+	}
+
+	Result.P50Ms = LatencyUs.GetPercentile(50.0) / 1000.0;
+	Result.P90Ms = LatencyUs.GetPercentile(90.0) / 1000.0;
+	Result.P99Ms = LatencyUs.GetPercentile(99.0) / 1000.0;
+	Result.MaxMs = LatencyUs.GetMax() / 1000.0;
+	return Result;
+}
+
+int32 UWebSocketBenchmarkCommandlet::Main(const FString& Params)
+{
+	const TArray<int32> ConcurrencyLevels = ParseList(Params, TEXT("Concurrency="), {1, 16, 256});
+	const TArray<int32> PayloadSizes = ParseList(Params, TEXT("Payload="), {16, 1024, 65536});
+	const TArray<int32> PoolSizes = ParseList(Params, TEXT("PoolSize="), {1});
+	const TArray<EWebSocketEchoWait> Waits = ParseWaits(Params);
+	float Duration = 5.0f;
+	uint32 Port = 18780;
+	FString OutputPath;
+	FParse::Value(*Params, TEXT("Duration="), Duration);
+	FParse::Value(*Params, TEXT("Port="), Port);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	FWebSocketStandInServer Server;
+	if (!Server.Start(Port))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't start the stand-in server on port %u"), Port);
+		return 1;
+	}
+
+	FWebSocketConfiguration Config;
+	Config.Url = FWebSocketStandInServer::GetUrl(Port);
+	Config.Endpoint_Cache_File = FString();
+	for (const int32 Concurrency : ConcurrencyLevels)
+	{
+		Config.Max_In_Flight = FMath::Max(Config.Max_In_Flight, 2 * Concurrency);
+	}
+
+	double LastTickTime = FPlatformTime::Seconds();
+	TArray<FWebSocketBenchmarkRun> Runs;
+	for (const int32 PoolSize : PoolSizes)
+	{
+		// Each pool size gets a client of its own, connected once every one of its sockets is open
+		Config.Pool_Size = PoolSize;
+		FWebSocketClient Client(Config);
+		Client.ConnectToServer();
+		const double ConnectDeadline = FPlatformTime::Seconds() + ConnectTimeoutSeconds;
+		while ((!Client.IsConnected() || Server.GetNumClients() < PoolSize) && FPlatformTime::Seconds() < ConnectDeadline)
+		{
+			PumpFrame(Server, LastTickTime);
+		}
+		if (!Client.IsConnected() || Server.GetNumClients() < PoolSize)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Couldn't open a pool of %d sockets to the stand-in server on port %u"), PoolSize, Port);
+			Client.Quit();
+			return 1;
+		}
+
+		for (const EWebSocketEchoWait Wait : Waits)
+		{
+			for (const int32 Concurrency : ConcurrencyLevels)
+			{
+				for (const int32 PayloadBytes : PayloadSizes)
+				{
+					const FWebSocketBenchmarkRun& Result = Runs.Add_GetRef(RunEchoes(Server, Client, Wait, PoolSize, Concurrency, PayloadBytes, Duration, LastTickTime));
+					UE_LOG(LogTemp, Display, TEXT("Pool %d, %s wait, concurrency %d, payload %d bytes: %.0f requests/s, p50 %.3fms p90 %.3fms p99 %.3fms max %.3fms, %llu errors"),
+						PoolSize, GetWaitName(Wait), Concurrency, PayloadBytes, Result.Requests / Result.Seconds, Result.P50Ms, Result.P90Ms, Result.P99Ms, Result.MaxMs, Result.Errors);
+				}
+			}
+		}
+		Client.Quit();
+
+		// The next pool size is only counted as connected once the server has dropped this one's sockets
+		const double CloseDeadline = FPlatformTime::Seconds() + ConnectTimeoutSeconds;
+		while (Server.GetNumClients() > 0 && FPlatformTime::Seconds() < CloseDeadline)
+		{
+			PumpFrame(Server, LastTickTime);
+		}
+	}
+
+	const FString Json = ToJson(Runs);
+	UE_LOG(LogTemp, Display, TEXT("%s"), *Json);
+	if (!OutputPath.IsEmpty() && !FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't write %s"), *OutputPath);
+		return 1;
+	}
+	return 0;
+}
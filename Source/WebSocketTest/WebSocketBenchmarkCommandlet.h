@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "WebSocketBenchmarkCommandlet.generated.h"
+
+class FWebSocketClient;
+class FWebSocketStandInServer;
+
+// How a benchmark run waits for each echo
+enum class EWebSocketEchoWait : uint8
+{
+	// The request's future, completed by the response as it is read
+	Promise,
+	// The wait requests had before they completed through promises: a pool thread checks for the response every
+	// 10 ms and sleeps in between
+	Poll,
+};
+
+struct FWebSocketBenchmarkRun
+{
+	EWebSocketEchoWait Wait = EWebSocketEchoWait::Promise;
+	int32 PoolSize = 1;
+	int32 Concurrency = 0;
+	int32 PayloadBytes = 0;
+	uint64 Requests = 0;
+	uint64 Errors = 0;
+	double Seconds = 0.0;
+	double P50Ms = 0.0;
+	double P90Ms = 0.0;
+	double P99Ms = 0.0;
+	double MaxMs = 0.0;
+};
+
+/**
+ * Measures echo throughput and latency against an in-process stand-in server, for every combination of the given
+ * pool sizes, concurrency levels and payload sizes, so changes to the client's hot path can be compared from run to
+ * run.
+ *
+ * UE4Editor-Cmd WebSocketTest.uproject -run=WebSocketBenchmark [-PoolSize=1,2,4] [-Concurrency=1,16,256] [-Payload=16,1024,65536] [-Wait=Promise,Poll] [-Duration=<seconds>] [-Port=<port>] [-Output=<json>]
+ *
+ * Each pool size gets a client with that many sockets, routed by least in flight. Each run keeps Concurrency echoes
+ * in flight for Duration seconds after a short warm-up. -Wait=Poll runs the old polling wait as well as, or instead
+ * of, the promises, for a before and after comparison. Requests/s and p50, p90, p99 and max latency of every run are
+ * logged and, with -Output, written to a JSON file.
+ */
+UCLASS()
+class UWebSocketBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+	public:
+	virtual int32 Main(const FString& Params) override;
+
+	/**
+	 * One frame of a headless run: the core ticker, which delivers socket events and runs the client's timers, then
+	 * game thread tasks, then the server. LastTickTime carries the ticker's clock from frame to frame.
+	 */
+	static void PumpFrame(FWebSocketStandInServer& Server, double& LastTickTime);
+
+	// One run: Concurrency echoes of PayloadBytes kept in flight on Client for Duration seconds after the warm-up
+	static FWebSocketBenchmarkRun RunEchoes(FWebSocketStandInServer& Server, FWebSocketClient& Client, EWebSocketEchoWait Wait, int32 PoolSize, int32 Concurrency, int32 PayloadBytes, double Duration, double& LastTickTime);
+};
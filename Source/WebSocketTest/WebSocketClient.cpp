@@ -2,21 +2,117 @@
 #include "WebSocketsModule.h"
 #include "IWebSocket.h"
 
-FWebSocketClient::FWebSocketClient(): WebSocket(nullptr)
+namespace
 {
-	const FWebSocketConfiguration Config = FWebSocketConfiguration();
-	WebSocketModule = &FWebSocketsModule::Get();
-	Configuration.Num_Retries = Config.Num_Retries;
-	Configuration.Sleep_Length = Config.Sleep_Length;
+	// How far along each state is, so a pool reports the most connected state of any of its sockets
+	int32 GetStateRank(const EConnectionState State)
+	{
+		switch (State)
+		{
+		case EConnectionState::Connected: return 5;
+		case EConnectionState::Reconnecting: return 4;
+		case EConnectionState::WaitingToReconnect: return 3;
+		case EConnectionState::Connecting: return 2;
+		case EConnectionState::GaveUp: return 1;
+		default: return 0;
+		}
+	}
+
+	double GetUnixTimeMs()
+	{
+		return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalMilliseconds();
+	}
 }
 
-FWebSocketClient::FWebSocketClient(const struct FWebSocketConfiguration Config): WebSocket(nullptr)
+FWebSocketClient::FWebSocketClient(): FWebSocketClient(FWebSocketConfiguration())
+{
+}
+
+FWebSocketClient::FWebSocketClient(const struct FWebSocketConfiguration Config): Configuration(Config), WebSocket(nullptr)
 {
 	WebSocketModule = &FWebSocketsModule::Get();
-	Configuration.Num_Retries = Config.Num_Retries;
-	Configuration.Sleep_Length = Config.Sleep_Length;
+	ClientKey = FGuid::NewGuid().ToString(EGuidFormats::Digits);
+	EndpointRanking = MakeUnique<FEndpointRanking>(Configuration.Endpoints.Num() > 0 ? Configuration.Endpoints : TArray<FString>{Configuration.Url}, Configuration.Endpoint_Cache_File);
+	for (int32 Index = 0; Index < FMath::Max(Configuration.Pool_Size, 1); ++Index)
+	{
+		Connections.Add(MakeUnique<FPooledConnection>());
+		Connections.Last()->Index = Index;
+	}
+	PendingRequests = MakeUnique<TPendingRequestTable<TSharedPtr<FWebSocketResponse>>>(Configuration.Max_In_Flight);
+	PendingRequests->SetReleaseHandler([this](const FPendingRequestRelease& Release, const TSharedPtr<FWebSocketResponse>& Result)
+	{
+		OnRequestReleased(Release, Result);
+	});
+	CancelRegistrations.SetNum(PendingRequests->GetCapacity());
+	Deadlines = MakeUnique<FDeadlineWheel>(Configuration.Timer_Resolution_Ms / 1000.0, Configuration.Timer_Wheel_Buckets, FPlatformTime::Seconds());
+	for (TUniquePtr<TBoundedMpscQueue<FQueuedPush>>& Queue : PushMessageQueues)
+	{
+		Queue = MakeUnique<TBoundedMpscQueue<FQueuedPush>>(Configuration.Push_Queue_Capacity);
+	}
+	if (Configuration.Reactor.IsValid())
+	{
+		NextHeartbeatTime = FPlatformTime::Seconds() + Configuration.Heartbeat_Interval_Ms / 1000.0;
+		ReactorKey = Configuration.Reactor->AddClient([this](const float DeltaTime)
+		{
+			TickOnReactor(DeltaTime);
+		});
+	}
+	else
+	{
+		DeadlineTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWebSocketClient::ExpireTimedOutRequests));
+		OutboxTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWebSocketClient::FlushOutboxTick));
+		MailboxTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWebSocketClient::DrainGameThreadMailbox));
+		if (Configuration.Heartbeat_Interval_Ms > 0)
+		{
+			HeartbeatTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWebSocketClient::SendHeartbeats), Configuration.Heartbeat_Interval_Ms / 1000.0f);
+		}
+	}
+	FWebSocketStatsRegistry::Register(this);
 }
 
+FWebSocketClient::~FWebSocketClient()
+{
+	{
+		// Waits out any cancel callback or task graph decode or flush still running for this client
+		FRWScopeLock Lock(Lifetime->Lock, SLT_Write);
+		Lifetime->bAlive = false;
+	}
+
+	// Waits out any decode or flush the reactor is running for this client
+	if (Configuration.Reactor.IsValid())
+	{
+		Configuration.Reactor->RemoveClient(ReactorKey);
+	}
+	FWebSocketStatsRegistry::Unregister(this);
+	FTicker::GetCoreTicker().RemoveTicker(DeadlineTickerHandle);
+	FTicker::GetCoreTicker().RemoveTicker(OutboxTickerHandle);
+	FTicker::GetCoreTicker().RemoveTicker(MailboxTickerHandle);
+	FTicker::GetCoreTicker().RemoveTicker(HeartbeatTickerHandle);
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		FTicker::GetCoreTicker().RemoveTicker(Connection->ReconnectTickerHandle);
+	}
+
+	// The WebSockets module keeps a socket alive until it has closed, so its events must no longer reach the client
+	EndpointRanking->CancelProbe();
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		if (!Connection->Socket.IsValid()) continue;
+		Connection->Socket->OnConnected().Clear();
+		Connection->Socket->OnConnectionError().Clear();
+		Connection->Socket->OnRawMessage().Clear();
+		Connection->Socket->OnClosed().Clear();
+		Connection->Socket->Close();
+	}
+
+	// Cancelling what is still pending releases into Connections, which would otherwise be destroyed first; waiters
+	// are told why rather than seeing what looks like a timeout
+	PendingRequests->CancelAll([](const uint64 Id)
+	{
+		return MakeErrorResponse(Id, TEXT("ClientDestroyed"));
+	});
+	PendingRequests.Reset();
+}
 
 void FWebSocketClient::SetNumRetries(const int32 N)
 {
@@ -31,167 +127,1335 @@ void FWebSocketClient::SetSleepLength(const int32 N)
 //Connects to the server
 void FWebSocketClient::ConnectToServer()
 {
-	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this]()
+	QuittingFlag = false;
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		Connection->Retries = 0;
+		Connection->ReconnectAttempt = 0;
+		SetConnectionState(*Connection, EConnectionState::Connecting);
+	}
+
+	const auto OpenSockets = [this]()
+	{
+		for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+		{
+			Connection->Endpoint = EndpointRanking->GetBest();
+			OpenSocket(*Connection);
+		}
+	};
+	if (EndpointRanking->Num() == 1)
+	{
+		OpenSockets();
+		return;
+	}
+
+	// Once there is a ranking, from this session or a cached one, its best is used straight away and the probe only
+	// refreshes the order for later failovers
+	TArray<FString> Protocols;
+	GetOfferedProtocols(Protocols);
+	bWaitingForProbe = !EndpointRanking->IsRanked();
+	EndpointRanking->Probe(*WebSocketModule, Protocols, Configuration.Probe_Timeout_Ms / 1000.0f, [this, OpenSockets]()
+	{
+		UE_LOG(LogTemp, Log, TEXT("Best endpoint is %s"), *EndpointRanking->GetBest());
+		if (bWaitingForProbe)
+		{
+			bWaitingForProbe = false;
+			OpenSockets();
+		}
+	});
+	if (!bWaitingForProbe)
+	{
+		OpenSockets();
+	}
+}
+
+void FWebSocketClient::GetOfferedProtocols(TArray<FString>& OutProtocols) const
+{
+	if (!Configuration.Negotiate_Codecs) return;
+	for (const FString& Name : Configuration.Codecs)
+	{
+		if (const IWebSocketCodec* Codec = IWebSocketCodec::FindByName(Name))
+		{
+			OutProtocols.Add(Codec->GetSubprotocol());
+		}
+	}
+}
+
+void FWebSocketClient::OpenSocket(FPooledConnection& Connection)
+{
+	// Requests go out in JSON, or the codec fixed without negotiation, until the server has answered in the codec it
+	// picked, which may differ from the last socket's
+	TArray<FString> Protocols;
+	GetOfferedProtocols(Protocols);
+	const IWebSocketCodec* Agreed = !Configuration.Negotiate_Codecs && Configuration.Codecs.Num() > 0 ? IWebSocketCodec::FindByName(Configuration.Codecs[0]) : nullptr;
+	Connection.Codec = Agreed != nullptr ? Agreed : &IWebSocketCodec::Json();
+
+	// A socket from an earlier attempt must not report into this one
+	if (Connection.Socket.IsValid())
 	{
-		const TSharedRef<IWebSocket> IWebSocket = WebSocketModule->CreateWebSocket("ws://localhost:5000/ws");
-		WebSocket = &IWebSocket.Get();
+		Connection.Socket->OnConnected().Clear();
+		Connection.Socket->OnConnectionError().Clear();
+		Connection.Socket->OnRawMessage().Clear();
+		Connection.Socket->OnClosed().Clear();
+	}
 
-		ConnectionDelegate.AddRaw(this, &FWebSocketClient::BindResponseDelegate);
+	const TSharedPtr<IWebSocket> Socket = Protocols.Num() > 0
+		? WebSocketModule->CreateWebSocket(Connection.Endpoint, Protocols)
+		: WebSocketModule->CreateWebSocket(Connection.Endpoint);
+	{
+		// SendRequest reads the socket under SendMutex from any thread
+		std::unique_lock<std::mutex> Lock(SendMutex);
+		Connection.Socket = Socket;
+	}
+	if (Connection.Index == 0)
+	{
+		WebSocket = Socket.Get();
+	}
 
-		WebSocket->OnConnected().AddLambda([this]() {
-			UE_LOG(LogTemp, Log, TEXT("Connected to websocket server."));
+	// Connections are heap allocated and live as long as the client, so the handlers can hold on to them
+	FPooledConnection* Pooled = &Connection;
+	Socket->OnConnected().AddLambda([this, Pooled]() {
+		UE_LOG(LogTemp, Log, TEXT("Connection %d connected to websocket server %s."), Pooled->Index, *Pooled->Endpoint);
+		const bool bWasConnected = Connected;
+		if (Pooled->State == EConnectionState::Reconnecting)
+		{
+			++Reconnects;
+		}
+		Pooled->bConnected = true;
+		Pooled->LastReceived = FPlatformTime::Seconds();
+		Pooled->Retries = 0;
+		Pooled->ReconnectAttempt = 0;
+		SetConnectionState(*Pooled, EConnectionState::Connected);
+		ResendUnacked(*Pooled);
+		if (!bWasConnected)
+		{
 			ConnectionDelegate.Broadcast(true);
-			Connected = true;
-		});
+		}
+	});
 
-		WebSocket->OnConnectionError().AddLambda([this](const FString& Error) {
-			UE_LOG(LogTemp, Log, TEXT("Failed to connect to websocket server with error: \"%s\"."), *Error);
+	Socket->OnConnectionError().AddLambda([this, Pooled](const FString& Error) {
+		UE_LOG(LogTemp, Log, TEXT("Connection %d failed to connect to websocket server with error: \"%s\"."), Pooled->Index, *Error);
+		Pooled->bConnected = false;
+		if (!Connected)
+		{
 			ConnectionDelegate.Broadcast(false);
-			Connected = false;
-		});
+		}
+		if (Pooled->State == EConnectionState::Reconnecting)
+		{
+			FailOver(*Pooled);
+			ScheduleReconnect(*Pooled);
+		}
+		else
+		{
+			SetConnectionState(*Pooled, EConnectionState::Disconnected);
+			FailUnacked(TEXT("Disconnected"), Pooled->Index);
+		}
+	});
 
-		WebSocket->OnMessage().AddLambda([this](const FString& Message) {
-			UE_LOG(LogTemp, Log, TEXT("Received message from websocket server: \"%s\"."), *Message);
-			ProcessResponse(Message);
-		});
+	// Raw frames are parsed as UTF-8 directly; binding OnMessage as well would make the socket convert every frame to an FString
+	Socket->OnRawMessage().AddLambda([this, Pooled](const void* Data, const SIZE_T Size, const SIZE_T BytesRemaining) {
+		ReceiveFragment(*Pooled, Data, Size, BytesRemaining);
+	});
 
-		WebSocket->OnClosed().AddLambda([this](const int32 StatusCode, const FString& Reason, bool bWasClean) {
-			UE_LOG(LogTemp, Log, TEXT("Connection to websocket server has been closed with status code: \"%d\" and reason: \"%s\"."), StatusCode, *Reason);
-			Connected = false;
-			if (StatusCode == 1000)
+	Socket->OnClosed().AddLambda([this, Pooled](const int32 StatusCode, const FString& Reason, bool bWasClean) {
+		UE_LOG(LogTemp, Log, TEXT("Connection %d to websocket server has been closed with status code: \"%d\" and reason: \"%s\"."), Pooled->Index, StatusCode, *Reason);
+		Pooled->bConnected = false;
+		if (StatusCode == 1000 || QuittingFlag)
+		{
+			SetConnectionState(*Pooled, EConnectionState::Disconnected);
+			FailUnacked(TEXT("Disconnected"), Pooled->Index);
+			if (GetStateRank(ConnectionState) <= GetStateRank(EConnectionState::GaveUp))
 			{
 				OnClosed.Broadcast();
-			} else
-			{
-				UE_LOG(LogTemp, Log, TEXT("Attempting to reconnect..."));
-				IsReconnecting = true;
-				OnReconnection.Broadcast();
-				Retries = Configuration.Num_Retries;
-				Reconnect();
 			}
-		});
-
-		std::unique_lock<std::mutex> UniqueLock(Mutex);
-		WebSocket->Connect();
-		ReconnectingCV.wait(UniqueLock);
-		Mutex.unlock();
+		} else
+		{
+			OnConnectionLost(*Pooled);
+		}
 	});
+
+	Socket->Connect();
 }
 
 // Disconnect from the server
 void FWebSocketClient::DisconnectFromServer() const
 {
-	WebSocket->Close();
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		if (Connection->Socket.IsValid())
+		{
+			Connection->Socket->Close();
+		}
+	}
 }
 
-// Reconnect to the server
-void FWebSocketClient::Reconnect()
+void FWebSocketClient::ScheduleReconnect(FPooledConnection& Connection)
 {
-	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this]()
+	if (QuittingFlag)
 	{
-		UE_LOG(LogTemp, Log, TEXT("Retries left: \"%d\""), Retries);
+		SetConnectionState(Connection, EConnectionState::Disconnected);
+		FailUnacked(TEXT("Disconnected"), Connection.Index);
+		return;
+	}
 
-		if (!QuittingFlag)
+	UE_LOG(LogTemp, Log, TEXT("Connection %d retries left: \"%d\""), Connection.Index, Connection.Retries);
+	if (Connection.Retries <= 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Connection %d timed-out"), Connection.Index);
+		SetConnectionState(Connection, EConnectionState::GaveUp);
+		FailUnacked(TEXT("Disconnected"), Connection.Index);
+		if (GetStateRank(ConnectionState) <= GetStateRank(EConnectionState::GaveUp))
 		{
-			if (Retries > 0)
-			{
-				--Retries;
+			OnClosed.Broadcast();
+		}
+		return;
+	}
+	--Connection.Retries;
 
-				std::unique_lock<std::mutex> UniqueLock(Mutex);
-				ConnectToServer();
-				ReconnectingCV.wait(UniqueLock);
-				FPlatformProcess::Sleep(Configuration.Sleep_Length);
-				Mutex.unlock();
+	// Nothing blocks while waiting; the ticker fires once the delay has passed
+	const float Delay = NextReconnectDelay(Connection);
+	++Connection.ReconnectAttempt;
+	UE_LOG(LogTemp, Log, TEXT("Reconnecting connection %d in %.2fs"), Connection.Index, Delay);
+	SetConnectionState(Connection, EConnectionState::WaitingToReconnect);
+	Connection.ReconnectTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWebSocketClient::OnReconnectTimer, Connection.Index), Delay);
+}
 
-				if (!Connected && Retries == 0)
-				{
-					AsyncTask(ENamedThreads::GameThread, [this]()
-					{
-						UE_LOG(LogTemp, Log, TEXT("Client timed-out"));
-						IsReconnecting = false;
-						OnClosed.Broadcast();
-					});
-				} else if (Connected)
-				{
-					UE_LOG(LogTemp, Log, TEXT("Successful Reconnection"));
-					IsReconnecting = false;
-				} else
-				{
-					Reconnect();
-				}
-			}
-		} else
+bool FWebSocketClient::OnReconnectTimer(float DeltaTime, const int32 Index)
+{
+	FPooledConnection& Connection = *Connections[Index];
+	Connection.ReconnectTickerHandle.Reset();
+	if (QuittingFlag)
+	{
+		SetConnectionState(Connection, EConnectionState::Disconnected);
+		FailUnacked(TEXT("Disconnected"), Connection.Index);
+		return false;
+	}
+
+	SetConnectionState(Connection, EConnectionState::Reconnecting);
+	++ReconnectAttempts;
+	OpenSocket(Connection);
+	return false;
+}
+
+void FWebSocketClient::OnConnectionLost(FPooledConnection& Connection)
+{
+	UE_LOG(LogTemp, Log, TEXT("Attempting to reconnect..."));
+	HoldUnacked(Connection.Index);
+	OnReconnection.Broadcast();
+	Connection.Retries = Configuration.Num_Retries;
+	Connection.ReconnectAttempt = 0;
+	FailOver(Connection);
+	ScheduleReconnect(Connection);
+}
+
+bool FWebSocketClient::SendHeartbeats(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	const double SilenceAllowed = Configuration.Heartbeat_Interval_Ms * FMath::Max(Configuration.Heartbeat_Misses_Allowed, 1) / 1000.0;
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		if (Connection->State != EConnectionState::Connected) continue;
+
+		// Any frame shows the server is alive, so only a socket that has heard nothing at all is given up on
+		if (Now - Connection->LastReceived >= SilenceAllowed)
+		{
+			UE_LOG(LogTemp, Log, TEXT("Connection %d heard nothing for %.1fs, treating it as half-open"), Connection->Index, Now - Connection->LastReceived);
+			Connection->bConnected = false;
+
+			// The close handshake will not complete, and a late close event must not start a second reconnect
+			Connection->Socket->OnClosed().Clear();
+			Connection->Socket->Close();
+			OnConnectionLost(*Connection);
+			continue;
+		}
+		SendHeartbeat(*Connection);
+	}
+	return true;
+}
+
+void FWebSocketClient::TickOnReactor(const float DeltaTime)
+{
+	ExpireTimedOutRequests(DeltaTime);
+	FlushOutboxTick(DeltaTime);
+	DrainGameThreadMailbox(DeltaTime);
+
+	const double Now = FPlatformTime::Seconds();
+	if (Configuration.Heartbeat_Interval_Ms > 0 && Now >= NextHeartbeatTime)
+	{
+		NextHeartbeatTime = Now + Configuration.Heartbeat_Interval_Ms / 1000.0;
+		SendHeartbeats(DeltaTime);
+	}
+}
+
+void FWebSocketClient::SendHeartbeat(FPooledConnection& Connection)
+{
+	FHeartbeatRequestData Heartbeat;
+	Heartbeat.ClientTime = GetUnixTimeMs();
+	const double Start = FPlatformTime::Seconds();
+
+	// Unanswered heartbeats are caught by the silence check, so one only has to live until that would fire
+	uint TimeoutMs = Configuration.Heartbeat_Interval_Ms * FMath::Max(Configuration.Heartbeat_Misses_Allowed, 1);
+	uint64 Id = 0;
+	FPooledConnection* Pooled = &Connection;
+	SendRequestOn(Connection, Heartbeat, true, TimeoutMs, EResendPolicy::Drop, FRequestCancellationToken(), Id).Next([Pooled, Start, SentMs = Heartbeat.ClientTime](const TSharedPtr<FWebSocketResponse>& Ack)
+	{
+		// Local errors such as a cancel on disconnect never reached the server, so only real answers are timed
+		if (!Ack.IsValid() || Ack->IsError()) return;
+
+		const double RttMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+		Pooled->Rtt.AddSample(RttMs);
+
+		FHeartbeatResponseData Data;
+		Ack->DecodeData(Data);
+		if (Data.ServerTime > 0.0)
 		{
-			QuittingCV.notify_one();
+			Pooled->Rtt.AddClockSample(SentMs, RttMs, Data.ServerTime);
 		}
 	});
 }
 
-void FWebSocketClient::ProcessResponse(const FString Message)
+void FWebSocketClient::FailOver(FPooledConnection& Connection)
+{
+	// Carries on down the ranking from the endpoint that failed rather than probing again
+	const FString& Next = EndpointRanking->GetNext(Connection.Endpoint);
+	if (Next != Connection.Endpoint)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Connection %d failing over from %s to %s"), Connection.Index, *Connection.Endpoint, *Next);
+		Connection.Endpoint = Next;
+		Connection.Rtt.Reset();
+	}
+}
+
+float FWebSocketClient::DrawReconnectDelay(const float BaseDelay, const float MaxDelay, const int32 Attempt)
+{
+	// Random delays keep clients that lost the same server from reconnecting in lockstep
+	const float Ceiling = FMath::Min(MaxDelay, BaseDelay * FMath::Pow(2.0f, FMath::Clamp(Attempt, 0, 30)));
+	return FMath::FRandRange(0.0f, Ceiling);
+}
+
+float FWebSocketClient::NextReconnectDelay(const FPooledConnection& Connection) const
 {
-	TSharedPtr<FJsonObject> JsonResponse;
-	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Message);
+	return DrawReconnectDelay(Configuration.Reconnect_Base_Delay, Configuration.Sleep_Length, Connection.ReconnectAttempt);
+}
+
+void FWebSocketClient::SetConnectionState(FPooledConnection& Connection, const EConnectionState NewState)
+{
+	Connection.State = NewState;
 
-	if (FJsonSerializer::Deserialize(JsonReader, JsonResponse))
+	EConnectionState Summary = EConnectionState::Disconnected;
+	for (const TUniquePtr<FPooledConnection>& Other : Connections)
 	{
-		//TODO: if id is 0, need to add it to a push queue, otherwise, all pushes will overwrite each other
-		const int32 Id = JsonResponse->GetIntegerField("id");
-		if (Id == 0)
+		if (GetStateRank(Other->State) > GetStateRank(Summary))
 		{
-			UE_LOG(LogTemp, Log, TEXT("Enqueuing Push: %s"), *JsonResponse->GetStringField("event"));
-			PushMessageQueue.Enqueue(JsonResponse);
-			return;
+			Summary = Other->State;
+		}
+	}
+	Connected = Summary == EConnectionState::Connected;
+
+	if (ConnectionState == Summary) return;
+	const EConnectionState OldState = ConnectionState;
+	ConnectionState = Summary;
+	OnConnectionStateChanged.Broadcast(OldState, Summary);
+}
+
+FWebSocketClient::FPooledConnection& FWebSocketClient::RouteRequest(const FString& ShardKey)
+{
+	if (Connections.Num() == 1) return *Connections[0];
+
+	if (Configuration.Pool_Routing == EPoolRouting::ShardKey)
+	{
+		// A shard stays on its socket while it is down, so its requests are held and resent rather than reordered
+		return *Connections[static_cast<int32>(GetTypeHash(ShardKey) % static_cast<uint32>(Connections.Num()))];
+	}
+
+	FPooledConnection* Best = nullptr;
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		const bool bConnected = Connection->bConnected.load(std::memory_order_relaxed);
+		const bool bBestConnected = Best && Best->bConnected.load(std::memory_order_relaxed);
+		if (!Best || (bConnected && !bBestConnected)
+			|| (bConnected == bBestConnected && Connection->InFlight.load(std::memory_order_relaxed) < Best->InFlight.load(std::memory_order_relaxed)))
+		{
+			Best = Connection.Get();
 		}
+	}
+	return *Best;
+}
+
+void FWebSocketClient::ReceiveFragment(FPooledConnection& Connection, const void* Data, const SIZE_T Size, const SIZE_T BytesRemaining)
+{
+	TArray<ANSICHAR>& ReceiveBuffer = Connection.ReceiveBuffer;
+	Connection.LastReceived = FPlatformTime::Seconds();
+	BytesReceived += Size;
+
+	// Unfragmented frames are parsed straight out of the socket's buffer
+	if (BytesRemaining == 0 && ReceiveBuffer.Num() == 0)
+	{
+		ProcessResponse(Connection, static_cast<const ANSICHAR*>(Data), static_cast<int32>(Size));
+		return;
+	}
+
+	if (ReceiveBuffer.Num() == 0)
+	{
+		ReceiveBuffer.Reserve(Size + BytesRemaining);
+	}
+	ReceiveBuffer.Append(static_cast<const ANSICHAR*>(Data), static_cast<int32>(Size));
+	if (BytesRemaining > 0) return;
+
+	ProcessResponse(Connection, ReceiveBuffer.GetData(), ReceiveBuffer.Num());
+
+	// Reset keeps the allocation, so the buffer is reused for the next fragmented frame
+	ReceiveBuffer.Reset();
+}
+
+void FWebSocketClient::ProcessResponse(FPooledConnection& Connection, const ANSICHAR* Data, int32 Length)
+{
+	UE_LOG(LogTemp, Verbose, TEXT("Received %d bytes from websocket server."), Length);
+	IWebSocketCodec::SkipByteOrderMark(Data, Length);
+
+	// IWebSocket does not report the negotiated subprotocol, so the server's choice is read off its frames
+	const IWebSocketCodec& Codec = IWebSocketCodec::Detect(Data, Length);
+	if (&Codec != Connection.Codec.load(std::memory_order_relaxed) && IsCodecOffered(Codec))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Server answered connection %d in %s, switching codec"), Connection.Index, Codec.GetName());
+		Connection.Codec = &Codec;
+	}
 
-		WriteAckMap(Id, JsonResponse);
+	++FramesReceived;
+
+	// Batched frames are split back into their messages, each of which then goes to its own waiter or handler
+	if (!Codec.SplitBatch(Data, Length, [this, &Codec](const ANSICHAR* Message, const int32 MessageLength)
+	{
+		ProcessMessage(Codec, Message, MessageLength);
+	}))
+	{
+		ProcessMessage(Codec, Data, Length);
+	}
+}
 
-		RequestCV.notify_one();
+void FWebSocketClient::ProcessMessage(const IWebSocketCodec& Codec, const ANSICHAR* Data, const int32 Length)
+{
+	++MessagesReceived;
 
-		UE_LOG(LogTemp, Log, TEXT("After JsonObject set to AckMap[Id] and notify RequestCV"));
-	} else
+	// Only the envelope is parsed here; data stays encoded until whoever consumes it decodes it
+	TSharedPtr<FWebSocketResponse> Response = AcquireResponse();
+	if (!Response->Scan(Codec, Data, Length))
 	{
 		UE_LOG(LogTemp, Log, TEXT("Couldn't deserialize"));
 	}
+	// The frame is only copied out of the receive buffer once we know somebody wants it
+	else if (Response->Id == 0)
+	{
+		EnqueuePush(MoveTemp(*Response), Data, Length);
+	}
+	else if (!PendingRequests->IsPending(Response->Id))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Dropping response for unknown or timed-out request: %llu"), Response->Id);
+	}
+	else
+	{
+		Response->Retain(Data, Length);
+		ForgetUnacked(Response->Id);
+		if (PendingRequests->Complete(Response->Id, Response))
+		{
+			UE_LOG(LogTemp, Verbose, TEXT("After promise for request %llu fulfilled"), Response->Id);
+		}
+	}
+	RecycleResponse(MoveTemp(Response));
 }
 
-void FWebSocketClient::ProcessPushMessages(uint32 MaxMessages)
+TSharedPtr<FWebSocketResponse> FWebSocketClient::AcquireResponse()
 {
-	TSharedPtr<FJsonObject> JsonResponse;
-	while (MaxMessages-- > 0 && PushMessageQueue.Dequeue(JsonResponse))
 	{
-		auto EventName = JsonResponse->GetStringField("event");
-		if (!TypeRegistry.Contains(EventName))
+		std::unique_lock<std::mutex> Lock(FreeResponsesMutex);
+		if (FreeResponses.Num() > 0)
 		{
-			UE_LOG(LogTemp, Log, TEXT("Dequeued Unknown Json Push: %s"), *EventName);
-			return;
+			return FreeResponses.Pop(false);
 		}
-		const auto PushHandler = TypeRegistry[JsonResponse->GetStringField("event")];
-		UE_LOG(LogTemp, Log, TEXT("Dequeued Json: %s"), *EventName);
-		PushHandler(JsonResponse);
 	}
+	return MakeShared<FWebSocketResponse>();
 }
 
-void FWebSocketClient::BindResponseDelegate(const bool IsConnected)
+void FWebSocketClient::RecycleResponse(TSharedPtr<FWebSocketResponse>&& Response)
 {
-	AsyncAwaitResponse.IsConnected = IsConnected;
-	ReconnectingCV.notify_one();
+	// A future or a push still holding the response keeps it; like frames, large ones are not pooled
+	if (!Response.IsUnique() || Response->Frame.Max() > MaxPooledFrameBytes) return;
+
+	std::unique_lock<std::mutex> Lock(FreeResponsesMutex);
+	if (FreeResponses.Num() < Configuration.Max_In_Flight)
+	{
+		FreeResponses.Add(MoveTemp(Response));
+	}
 }
 
-bool FWebSocketClient::IsConnected() const
+bool FWebSocketClient::ExpireTimedOutRequests(float DeltaTime)
 {
-	return Connected;
+	const double Now = FPlatformTime::Seconds();
+	int32 Expired = 0;
+	Deadlines->Advance(Now, [this, Now, &Expired](const uint64 Id)
+	{
+		Expired += PendingRequests->ExpireIfDue(Id, Now) ? 1 : 0;
+	});
+	if (Expired > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Timed out %d requests"), Expired);
+
+		std::unique_lock<std::mutex> Lock(UnackedRequestsMutex);
+		for (auto It = UnackedRequests.CreateIterator(); It; ++It)
+		{
+			if (!PendingRequests->IsPending(It.Key()))
+			{
+				RecycleFrameLocked(MoveTemp(It.Value().Frame));
+				It.RemoveCurrent();
+			}
+		}
+	}
+	return true;
 }
 
-void FWebSocketClient::Quit()
+void FWebSocketClient::CancelRequest(const uint64 Id)
+{
+	// Tokens outlive their requests, so most late cancels find nothing to do
+	if (!PendingRequests->IsPending(Id)) return;
+	if (PendingRequests->Cancel(Id, MakeErrorResponse(Id, TEXT("Cancelled"))))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Cancelled request %llu"), Id);
+	}
+	ForgetUnacked(Id);
+}
+
+TSharedPtr<FWebSocketResponse> FWebSocketClient::MakeErrorResponse(const uint64 Id, const FString& Message)
+{
+	FMgsError Error;
+	Error.Message = Message;
+	const TSharedPtr<FWebSocketResponse> Response = MakeShared<FWebSocketResponse>();
+	Response->Id = Id;
+	Response->Event = TWebSocketMessage<FMgsError>::GetName();
+	Response->Codec = &IWebSocketCodec::Json();
+	Response->Codec->WriteData(FMgsError::StaticStruct(), &Error, Response->Frame);
+	Response->DataStart = 0;
+	Response->DataLength = Response->Frame.Num();
+	return Response;
+}
+
+TFuture<TSharedPtr<FWebSocketResponse>> FWebSocketClient::MakeErrorFuture(const uint64 Id, const FString& Message)
+{
+	TPromise<TSharedPtr<FWebSocketResponse>> Failed;
+	Failed.SetValue(MakeErrorResponse(Id, Message));
+	return Failed.GetFuture();
+}
+
+TFuture<TSharedPtr<FWebSocketResponse>> FWebSocketClient::FailRequest(TPendingRequestCompletion<TSharedPtr<FWebSocketResponse>>* Receiver, const uint64 Id, const FString& Message)
+{
+	if (Receiver == nullptr)
+	{
+		return MakeErrorFuture(Id, Message);
+	}
+	Receiver->Complete(MakeErrorResponse(Id, Message));
+	return TFuture<TSharedPtr<FWebSocketResponse>>();
+}
+
+bool FWebSocketClient::IsComingUp(const EConnectionState State)
 {
-	if (IsReconnecting)
+	return State == EConnectionState::Connecting || State == EConnectionState::WaitingToReconnect || State == EConnectionState::Reconnecting;
+}
+
+void FWebSocketClient::EnqueuePush(FWebSocketResponse&& Header, const ANSICHAR* Data, const int32 Length)
+{
+	// Registering a handler adds its name, so an event nobody registered is not found without allocating a new name
+	FQueuedPush Push;
+	Push.Key.Event = FName(*Header.Event, FNAME_Find);
 	{
-		AsyncTask(ENamedThreads::GameThread, [this]()
+		FRWScopeLock Lock(TypeRegistryLock, SLT_ReadOnly);
+		if (const TSharedPtr<const FPushHandler>* Handler = TypeRegistry.Find(Push.Key.Event))
 		{
-			std::unique_lock<std::mutex> UniqueLock(Mutex);
-			QuittingFlag = true;
-			QuittingCV.wait(UniqueLock);
-			Mutex.unlock();
-		});
+			Push.Handler = *Handler;
+		}
+	}
+	if (!Push.Handler.IsValid())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Dropping Unknown Push: %s"), *Header.Event);
+		++PushesDropped;
+		return;
+	}
+
+	UE_LOG(LogTemp, Verbose, TEXT("Enqueuing Push: %s"), *Header.Event);
+	Push.Response = MakeShared<FWebSocketResponse>(MoveTemp(Header));
+	Push.Response->Retain(Data, Length);
+
+	if (Push.Handler->Options.DecodeThread == EPushDecodeThread::Receive)
+	{
+		Push.Invoke = Push.Handler->Decode(*Push.Response, Push.Key.Key);
+		Push.Response.Reset();
+		QueueDecodedPush(MoveTemp(Push));
+		return;
+	}
+
+	// A single worker drains the queue so pushes of one event are never reordered, which latest-wins relies on
+	DecodeQueue.Enqueue(MoveTemp(Push));
+	if (!bDecodeScheduled.exchange(true))
+	{
+		if (Configuration.Reactor.IsValid())
+		{
+			Configuration.Reactor->Post(ReactorKey, [this]()
+			{
+				DrainDecodeQueue();
+			});
+			return;
+		}
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, WhileAlive([this]()
+		{
+			DrainDecodeQueue();
+		}));
+	}
+}
+
+void FWebSocketClient::DrainDecodeQueue()
+{
+	do
+	{
+		FQueuedPush Push;
+		while (DecodeQueue.Dequeue(Push))
+		{
+			Push.Invoke = Push.Handler->Decode(*Push.Response, Push.Key.Key);
+			Push.Response.Reset();
+			QueueDecodedPush(MoveTemp(Push));
+		}
+		bDecodeScheduled = false;
+	}
+	// A push enqueued after the last Dequeue but before the flag was cleared would otherwise be stranded
+	while (!DecodeQueue.IsEmpty() && !bDecodeScheduled.exchange(true));
+}
+
+void FWebSocketClient::QueueDecodedPush(FQueuedPush&& Push)
+{
+	if (Push.Handler->Options.bLatestWins)
+	{
+		std::unique_lock<std::mutex> Lock(LatestPushesMutex);
+		if (TUniqueFunction<void()>* Latest = LatestPushes.Find(Push.Key))
+		{
+			*Latest = MoveTemp(Push.Invoke);
+			++PushesCoalesced;
+			return;
+		}
+		LatestPushes.Add(Push.Key, MoveTemp(Push.Invoke));
+	}
+
+	TBoundedMpscQueue<FQueuedPush>& Queue = *PushMessageQueues[static_cast<int32>(Push.Handler->Options.Priority)];
+	if (!Queue.TryEnqueue(MoveTemp(Push)) && !HandlePushOverflow(Queue, MoveTemp(Push)))
+	{
+		return;
+	}
+
+	const int32 Depth = ++PushQueueDepth;
+	int32 MaxDepth = MaxPushQueueDepth.load(std::memory_order_relaxed);
+	while (Depth > MaxDepth && !MaxPushQueueDepth.compare_exchange_weak(MaxDepth, Depth, std::memory_order_relaxed))
+	{
+	}
+	if (Depth >= Configuration.Push_High_Water && !bAbovePushHighWater.exchange(true))
+	{
+		SetPushBacklog(true);
+	}
+}
+
+bool FWebSocketClient::HandlePushOverflow(TBoundedMpscQueue<FQueuedPush>& Queue, FQueuedPush&& Push)
+{
+	++PushesOverflowed;
+	switch (Configuration.Push_Overflow_Policy)
+	{
+	case EPushOverflowPolicy::DropOldest:
+	{
+		// Other producers may take the freed cell first, so evict a few times before giving up on this push instead
+		FQueuedPush Oldest;
+		for (int32 Attempt = 0; Attempt < MaxDropOldestAttempts; ++Attempt)
+		{
+			if (Queue.TryDequeue(Oldest))
+			{
+				--PushQueueDepth;
+				DiscardPush(Oldest);
+			}
+			if (Queue.TryEnqueue(MoveTemp(Push)))
+			{
+				return true;
+			}
+		}
+		DiscardPush(Push);
+		return false;
+	}
+	case EPushOverflowPolicy::Coalesce:
+	{
+		std::unique_lock<std::mutex> Lock(OverflowPushesMutex);
+		if (FQueuedPush* Overflowed = OverflowPushes.Find(Push.Key))
+		{
+			*Overflowed = MoveTemp(Push);
+			++PushesCoalesced;
+		}
+		else
+		{
+			OverflowPushes.Add(Push.Key, MoveTemp(Push));
+			++OverflowPushCount;
+		}
+		return false;
+	}
+	case EPushOverflowPolicy::DropNewest:
+	case EPushOverflowPolicy::PauseServer:
+	default:
+		DiscardPush(Push);
+		return false;
+	}
+}
+
+void FWebSocketClient::DiscardPush(const FQueuedPush& Push)
+{
+	UE_LOG(LogTemp, Verbose, TEXT("Push queue full, dropping %s"), *Push.Key.Event.ToString());
+	++PushesDropped;
+
+	// A latest-wins push in the queue stands in for the newest push of its key, which goes with it
+	if (Push.Handler->Options.bLatestWins)
+	{
+		std::unique_lock<std::mutex> Lock(LatestPushesMutex);
+		LatestPushes.Remove(Push.Key);
+	}
+}
+
+void FWebSocketClient::SetPushBacklog(const bool bAboveHighWater)
+{
+	UE_LOG(LogTemp, Log, TEXT("Push queue %s"), bAboveHighWater ? TEXT("reached its high-water mark") : TEXT("drained to its low-water mark"));
+	if (bAboveHighWater)
+	{
+		++PushHighWaterCrossings;
+	}
+
+	// This runs on the decode worker, which must not wait on SendMutex behind the game thread's sends, so only the
+	// newest state is left here; a pause and resume before the next flush tick send just the resume
+	if (Configuration.Push_Overflow_Policy == EPushOverflowPolicy::PauseServer)
+	{
+		PendingFlowControl = bAboveHighWater ? 1 : 0;
+	}
+
+	OnPushBacklog.Broadcast(bAboveHighWater);
+}
+
+void FWebSocketClient::SendPendingFlowControl()
+{
+	if (PendingFlowControl.load(std::memory_order_relaxed) == INDEX_NONE) return;
+	const int32 Paused = PendingFlowControl.exchange(INDEX_NONE);
+	if (Paused == INDEX_NONE) return;
+
+	// Every socket of the pool carries pushes, so each one is paused or resumed rather than one routed to
+	FFlowControlRequestData FlowControl;
+	FlowControl.Paused = Paused != 0;
+	std::unique_lock<std::mutex> Lock(SendMutex);
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		if (!Connection->bConnected) continue;
+		const IWebSocketCodec& Codec = *Connection->Codec.load(std::memory_order_acquire);
+		SendBuffer.Reset();
+		Codec.WriteRequest(Counter.fetch_add(1) + 1, false, TWebSocketMessage<FFlowControlRequestData>::GetMsgType(), FString(), FFlowControlRequestData::StaticStruct(), &FlowControl, SendBuffer);
+		Connection->Socket->Send(SendBuffer.GetData(), SendBuffer.Num(), Codec.IsBinary());
+		++RequestsSent;
+		++FramesSent;
+		BytesSent += SendBuffer.Num();
+	}
+}
+
+bool FWebSocketClient::DequeuePush(FQueuedPush& OutPush)
+{
+	for (const TUniquePtr<TBoundedMpscQueue<FQueuedPush>>& Queue : PushMessageQueues)
+	{
+		if (Queue->TryDequeue(OutPush))
+		{
+			const int32 Depth = --PushQueueDepth;
+			if (Depth <= Configuration.Push_Low_Water && bAbovePushHighWater.load(std::memory_order_relaxed) && bAbovePushHighWater.exchange(false))
+			{
+				SetPushBacklog(false);
+			}
+			return true;
+		}
+	}
+
+	// Coalesced overflow is only dispatched once everything queued before it has been
+	if (OverflowPushCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::unique_lock<std::mutex> Lock(OverflowPushesMutex);
+		auto It = OverflowPushes.CreateIterator();
+		if (It)
+		{
+			OutPush = MoveTemp(It.Value());
+			It.RemoveCurrent();
+			--OverflowPushCount;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FWebSocketClient::DispatchPushMessages()
+{
+	const double Start = FPlatformTime::Seconds();
+	const double Deadline = Start + Configuration.Push_Budget_Us / 1000000.0;
+
+	// Pushes arrive decoded and carry their handler, so dispatch is a dequeue and a call
+	FQueuedPush Push;
+	while (DequeuePush(Push))
+	{
+		// The queued entry stands in for the newest push of its event and key
+		if (Push.Handler->Options.bLatestWins)
+		{
+			std::unique_lock<std::mutex> Lock(LatestPushesMutex);
+			if (TUniqueFunction<void()>* Latest = LatestPushes.Find(Push.Key))
+			{
+				Push.Invoke = MoveTemp(*Latest);
+				LatestPushes.Remove(Push.Key);
+			}
+		}
+
+		Push.Invoke();
+		++PushesDispatched;
+
+		if (FPlatformTime::Seconds() >= Deadline) break;
+	}
+
+	LastDispatchUs = (FPlatformTime::Seconds() - Start) * 1000000.0;
+	MaxDispatchUs = FMath::Max(MaxDispatchUs, LastDispatchUs);
+}
+
+void FWebSocketClient::RunOnGameThread(TUniqueFunction<void()> Callback)
+{
+	// Counted first, so the drain never sees more dequeued than counted
+	++GameThreadMailboxDepth;
+	GameThreadMailbox.Enqueue(MoveTemp(Callback));
+}
+
+bool FWebSocketClient::DrainGameThreadMailbox(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WebSocketGameThreadCallbacks);
+	const double Start = FPlatformTime::Seconds();
+	const double Budget = Configuration.Game_Thread_Budget_Us / 1000000.0;
+
+	// Callbacks queued by the ones run here wait for the next frame, so the drain always ends
+	const int32 Queued = GameThreadMailboxDepth.load();
+	int32 Ran = 0;
+	TUniqueFunction<void()> Callback;
+	while (Ran < Queued && (Ran == 0 || FPlatformTime::Seconds() - Start < Budget) && GameThreadMailbox.Dequeue(Callback))
+	{
+		--GameThreadMailboxDepth;
+		++Ran;
+		Callback();
+	}
+
+	if (Ran > 0)
+	{
+		GameThreadCallbacks += Ran;
+		GameThreadFrameTime.Record(static_cast<uint64>((FPlatformTime::Seconds() - Start) * 1000000.0));
+	}
+	return true;
+}
+
+FPushDispatchStats FWebSocketClient::GetPushDispatchStats() const
+{
+	FPushDispatchStats Stats;
+	Stats.QueueDepth = PushQueueDepth;
+	Stats.Dispatched = PushesDispatched;
+	Stats.Coalesced = PushesCoalesced;
+	Stats.Dropped = PushesDropped;
+	Stats.Overflowed = PushesOverflowed;
+	Stats.HighWaterCrossings = PushHighWaterCrossings;
+	Stats.MaxQueueDepth = MaxPushQueueDepth;
+	Stats.LastDispatchUs = LastDispatchUs;
+	Stats.MaxDispatchUs = MaxDispatchUs;
+	return Stats;
+}
+
+TArray<ANSICHAR>& FWebSocketClient::OpenOutboxEntryLocked(FPooledConnection& Connection, const IWebSocketCodec& Codec)
+{
+	// A batch holds one codec only, so a codec switch sends off what was written with the old one
+	if (Connection.OutboxCount > 0 && Connection.OutboxCodec != &Codec)
+	{
+		FlushOutboxLocked(Connection);
+	}
+
+	if (Connection.OutboxCount == 0)
+	{
+		Connection.OutboxCodec = &Codec;
+		Codec.BeginBatch(Connection.Outbox);
+	}
+	else
+	{
+		Codec.WriteBatchSeparator(Connection.Outbox);
+	}
+	return Connection.Outbox;
+}
+
+void FWebSocketClient::CloseOutboxEntryLocked(FPooledConnection& Connection)
+{
+	++Connection.OutboxCount;
+
+	if (Connection.Outbox.Num() >= Configuration.Outbox_Max_Bytes)
+	{
+		FlushOutboxLocked(Connection);
+		return;
+	}
+
+	if (Connection.OutboxCount == 1 && Configuration.Flush_Policy == EOutboxFlushPolicy::ByTime)
+	{
+		const uint64 Generation = Connection.OutboxGeneration;
+		FPooledConnection* Pooled = &Connection;
+		if (Configuration.Reactor.IsValid())
+		{
+			// A reactor timer, rather than a task graph worker asleep for the whole window
+			Configuration.Reactor->PostAfter(ReactorKey, Configuration.Outbox_Window_Us / 1000000.0, [this, Pooled, Generation]()
+			{
+				std::unique_lock<std::mutex> Lock(SendMutex);
+				if (Pooled->OutboxGeneration == Generation)
+				{
+					FlushOutboxLocked(*Pooled);
+				}
+			});
+			return;
+		}
+		// Only the flush is guarded, so a client being destroyed does not wait out the window
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Window = Configuration.Outbox_Window_Us / 1000000.0f, Flush = WhileAlive([this, Pooled, Generation]()
+		{
+			std::unique_lock<std::mutex> Lock(SendMutex);
+			if (Pooled->OutboxGeneration == Generation)
+			{
+				FlushOutboxLocked(*Pooled);
+			}
+		})]() mutable
+		{
+			FPlatformProcess::Sleep(Window);
+			Flush();
+		});
+	}
+}
+
+void FWebSocketClient::FlushOutbox()
+{
+	std::unique_lock<std::mutex> Lock(SendMutex);
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		FlushOutboxLocked(*Connection);
+	}
+}
+
+void FWebSocketClient::FlushOutboxLocked(FPooledConnection& Connection)
+{
+	if (Connection.OutboxCount == 0) return;
+
+	Connection.OutboxCodec->EndBatch(Connection.OutboxCount, Connection.Outbox);
+	UE_LOG(LogTemp, Verbose, TEXT("Flushing %d batched requests on connection %d (%d bytes of %s)"), Connection.OutboxCount, Connection.Index, Connection.Outbox.Num(), Connection.OutboxCodec->GetName());
+
+	// Before the first connect there is no socket yet; the retained requests in the batch go out with the resend
+	if (Connection.Socket.IsValid())
+	{
+		Connection.Socket->Send(Connection.Outbox.GetData(), Connection.Outbox.Num(), Connection.OutboxCodec->IsBinary());
+		++FramesSent;
+		BytesSent += Connection.Outbox.Num();
+	}
+
+	// Reset keeps the allocation for the next batch
+	Connection.Outbox.Reset();
+	Connection.OutboxCount = 0;
+	++Connection.OutboxGeneration;
+}
+
+bool FWebSocketClient::FlushOutboxTick(float DeltaTime)
+{
+	SendPendingFlowControl();
+
+	// ByTime batches are flushed by their own timer
+	if (Configuration.Flush_Policy == EOutboxFlushPolicy::PerTick || Configuration.Flush_Policy == EOutboxFlushPolicy::BySize)
+	{
+		FlushOutbox();
+	}
+	return true;
+}
+
+FWebSocketOutboxStats FWebSocketClient::GetOutboxStats() const
+{
+	FWebSocketOutboxStats Stats;
+	Stats.RequestsSent = RequestsSent;
+	Stats.FramesSent = FramesSent;
+	Stats.FramesSaved = Stats.RequestsSent > Stats.FramesSent ? Stats.RequestsSent - Stats.FramesSent : 0;
+	Stats.MessagesReceived = MessagesReceived;
+	Stats.FramesReceived = FramesReceived;
+	Stats.FramesReceivedSaved = Stats.MessagesReceived > Stats.FramesReceived ? Stats.MessagesReceived - Stats.FramesReceived : 0;
+	return Stats;
+}
+
+int32 FWebSocketClient::CountRequest(const FName MsgType)
+{
+	{
+		FRWScopeLock Lock(MessageTypesLock, SLT_ReadOnly);
+		if (const int32* Index = MessageTypeIndices.Find(MsgType))
+		{
+			++MessageTypes[*Index]->Requests;
+			return *Index;
+		}
+	}
+
+	FRWScopeLock Lock(MessageTypesLock, SLT_Write);
+	int32& Index = MessageTypeIndices.FindOrAdd(MsgType, INDEX_NONE);
+	if (Index == INDEX_NONE)
+	{
+		Index = MessageTypes.Add(MakeUnique<FMessageTypeStats>());
+		MessageTypes[Index]->MsgType = MsgType;
+	}
+	++MessageTypes[Index]->Requests;
+	return Index;
+}
+
+void FWebSocketClient::TrackCancellation(const uint64 Id, const FRequestCancellationToken& Token, const uint64 Handle)
+{
+	{
+		// Resolving moves the slot out of Pending before the release handler takes this lock, so a request seen
+		// pending here is one whose handler will find the registration
+		std::unique_lock<std::mutex> Lock(CancelRegistrationsMutex);
+		if (PendingRequests->IsPending(Id))
+		{
+			FCancelRegistration& Registration = CancelRegistrations[static_cast<int32>(Id % CancelRegistrations.Num())];
+			Registration.Id = Id;
+			Registration.Token = Token;
+			Registration.Handle = Handle;
+			return;
+		}
+	}
+	Token.RemoveOnCancel(Handle);
+}
+
+void FWebSocketClient::OnRequestReleased(const FPendingRequestRelease& Release, const TSharedPtr<FWebSocketResponse>& Result)
+{
+	--Connections[Release.Channel]->InFlight;
+
+	FCancelRegistration Registration;
+	{
+		std::unique_lock<std::mutex> Lock(CancelRegistrationsMutex);
+		FCancelRegistration& Slot = CancelRegistrations[static_cast<int32>(Release.Id % CancelRegistrations.Num())];
+		if (Slot.Id == Release.Id)
+		{
+			Registration = MoveTemp(Slot);
+			Slot = FCancelRegistration();
+		}
+	}
+	// Outside the lock, since a token being cancelled calls back into CancelRequest
+	Registration.Token.RemoveOnCancel(Registration.Handle);
+
+	FMessageTypeStats* Stats;
+	{
+		FRWScopeLock Lock(MessageTypesLock, SLT_ReadOnly);
+		Stats = MessageTypes[Release.Category].Get();
+	}
+
+	switch (Release.State)
+	{
+	case EPendingRequestState::TimedOut:
+		++RequestTimeouts;
+		++Stats->Timeouts;
+		break;
+	case EPendingRequestState::Cancelled:
+		++RequestsCancelled;
+		++Stats->Cancelled;
+		break;
+	default:
+		// Errors made up locally, on a disconnect for one, never made the round trip, so only answers are timed
+		if (Result.IsValid() && Result->IsError())
+		{
+			++RequestErrors;
+			++Stats->Errors;
+		}
+		else
+		{
+			const uint64 ElapsedUs = static_cast<uint64>(Release.Elapsed * 1000000.0);
+			RequestLatency.Record(ElapsedUs);
+			Stats->Latency.Record(ElapsedUs);
+		}
+		break;
+	}
+}
+
+FWebSocketClientStats FWebSocketClient::GetStats(const EWebSocketStatsFields Fields) const
+{
+	FWebSocketClientStats Stats;
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		Stats.InFlight += Connection->InFlight;
+	}
+	Stats.Requests = RequestsSent;
+	Stats.Timeouts = RequestTimeouts;
+	Stats.Errors = RequestErrors;
+	Stats.Cancelled = RequestsCancelled;
+	Stats.P50Ms = RequestLatency.GetPercentile(50.0) / 1000.0;
+	Stats.P99Ms = RequestLatency.GetPercentile(99.0) / 1000.0;
+	Stats.P999Ms = RequestLatency.GetPercentile(99.9) / 1000.0;
+	Stats.PushQueueDepth = PushQueueDepth;
+	Stats.BytesSent = BytesSent;
+	Stats.BytesReceived = BytesReceived;
+	Stats.FramesSent = FramesSent;
+	Stats.FramesReceived = FramesReceived;
+	Stats.ReconnectAttempts = ReconnectAttempts;
+	Stats.Reconnects = Reconnects;
+	Stats.GameThreadQueueDepth = GameThreadMailboxDepth;
+	Stats.GameThreadCallbacks = GameThreadCallbacks;
+	Stats.GameThreadP50Us = GameThreadFrameTime.GetPercentile(50.0);
+	Stats.GameThreadP99Us = GameThreadFrameTime.GetPercentile(99.0);
+	Stats.GameThreadMaxUs = GameThreadFrameTime.GetMax();
+	if (EnumHasAnyFlags(Fields, EWebSocketStatsFields::Memory))
+	{
+		Stats.AllocatedBytes = GetAllocatedSize();
+	}
+	if (!EnumHasAnyFlags(Fields, EWebSocketStatsFields::MessageTypes)) return Stats;
+
+	FRWScopeLock Lock(MessageTypesLock, SLT_ReadOnly);
+	for (const TUniquePtr<FMessageTypeStats>& Type : MessageTypes)
+	{
+		FWebSocketMessageTypeStats& Out = Stats.MessageTypes.AddDefaulted_GetRef();
+		Out.MsgType = Type->MsgType;
+		Out.Requests = Type->Requests;
+		Out.Responses = Type->Latency.GetCount();
+		Out.Timeouts = Type->Timeouts;
+		Out.Errors = Type->Errors;
+		Out.Cancelled = Type->Cancelled;
+		Out.MeanMs = Type->Latency.GetMean() / 1000.0;
+		Out.P50Ms = Type->Latency.GetPercentile(50.0) / 1000.0;
+		Out.P99Ms = Type->Latency.GetPercentile(99.0) / 1000.0;
+		Out.P999Ms = Type->Latency.GetPercentile(99.9) / 1000.0;
+		Out.MaxMs = Type->Latency.GetMax() / 1000.0;
+	}
+	return Stats;
+}
+
+SIZE_T FWebSocketClient::GetAllocatedSize() const
+{
+	SIZE_T Size = sizeof(*this) + sizeof(*PendingRequests) + PendingRequests->GetAllocatedSize() + sizeof(*Deadlines) + Deadlines->GetAllocatedSize();
+	for (const TUniquePtr<TBoundedMpscQueue<FQueuedPush>>& Queue : PushMessageQueues)
+	{
+		Size += sizeof(*Queue) + Queue->GetAllocatedSize();
+	}
+	{
+		std::unique_lock<std::mutex> Lock(SendMutex);
+		Size += SendBuffer.GetAllocatedSize() + Connections.GetAllocatedSize();
+		for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+		{
+			Size += sizeof(*Connection) + Connection->Outbox.GetAllocatedSize();
+		}
+	}
+	{
+		std::unique_lock<std::mutex> Lock(UnackedRequestsMutex);
+		Size += UnackedRequests.GetAllocatedSize() + FreeFrames.GetAllocatedSize();
+		for (const TPair<uint64, FUnackedRequest>& Pair : UnackedRequests)
+		{
+			Size += Pair.Value.Frame.GetAllocatedSize();
+		}
+		for (const TArray<ANSICHAR>& Frame : FreeFrames)
+		{
+			Size += Frame.GetAllocatedSize();
+		}
+	}
+	{
+		FRWScopeLock Lock(MessageTypesLock, SLT_ReadOnly);
+		Size += MessageTypes.GetAllocatedSize() + MessageTypeIndices.GetAllocatedSize() + MessageTypes.Num() * sizeof(FMessageTypeStats);
+	}
+	return Size;
+}
+
+bool FWebSocketClient::IsCodecOffered(const IWebSocketCodec& Codec) const
+{
+	for (const FString& Name : Configuration.Codecs)
+	{
+		if (IWebSocketCodec::FindByName(Name) == &Codec)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FWebSocketClient::IsConnected() const
+{
+	return Connected;
+}
+
+void FWebSocketClient::RetainUnacked(const uint64 Id, const IWebSocketCodec& Codec, const ANSICHAR* Frame, const int32 Length, const uint32 TimeoutMs, const EResendPolicy Policy, const int32 Connection)
+{
+	std::unique_lock<std::mutex> Lock(UnackedRequestsMutex);
+	FUnackedRequest Request;
+	if (Policy == EResendPolicy::Resend)
+	{
+		if (FreeFrames.Num() > 0)
+		{
+			Request.Frame = FreeFrames.Pop(false);
+		}
+		Request.Frame.Append(Frame, Length);
+	}
+	Request.bBinary = Codec.IsBinary();
+	Request.TimeoutMs = TimeoutMs;
+	Request.Policy = Policy;
+	Request.Connection = Connection;
+	UnackedRequests.Add(Id, MoveTemp(Request));
+}
+
+void FWebSocketClient::RecycleFrameLocked(TArray<ANSICHAR>&& Frame)
+{
+	// Never more pooled than could be retained at once
+	if (Frame.Max() == 0 || Frame.Max() > MaxPooledFrameBytes || FreeFrames.Num() >= Configuration.Max_In_Flight) return;
+
+	Frame.Reset();
+	FreeFrames.Add(MoveTemp(Frame));
+}
+
+void FWebSocketClient::HoldUnacked(const int32 Connection)
+{
+	TArray<uint64> Failed;
+	{
+		std::unique_lock<std::mutex> Lock(UnackedRequestsMutex);
+		for (auto It = UnackedRequests.CreateIterator(); It; ++It)
+		{
+			if (It.Value().Connection != Connection)
+			{
+				continue;
+			}
+			if (It.Value().Policy == EResendPolicy::FailFast)
+			{
+				Failed.Add(It.Key());
+				It.RemoveCurrent();
+			}
+			else
+			{
+				// Held without a deadline until the resend gives it a fresh one
+				PendingRequests->SetDeadline(It.Key(), TNumericLimits<double>::Max());
+			}
+		}
+	}
+
+	// Completed outside the lock since continuations run inline and may send again
+	for (const uint64 Id : Failed)
+	{
+		PendingRequests->Complete(Id, MakeErrorResponse(Id, TEXT("Disconnected")));
+	}
+}
+
+void FWebSocketClient::ResendUnacked(FPooledConnection& Connection)
+{
+	// Copied out so nothing is sent under the lock that SendRequest takes while holding SendMutex
+	TArray<TPair<uint64, FUnackedRequest>> Resend;
+	{
+		std::unique_lock<std::mutex> Lock(UnackedRequestsMutex);
+		UnackedRequests.KeySort(TLess<uint64>());
+		for (const TPair<uint64, FUnackedRequest>& Pair : UnackedRequests)
+		{
+			if (Pair.Value.Policy == EResendPolicy::Resend && Pair.Value.Connection == Connection.Index)
+			{
+				Resend.Add(Pair);
+			}
+		}
+	}
+	if (Resend.Num() == 0) return;
+
+	UE_LOG(LogTemp, Log, TEXT("Resending %d unacknowledged requests on connection %d"), Resend.Num(), Connection.Index);
+	std::unique_lock<std::mutex> Lock(SendMutex);
+	for (const TPair<uint64, FUnackedRequest>& Pair : Resend)
+	{
+		const double Deadline = FPlatformTime::Seconds() + Pair.Value.TimeoutMs / 1000.0;
+		if (PendingRequests->SetDeadline(Pair.Key, Deadline))
+		{
+			Deadlines->Schedule(Pair.Key, Deadline);
+			Connection.Socket->Send(Pair.Value.Frame.GetData(), Pair.Value.Frame.Num(), Pair.Value.bBinary);
+			++FramesSent;
+			BytesSent += Pair.Value.Frame.Num();
+		}
+	}
+}
+
+void FWebSocketClient::FailUnacked(const FString& Message, const int32 Connection)
+{
+	TArray<uint64> Failed;
+	{
+		std::unique_lock<std::mutex> Lock(UnackedRequestsMutex);
+		for (auto It = UnackedRequests.CreateIterator(); It; ++It)
+		{
+			if (Connection == INDEX_NONE || It.Value().Connection == Connection)
+			{
+				Failed.Add(It.Key());
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	for (const uint64 Id : Failed)
+	{
+		PendingRequests->Complete(Id, MakeErrorResponse(Id, Message));
+	}
+}
+
+void FWebSocketClient::ForgetUnacked(const uint64 Id)
+{
+	std::unique_lock<std::mutex> Lock(UnackedRequestsMutex);
+	FUnackedRequest Request;
+	if (UnackedRequests.RemoveAndCopyValue(Id, Request))
+	{
+		RecycleFrameLocked(MoveTemp(Request.Frame));
+	}
+}
+
+const FString& FWebSocketClient::MakeIdempotencyKeyLocked(uint64 Id)
+{
+	IdempotencyKeyBuffer.Reset(ClientKey.Len() + 21);
+	IdempotencyKeyBuffer += ClientKey;
+	IdempotencyKeyBuffer += TEXT('-');
+
+	// Digits written by hand, since Printf and LexToString both return a new string
+	TCHAR Digits[20];
+	int32 NumDigits = 0;
+	do
+	{
+		Digits[NumDigits++] = TEXT('0') + static_cast<TCHAR>(Id % 10);
+		Id /= 10;
+	}
+	while (Id > 0);
+	while (NumDigits > 0)
+	{
+		IdempotencyKeyBuffer.AppendChar(Digits[--NumDigits]);
+	}
+	return IdempotencyKeyBuffer;
+}
+
+EConnectionState FWebSocketClient::GetConnectionState() const
+{
+	return ConnectionState;
+}
+
+FWebSocketRttStats FWebSocketClient::GetRttStats(const int32 Connection) const
+{
+	return Connections.IsValidIndex(Connection) ? Connections[Connection]->Rtt.GetStats() : FWebSocketRttStats();
+}
+
+FString FWebSocketClient::GetEndpoint(const int32 Connection) const
+{
+	return Connections.IsValidIndex(Connection) ? Connections[Connection]->Endpoint : FString();
+}
+
+void FWebSocketClient::Quit()
+{
+	QuittingFlag = true;
+	EndpointRanking->CancelProbe();
+	if (bWaitingForProbe)
+	{
+		bWaitingForProbe = false;
+		for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+		{
+			SetConnectionState(*Connection, EConnectionState::Disconnected);
+		}
+		FailUnacked(TEXT("Disconnected"));
+	}
+	for (const TUniquePtr<FPooledConnection>& Connection : Connections)
+	{
+		if (Connection->ReconnectTickerHandle.IsValid())
+		{
+			FTicker::GetCoreTicker().RemoveTicker(Connection->ReconnectTickerHandle);
+			Connection->ReconnectTickerHandle.Reset();
+			SetConnectionState(*Connection, EConnectionState::Disconnected);
+			FailUnacked(TEXT("Disconnected"), Connection->Index);
+		}
 	}
 }
@@ -2,33 +2,255 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "Async/Future.h"
+#include "Containers/Ticker.h"
+#include "Misc/ScopeRWLock.h"
 #include "IWebSocket.h"
 #include "JsonObjectConverter.h"
+#include "Misc/Paths.h"
+#include "Templates/ValueOrError.h"
 #include "WebSocketsModule.h"
-#include <condition_variable>
+#include <atomic>
 #include <mutex>
-#include <shared_mutex>
-#include <chrono>
-#include <thread>
-using namespace std::chrono_literals;
 
+#include "BoundedMpscQueue.h"
+#include "DeadlineWheel.h"
+#include "EndpointRanking.h"
+#include "LatencyHistogram.h"
+#include "PendingRequestTable.h"
+#include "RequestCancellationToken.h"
+#include "RttEstimator.h"
+#include "WebSocketAwaitable.h"
+#include "WebSocketCodec.h"
+#include "WebSocketReactor.h"
+#include "WebSocketResponse.h"
+#include "WebSocketStats.h"
 #include "WebSocketStructs.h"
 
+enum class EOutboxFlushPolicy : uint8
+{
+	// Every request goes out as its own frame as soon as it is sent
+	Immediate,
+	// Requests sent during a tick are batched into one frame, flushed on the next core tick
+	PerTick,
+	// Requests are batched until the frame reaches Outbox_Max_Bytes, and flushed on the next tick at the latest
+	BySize,
+	// Requests are batched for Outbox_Window_Us after the first one
+	ByTime
+};
+
+enum class EPushPriority : uint8
+{
+	High,
+	Normal,
+	Low,
+	Num
+};
+
+enum class EPushDecodeThread : uint8
+{
+	// Decoded inline on the thread that delivers socket events
+	Receive,
+	// Decoded on a background worker, in arrival order
+	Worker
+};
+
+enum class EPushOverflowPolicy : uint8
+{
+	// Discards the oldest queued push of the same priority to make room
+	DropOldest,
+	DropNewest,
+	// Overflowing pushes collapse to the newest one per event, dispatched once the queue has drained
+	Coalesce,
+	// Asks the server to pause pushes at Push_High_Water and resume at Push_Low_Water; overflow drops the newest
+	PauseServer
+};
+
+enum class EConnectionState : uint8
+{
+	Disconnected,
+	Connecting,
+	Connected,
+	// Waiting out the backoff delay before the next reconnect attempt
+	WaitingToReconnect,
+	Reconnecting,
+	// The retry budget ran out without reconnecting
+	GaveUp
+};
+
+// What happens to an acked request that is still unanswered when the connection drops
+enum class EResendPolicy : uint8
+{
+	// Kept with its serialized bytes and re-sent, with an idempotency key, once reconnected
+	Resend,
+	// Fails straight away with a "Disconnected" error
+	FailFast,
+	// Left to time out
+	Drop
+};
+
+// How requests are spread over the connections of a pool
+enum class EPoolRouting : uint8
+{
+	// Each request goes to the connected socket with the fewest acked requests in flight
+	LeastInFlight,
+	// Requests with the same shard key always go to the same socket, so they stay in order relative to each other
+	ShardKey
+};
+
+struct FPushOptions
+{
+	// Higher priority events are dispatched first
+	EPushPriority Priority = EPushPriority::Normal;
+
+	// A push that arrives while an earlier one for the same event and coalescing key is still queued replaces it
+	bool bLatestWins = false;
+
+	EPushDecodeThread DecodeThread = EPushDecodeThread::Worker;
+
+	/**
+	 * Which entity a decoded push is about, so latest-wins and Coalesce overflow only replace pushes for the same one,
+	 * e.g. one position per unit rather than one for all units. Unset, every push of the event shares one key. Set it
+	 * with SetCoalescingKey, whose T must be the type the handler is registered with.
+	 */
+	TFunction<FString(const void*)> CoalescingKey;
+	const UScriptStruct* CoalescingKeyType = nullptr;
+
+	template <typename T, typename FuncType>
+	FPushOptions& SetCoalescingKey(FuncType GetKey)
+	{
+		CoalescingKey = [GetKey](const void* Message)
+		{
+			return LexToString(GetKey(*static_cast<const T*>(Message)));
+		};
+		CoalescingKeyType = T::StaticStruct();
+		return *this;
+	}
+};
+
 struct FWebSocketConfiguration
 {
 	/**
 	 * Default config values
 	 */
+	// Endpoint used when Endpoints is empty
+	FString Url = TEXT("ws://localhost:5000/ws");
+
+	// Endpoints of the same service; connecting probes them all at once and uses the one with the fastest handshake,
+	// and a dropped connection fails over to the next best
+	TArray<FString> Endpoints;
+
+	// Where the endpoint ranking is kept between sessions, so later sessions connect without waiting for a probe
+	FString Endpoint_Cache_File = FPaths::ProjectSavedDir() / TEXT("WebSocketEndpoints.txt");
+
+	int32 Probe_Timeout_Ms = 2000;
+
+	// Sockets to open to Url; requests are spread over them by Pool_Routing, while ids and pushes stay shared
+	int32 Pool_Size = 1;
+
+	EPoolRouting Pool_Routing = EPoolRouting::LeastInFlight;
+
+	// Reconnect attempts allowed per outage, per connection
 	int32 Num_Retries = 10;
 
-	int32 Sleep_Length = 3;
+	// Upper bound, in seconds, on the delay before a reconnect attempt
+	int32 Sleep_Length = 30;
+
+	// The delay before the first reconnect attempt is drawn from [0, Reconnect_Base_Delay] seconds, doubling each attempt
+	float Reconnect_Base_Delay = 0.5f;
+
+	// Interval between heartbeats on each connection; 0 turns heartbeats, and half-open detection, off
+	int32 Heartbeat_Interval_Ms = 1000;
+
+	// A connection that hears nothing from the server for this many heartbeat intervals is treated as dropped
+	int32 Heartbeat_Misses_Allowed = 2;
+
+	// Requests sent with a TimeoutMs of 0 wait this many measured round trips, and at least Min_Timeout_Ms
+	float Timeout_Rtt_Multiplier = 4.0f;
+
+	int32 Min_Timeout_Ms = 50;
+
+	// Timeout of those requests until the first heartbeat has measured the round trip
+	int32 Default_Timeout_Ms = 5000;
+
+	// Size of the pending request table; at most this many acked requests can be in flight
+	int32 Max_In_Flight = 4096;
+
+	// Request deadlines are tracked on a timer wheel with this many buckets of Timer_Resolution_Ms each
+	int32 Timer_Resolution_Ms = 10;
+
+	int32 Timer_Wheel_Buckets = 512;
+
+	/**
+	 * Codecs to offer as "mgs.<name>" subprotocols, most preferred first; empty sends plain JSON without negotiating.
+	 * Each socket sends JSON until the server's first frame shows which codec it picked.
+	 */
+	TArray<FString> Codecs;
+
+	// Without negotiation nothing is offered and each socket sends in the first of Codecs from the start, for servers
+	// known to speak it that cannot negotiate, such as the stand-in server
+	bool Negotiate_Codecs = true;
+
+	// How requests are batched into array frames; every policy but Immediate also flushes at Outbox_Max_Bytes
+	EOutboxFlushPolicy Flush_Policy = EOutboxFlushPolicy::Immediate;
+
+	int32 Outbox_Max_Bytes = 16 * 1024;
+
+	int32 Outbox_Window_Us = 500;
+
+	// Time DispatchPushMessages may spend on handlers per call; at least one push is always dispatched
+	int32 Push_Budget_Us = 1000;
+
+	// Capacity of the queue for each push priority
+	int32 Push_Queue_Capacity = 1024;
+
+	EPushOverflowPolicy Push_Overflow_Policy = EPushOverflowPolicy::DropOldest;
+
+	// Queued pushes, over all priorities, at which OnPushBacklog reports falling behind and then catching up again
+	int32 Push_High_Water = 768;
+
+	int32 Push_Low_Water = 256;
+
+	// Game-thread time the mailbox drain may spend on RunOnGameThread callbacks per frame; at least one always runs
+	int32 Game_Thread_Budget_Us = 2000;
+
+	// Shared by many clients to drive their timers and background work on a fixed set of threads; unset, the
+	// client registers its own tickers and decodes pushes on the task graph
+	TSharedPtr<FWebSocketReactor> Reactor;
+};
+
+struct FWebSocketOutboxStats
+{
+	uint64 RequestsSent = 0;
+	uint64 FramesSent = 0;
+	// Frames not sent thanks to batching, i.e. RequestsSent - FramesSent
+	uint64 FramesSaved = 0;
+
+	uint64 MessagesReceived = 0;
+	uint64 FramesReceived = 0;
+	uint64 FramesReceivedSaved = 0;
 };
 
-struct FWebSocketAsyncAwaitResponse
+struct FPushDispatchStats
 {
-	bool IsConnected = false;
+	int32 QueueDepth = 0;
+	uint64 Dispatched = 0;
+	// Pushes replaced in the queue by a newer one for the same latest-wins event
+	uint64 Coalesced = 0;
+	// Pushes with no handler, or discarded by the overflow policy
+	uint64 Dropped = 0;
+	// Pushes that arrived to a full queue
+	uint64 Overflowed = 0;
+	uint64 HighWaterCrossings = 0;
+	int32 MaxQueueDepth = 0;
+	double LastDispatchUs = 0.0;
+	double MaxDispatchUs = 0.0;
 };
 
+template <typename TResponseData>
+class TWebSocketResponseReceiver;
+
 class WEBSOCKETTEST_API FWebSocketClient
 {
 	public:
@@ -41,6 +263,8 @@ class WEBSOCKETTEST_API FWebSocketClient
 
 	FWebSocketClient();
 
+	~FWebSocketClient();
+
 	void SetNumRetries(int32);
 
 	void SetSleepLength(int32);
@@ -51,74 +275,135 @@ class WEBSOCKETTEST_API FWebSocketClient
 
 	bool IsConnected() const;
 
+	EConnectionState GetConnectionState() const;
+
+	// The endpoint the connection is using, or will use for its next attempt
+	FString GetEndpoint(int32 Connection = 0) const;
+
+	// Round trip time and server clock offset measured by the connection's heartbeats
+	FWebSocketRttStats GetRttStats(int32 Connection = 0) const;
 
-	// Prevents the game from crashing if the client is in the middle of trying to reconnect
+	// Full jitter: uniform in [0, min(MaxDelay, BaseDelay * 2^Attempt)] seconds
+	static float DrawReconnectDelay(float BaseDelay, float MaxDelay, int32 Attempt);
+
+	// Stops any pending reconnect so the client can be torn down; call on the game thread
 	void Quit();
+	// Appends the request envelope and its reflected data to OutBuffer in the first connection's codec, in a single pass
 	template <typename TRequest>
-	TSharedPtr<FJsonObject> CreateWebSocketRequest(const TRequest& Data, const bool AckRequired)
+	void CreateWebSocketRequest(const TRequest& Data, const uint64 Id, const bool AckRequired, TArray<ANSICHAR>& OutBuffer) const
 	{
-		TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
-		JsonObject->SetNumberField("id", ++Counter > 0 ? Counter : 1);
-		JsonObject->SetNumberField("ack", AckRequired ? 1 : 0);
-		JsonObject->SetStringField("msgType", Data.GetName());
-		JsonObject->SetObjectField("data", FJsonObjectConverter::UStructToJsonObject(Data));
-		return JsonObject;
+		GetCodec().WriteRequest(Id, AckRequired, TWebSocketMessage<TRequest>::GetMsgType(), FString(), TRequest::StaticStruct(), &Data, OutBuffer);
 	}
 
-	template <typename TRequest, typename TResponseData>
-	TResponseData SendAsync(const TRequest& RequestData, const bool AckRequired = true, uint TimeoutMs = 5000)
+	// The codec requests on the connection are currently written with
+	const IWebSocketCodec& GetCodec(const int32 Connection = 0) const
 	{
-		FString JsonRequest;
-		auto WebSocketRequest = CreateWebSocketRequest(RequestData, AckRequired);
-
-		if (AckRequired)
-		{
-			// FWebSocketResponse Response {nullptr, false};
-			WriteAckMap(WebSocketRequest->GetNumberField("id"), nullptr);
-		}
-		const auto Writer = TJsonWriterFactory<>::Create(&JsonRequest);
-		FJsonSerializer::Serialize(WebSocketRequest.ToSharedRef(), Writer);
+		return Connections.IsValidIndex(Connection) ? *Connections[Connection]->Codec.load(std::memory_order_acquire) : IWebSocketCodec::Json();
+	}
 
-		UE_LOG(LogTemp, Log, TEXT("%s"), *JsonRequest);
+	/**
+	 * Sends the request and blocks until it is answered. The response type and whether an ack is required default
+	 * to what TRequest declares with DECLARE_WEBSOCKET_MESSAGE. A TimeoutMs of 0 adapts the timeout to the
+	 * connection's measured round trip time. ShardKey picks the connection under EPoolRouting::ShardKey; left empty,
+	 * the message type is used.
+	 */
+	template <typename TRequest, typename TResponseData = typename TWebSocketMessage<TRequest>::FResponse>
+	TResponseData SendAsync(const TRequest& RequestData, const bool AckRequired = TWebSocketMessage<TRequest>::bAck, uint TimeoutMs = 0, const EResendPolicy ResendPolicy = EResendPolicy::Resend, const FRequestCancellationToken& CancellationToken = FRequestCancellationToken(), const FString& ShardKey = FString())
+	{
+		CheckResponseType<TRequest, TResponseData>();
+		uint64 Id = 0;
+		const auto AckFuture = SendRequest(RequestData, AckRequired, TimeoutMs, ResendPolicy, CancellationToken, ShardKey, Id);
 
-		WebSocket->Send(JsonRequest);
+		if (!AckRequired) return {};
 
-		UE_LOG(LogTemp, Log, TEXT("Request sent"));
+		UE_LOG(LogTemp, Verbose, TEXT("Waiting for response %llu"), Id);
 
-		if (!AckRequired) return {};
+		//If there is an error event, or the request timed out, it is thrown as an FMgsError
+		auto Response = ToResponse<TResponseData>(WaitForAck(Id, AckFuture, TimeoutMs));
+		if (Response.HasError())
+		{
+			throw Response.StealError();
+		}
+		return Response.StealValue();
+	};
 
-		UE_LOG(LogTemp, Log, TEXT("Before Async"));
+	/**
+	 * Sends the request without an ack and returns at once; the way to send types that declare no response, such as
+	 * heartbeats and flow control. Nothing is retained, so a request sent while the connection is down is lost.
+	 */
+	template <typename TRequest>
+	void Post(const TRequest& RequestData, const FString& ShardKey = FString())
+	{
+		static_assert(TWebSocketMessage<TRequest>::bDeclared, "Declare the request type with DECLARE_WEBSOCKET_MESSAGE before sending it");
+		uint TimeoutMs = 0;
+		uint64 Id = 0;
+		SendRequest(RequestData, false, TimeoutMs, EResendPolicy::Drop, FRequestCancellationToken(), ShardKey, Id);
+	}
 
-		bool Success = false;
-		//If there is an error event, it will be returned in the Pair.Value'
-		//otherwise, the response will be in Pair.Key
-		auto FutureResponse = Async(EAsyncExecution::TaskGraph, [this, WebSocketRequest, &Success, TimeoutMs] {
-			UE_LOG(LogTemp, Log, TEXT("Before WaitForResponseAsync"));
-			TPair<TResponseData, FMgsError> Pair;
-			try
-			{
-				Pair.Key = WaitForResponseAsync<TResponseData>(WebSocketRequest->GetNumberField("id"), TimeoutMs);
-				Success = true;
-			} catch (const FMgsError& e)
-			{
-				Pair.Value = e;
-			}
-			return Pair;
+	/**
+	 * Sends an acked request without blocking the caller. No thread is held while the request is in flight;
+	 * the future is completed on the thread that delivers socket events when the response arrives, or on the game
+	 * thread when the request times out.
+	 */
+	template <typename TRequest, typename TResponseData = typename TWebSocketMessage<TRequest>::FResponse>
+	TFuture<TValueOrError<TResponseData, FMgsError>> SendNonBlocking(const TRequest& RequestData, uint TimeoutMs = 0, const EResendPolicy ResendPolicy = EResendPolicy::Resend, const FRequestCancellationToken& CancellationToken = FRequestCancellationToken(), const FString& ShardKey = FString())
+	{
+		CheckResponseType<TRequest, TResponseData>();
+		uint64 Id = 0;
+		return SendRequest(RequestData, true, TimeoutMs, ResendPolicy, CancellationToken, ShardKey, Id).Next([](const TSharedPtr<FWebSocketResponse>& Ack)
+		{
+			return ToResponse<TResponseData>(Ack);
 		});
+	}
 
-		UE_LOG(LogTemp, Log, TEXT("After Async"));
-
-		UE_LOG(LogTemp, Log, TEXT("Before Response.Wait"));
+	/**
+	 * Continuation flavour of SendNonBlocking. The continuation runs on whichever thread completes the request,
+	 * so hop to the game thread before touching UI.
+	 */
+	template <typename TRequest, typename TResponseData = typename TWebSocketMessage<TRequest>::FResponse>
+	void SendNonBlocking(const TRequest& RequestData, TFunction<void(const TValueOrError<TResponseData, FMgsError>&)> Continuation, uint TimeoutMs = 0, const EResendPolicy ResendPolicy = EResendPolicy::Resend, const FRequestCancellationToken& CancellationToken = FRequestCancellationToken(), const FString& ShardKey = FString())
+	{
+		SendNonBlocking<TRequest, TResponseData>(RequestData, TimeoutMs, ResendPolicy, CancellationToken, ShardKey).Next(MoveTemp(Continuation));
+	}
 
-		FutureResponse.Wait();
-		UE_LOG(LogTemp, Log, TEXT("After Response.Wait"));
+	/**
+	 * Allocation-free flavour of SendNonBlocking: the request resolves straight into Receiver, which the caller owns
+	 * and reuses, instead of into a future. Receiver must outlive the request; a request that fails before it is sent
+	 * completes it before this returns.
+	 */
+	template <typename TRequest, typename TResponseData = typename TWebSocketMessage<TRequest>::FResponse>
+	void SendNonBlocking(const TRequest& RequestData, TWebSocketResponseReceiver<TResponseData>& Receiver, uint TimeoutMs = 0, const EResendPolicy ResendPolicy = EResendPolicy::Resend, const FRequestCancellationToken& CancellationToken = FRequestCancellationToken(), const FString& ShardKey = FString())
+	{
+		CheckResponseType<TRequest, TResponseData>();
+		uint64 Id = 0;
+		SendRequest(RequestData, true, TimeoutMs, ResendPolicy, CancellationToken, ShardKey, Id, &Receiver);
+	}
 
-		if (!Success)
+#if WEBSOCKET_WITH_COROUTINES
+	/**
+	 * co_await form of SendNonBlocking for FWebSocketTask coroutines: suspends without holding a thread and resumes
+	 * on ResumeOn with the response or the error.
+	 */
+	template <typename TRequest, typename TResponseData = typename TWebSocketMessage<TRequest>::FResponse>
+	TWebSocketRequestAwaitable<TResponseData> SendAwaitable(const TRequest& RequestData, const ENamedThreads::Type ResumeOn = ENamedThreads::GameThread, uint TimeoutMs = 0, const EResendPolicy ResendPolicy = EResendPolicy::Resend, const FRequestCancellationToken& CancellationToken = FRequestCancellationToken(), const FString& ShardKey = FString())
+	{
+		// Game thread resumes go through the mailbox with the client's other completions, unless the client is being
+		// destroyed, which fails its requests and would take the mailbox with it
+		return TWebSocketRequestAwaitable<TResponseData>(SendNonBlocking<TRequest, TResponseData>(RequestData, TimeoutMs, ResendPolicy, CancellationToken, ShardKey), [this, Lifetime = Lifetime, ResumeOn](TUniqueFunction<void()>&& Resume)
 		{
-			throw FutureResponse.Get().Value;
-		}
-		return FutureResponse.Get().Key;
-	};
+			if (ResumeOn == ENamedThreads::GameThread)
+			{
+				FRWScopeLock Lock(Lifetime->Lock, SLT_ReadOnly);
+				if (Lifetime->bAlive)
+				{
+					RunOnGameThread(MoveTemp(Resume));
+					return;
+				}
+			}
+			AsyncTask(ResumeOn, MoveTemp(Resume));
+		});
+	}
+#endif
 
 	/**
 	* Delegate called when websocket connection closed wilfully.
@@ -134,106 +419,673 @@ class WEBSOCKETTEST_API FWebSocketClient
 
 	TMulticastDelegate<void(bool)> ConnectionDelegate;
 
+	/**
+	* Delegate called with the old and new state whenever the connection state changes, on the game thread.
+	*/
+	DECLARE_EVENT_TwoParams(FWebSocketClient, FConnectionStateChangedEvent, EConnectionState, EConnectionState);
+	FConnectionStateChangedEvent OnConnectionStateChanged;
+
+	/**
+	* Delegate called with true when queued pushes reach Push_High_Water, and with false once they drain back to
+	* Push_Low_Water. Called on whichever thread crossed the mark.
+	*/
+	DECLARE_EVENT_OneParam(FWebSocketClient, FPushBacklogEvent, bool);
+	FPushBacklogEvent OnPushBacklog;
+
+	/**
+	 * Registers the handler for a pushed event. The data is decoded into T off the game thread (see
+	 * FPushOptions::DecodeThread), so DispatchPushMessages only has to call Handler with the finished message.
+	 */
 	template <typename T>
-	void On(FString EventName, std::function<void(const T)> const Handler)
+	void On(const FName EventName, std::function<void(const T)> const Handler, const FPushOptions& Options = FPushOptions())
 	{
-		TypeRegistry.Add(EventName, [Handler](const TSharedPtr<FJsonObject>& JsonObject)
+		const TSharedRef<FPushHandler> PushHandler = MakeShared<FPushHandler>();
+		checkf(!Options.CoalescingKey || Options.CoalescingKeyType == T::StaticStruct(), TEXT("The coalescing key of %s reads a different type than its handler"), *EventName.ToString());
+		PushHandler->Options = Options;
+		PushHandler->Decode = [Handler, GetKey = Options.CoalescingKey](const FWebSocketResponse& Response, FString& OutKey) -> TUniqueFunction<void()>
 		{
 			T PushedMessage;
-			FJsonObjectConverter::JsonObjectToUStruct(JsonObject->GetObjectField("data").ToSharedRef(), &PushedMessage);
+			Response.DecodeData(PushedMessage);
+			if (GetKey)
+			{
+				OutKey = GetKey(&PushedMessage);
+			}
+			return [Handler, PushedMessage = MoveTemp(PushedMessage)]()
+			{
+				Handler(PushedMessage);
+			};
+		};
 
-			UE_LOG(LogTemp, Log, TEXT("Got pushed message: %s"), *JsonObject->GetStringField("event"));
-			Handler(PushedMessage);
-		});
+		FRWScopeLock Lock(TypeRegistryLock, SLT_Write);
+		TypeRegistry.Add(EventName, PushHandler);
 	}
-	void ProcessPushMessages(uint32 MaxMessages = 30);
 
-	private:
-	TMap<int, TSharedPtr<FJsonObject>> AckMap;
-	TQueue<TSharedPtr<FJsonObject>> PushMessageQueue;
-	TMap<FString, std::function<void(TSharedPtr<FJsonObject>)>> TypeRegistry;
-	int32 Retries = 0;
-	uint64  Counter = 0;
-	bool IsReconnecting = false;
-	bool QuittingFlag = false;
-	std::shared_timed_mutex AckMutex;
-	std::mutex Mutex;
-	std::condition_variable RequestCV, ReconnectingCV, QuittingCV;
+	// Dispatches queued pushes, highest priority first, until Push_Budget_Us is spent; call once per frame
+	void DispatchPushMessages();
 
-	FWebSocketAsyncAwaitResponse AsyncAwaitResponse;
+	FPushDispatchStats GetPushDispatchStats() const;
 
-	void Reconnect();
+	/**
+	 * Queues Callback for the game thread, where the client drains its mailbox once a frame within
+	 * Game_Thread_Budget_Us, rather than posting a task graph task per callback. Callable from any thread; callbacks
+	 * run in the order they were queued.
+	 */
+	void RunOnGameThread(TUniqueFunction<void()> Callback);
+
+	// Sends whatever the outbox holds now rather than waiting for its flush policy
+	void FlushOutbox();
 
-	void ProcessResponse(FString);
+	FWebSocketOutboxStats GetOutboxStats() const;
+
+	/**
+	 * Snapshot of request, latency, push and traffic stats, from any thread. The totals are lock-free reads, cheap
+	 * enough to poll every frame; Fields adds the per message type breakdown and the memory held.
+	 */
+	FWebSocketClientStats GetStats(EWebSocketStatsFields Fields = EWebSocketStatsFields::MessageTypes) const;
 
-	void BindResponseDelegate(const bool);
+	/**
+	 * Memory the client holds: its tables, queues and buffers, retained requests and stats. Pushes waiting to be
+	 * decoded and the receive path's reassembly buffers are left out, since only their own threads may touch them.
+	 */
+	SIZE_T GetAllocatedSize() const;
 
-	TSharedPtr<FJsonObject> ReadAckMap(const int32 Id)
+	private:
+	// Shared with work that may run on another thread after the client is gone; the destructor clears bAlive under
+	// the write lock, so once it has, none of that work is running or will run
+	struct FLifetime
 	{
-		std::shared_lock<std::shared_timed_mutex> Lock(AckMutex);
-		return AckMap[Id];
+		FRWLock Lock;
+		bool bAlive = true;
+	};
+	TSharedRef<FLifetime, ESPMode::ThreadSafe> Lifetime = MakeShared<FLifetime, ESPMode::ThreadSafe>();
+
+	// Wraps Function so it does nothing once the client has begun to be destroyed; Function must not destroy it
+	// itself. For task graph work and token callbacks, which nothing else stops from outliving the client
+	template <typename FunctionType>
+	auto WhileAlive(FunctionType Function) const
+	{
+		return [Lifetime = Lifetime, Function = MoveTemp(Function)]() mutable
+		{
+			FRWScopeLock Lock(Lifetime->Lock, SLT_ReadOnly);
+			if (Lifetime->bAlive)
+			{
+				Function();
+			}
+		};
 	}
 
-	void WriteAckMap(const int32 Id, const TSharedPtr<FJsonObject> JsonObject)
+	TUniquePtr<TPendingRequestTable<TSharedPtr<FWebSocketResponse>>> PendingRequests;
+	TUniquePtr<FDeadlineWheel> Deadlines;
+	struct FPushHandler
 	{
-		std::unique_lock<std::shared_timed_mutex> Lock(AckMutex);
-		AckMap.Add(Id, JsonObject);
+		// Turns a received push into a ready-to-run call of the user's handler, and gives its coalescing key
+		std::function<TUniqueFunction<void()>(const FWebSocketResponse&, FString&)> Decode;
+		FPushOptions Options;
+	};
+
+	// What pushes are coalesced by: their event and, if the handler has one, their coalescing key
+	struct FPushKey
+	{
+		FName Event;
+		FString Key;
+
+		bool operator==(const FPushKey& Other) const
+		{
+			return Event == Other.Event && Key.Equals(Other.Key, ESearchCase::CaseSensitive);
+		}
+
+		friend uint32 GetTypeHash(const FPushKey& PushKey)
+		{
+			return HashCombine(GetTypeHash(PushKey.Event), GetTypeHash(PushKey.Key));
+		}
+	};
+
+	struct FQueuedPush
+	{
+		// The key is filled in once the push is decoded
+		FPushKey Key;
+		TSharedPtr<const FPushHandler> Handler;
+		// Held until the push is decoded
+		TSharedPtr<FWebSocketResponse> Response;
+		TUniqueFunction<void()> Invoke;
+	};
+
+	// Pushes waiting for the decode worker; filled by the receive path and drained by one worker task at a time
+	TQueue<FQueuedPush> DecodeQueue;
+	std::atomic<bool> bDecodeScheduled{false};
+
+	// Decoded pushes; filled by the receive path and the decode worker
+	TUniquePtr<TBoundedMpscQueue<FQueuedPush>> PushMessageQueues[static_cast<int32>(EPushPriority::Num)];
+	// Pushes that overflowed under the Coalesce policy, newest per event and key
+	TMap<FPushKey, FQueuedPush> OverflowPushes;
+	std::mutex OverflowPushesMutex;
+	std::atomic<int32> OverflowPushCount{0};
+	std::atomic<bool> bAbovePushHighWater{false};
+	// Evictions DropOldest tries before dropping the new push, so producers racing for freed cells cannot spin forever
+	static constexpr int32 MaxDropOldestAttempts = 4;
+	// Paused state SetPushBacklog wants the server told of, or INDEX_NONE; the flush tick sends it, so the decode
+	// worker never writes to the sockets
+	std::atomic<int32> PendingFlowControl{INDEX_NONE};
+	// Newest undispatched push per latest-wins event and key; the queue holds one entry per key that stands in for it
+	TMap<FPushKey, TUniqueFunction<void()>> LatestPushes;
+	std::mutex LatestPushesMutex;
+	std::atomic<int32> PushQueueDepth{0};
+	std::atomic<uint64> PushesDispatched{0};
+	std::atomic<uint64> PushesCoalesced{0};
+	std::atomic<uint64> PushesDropped{0};
+	std::atomic<uint64> PushesOverflowed{0};
+	std::atomic<uint64> PushHighWaterCrossings{0};
+	std::atomic<int32> MaxPushQueueDepth{0};
+	// Only written by DispatchPushMessages on the game thread
+	double LastDispatchUs = 0.0;
+	double MaxDispatchUs = 0.0;
+	TMap<FName, TSharedPtr<const FPushHandler>> TypeRegistry;
+	// On may be called from any thread while the receive path checks for handlers
+	FRWLock TypeRegistryLock;
+	std::atomic<uint64> Counter{0};
+	mutable std::mutex SendMutex;
+	TArray<ANSICHAR> SendBuffer;
+
+	// Idempotency key of the request being written, reused like SendBuffer; SendMutex must be held
+	FString IdempotencyKeyBuffer;
+	const FString EmptyIdempotencyKey;
+
+	const FString& MakeIdempotencyKeyLocked(uint64 Id);
+	FDelegateHandle OutboxTickerHandle;
+
+	// One socket of the pool with the state kept per connection
+	struct FPooledConnection
+	{
+		int32 Index = 0;
+		TSharedPtr<IWebSocket> Socket;
+		// Read by SendRequest on any thread to route around sockets that are down
+		std::atomic<bool> bConnected{false};
+		// Acked requests routed here that have not resolved yet
+		std::atomic<int32> InFlight{0};
+		// Fed by heartbeats; resolves the timeout of requests sent here without one
+		FRttEstimator Rtt;
+		/**
+		 * Codec requests are written with. IWebSocket does not report the negotiated subprotocol, so each socket
+		 * starts out in JSON, which every server reads, and switches once its first frame shows the server's choice.
+		 */
+		std::atomic<const IWebSocketCodec*> Codec{&IWebSocketCodec::Json()};
+
+		// Written on the game thread; read by SendRequest on any thread to hold or fail requests while it is down
+		std::atomic<EConnectionState> State{EConnectionState::Disconnected};
+
+		// Reconnect state; only touched on the game thread, where socket events and tickers run
+		FString Endpoint;
+		// When the socket last delivered anything, for half-open detection
+		double LastReceived = 0.0;
+		int32 Retries = 0;
+		int32 ReconnectAttempt = 0;
+		FDelegateHandle ReconnectTickerHandle;
+
+		// Pooled buffer for reassembling fragmented frames; only touched by the receive path
+		TArray<ANSICHAR> ReceiveBuffer;
+
+		// Requests waiting to go out as one batch frame, written with OutboxCodec; guarded by SendMutex
+		TArray<ANSICHAR> Outbox;
+		int32 OutboxCount = 0;
+		const IWebSocketCodec* OutboxCodec = nullptr;
+		// Bumped on every flush so a ByTime timer can tell whether its batch already went out
+		uint64 OutboxGeneration = 0;
+	};
+
+	// Fixed at construction, so any thread may index it
+	TArray<TUniquePtr<FPooledConnection>> Connections;
+
+	// Picks the connection for a request by Pool_Routing, preferring connected ones
+	FPooledConnection& RouteRequest(const FString& ShardKey);
+
+	std::atomic<uint64> RequestsSent{0};
+	std::atomic<uint64> FramesSent{0};
+	std::atomic<uint64> MessagesReceived{0};
+	std::atomic<uint64> FramesReceived{0};
+	std::atomic<uint64> BytesSent{0};
+	std::atomic<uint64> BytesReceived{0};
+	std::atomic<uint64> RequestTimeouts{0};
+	std::atomic<uint64> RequestErrors{0};
+	std::atomic<uint64> RequestsCancelled{0};
+	std::atomic<uint64> ReconnectAttempts{0};
+	std::atomic<uint64> Reconnects{0};
+	FLatencyHistogram RequestLatency;
+
+	struct FMessageTypeStats
+	{
+		FName MsgType;
+		std::atomic<uint64> Requests{0};
+		std::atomic<uint64> Timeouts{0};
+		std::atomic<uint64> Errors{0};
+		std::atomic<uint64> Cancelled{0};
+		FLatencyHistogram Latency;
+	};
+
+	// Indexed by the category each acked request carries in the pending table; entries are never removed
+	TArray<TUniquePtr<FMessageTypeStats>> MessageTypes;
+	TMap<FName, int32> MessageTypeIndices;
+	mutable FRWLock MessageTypesLock;
+
+	// Counts a request of the message type, returning the type's index
+	int32 CountRequest(FName MsgType);
+
+	// Releases the request's in-flight count and records how it resolved
+	void OnRequestReleased(const FPendingRequestRelease& Release, const TSharedPtr<FWebSocketResponse>& Result);
+
+	// A request's callback on its cancellation token, removed as the request resolves
+	struct FCancelRegistration
+	{
+		uint64 Id = 0;
+		FRequestCancellationToken Token;
+		uint64 Handle = 0;
+	};
+
+	// Indexed like the pending table's slots, by id % capacity
+	TArray<FCancelRegistration> CancelRegistrations;
+	std::mutex CancelRegistrationsMutex;
+
+	// Keeps the token's callback for the request until it resolves, or removes it straight away if it already has
+	void TrackCancellation(uint64 Id, const FRequestCancellationToken& Token, uint64 Handle);
+
+	FDelegateHandle DeadlineTickerHandle;
+
+	// An acked request kept until it is answered, so a dropped connection can resend or fail it
+	struct FUnackedRequest
+	{
+		// Serialized request, only kept under the Resend policy
+		TArray<ANSICHAR> Frame;
+		bool bBinary = false;
+		uint32 TimeoutMs = 0;
+		EResendPolicy Policy = EResendPolicy::Resend;
+		// Index of the connection it was sent on, and is resent on
+		int32 Connection = 0;
+	};
+
+	// Keyed by request id, which also gives the original send order
+	TMap<uint64, FUnackedRequest> UnackedRequests;
+	mutable std::mutex UnackedRequestsMutex;
+
+	// Frames of answered requests, kept to retain later requests in without allocating; under UnackedRequestsMutex
+	TArray<TArray<ANSICHAR>> FreeFrames;
+
+	// Frames that grew past this are freed rather than pooled, so one large request does not pin its memory
+	static constexpr int32 MaxPooledFrameBytes = 64 * 1024;
+
+	void RecycleFrameLocked(TArray<ANSICHAR>&& Frame);
+
+	// Responses nobody held on to once their request completed, reused for the next frames received
+	TArray<TSharedPtr<FWebSocketResponse>> FreeResponses;
+	std::mutex FreeResponsesMutex;
+
+	TSharedPtr<FWebSocketResponse> AcquireResponse();
+
+	// Pools the response if this was the last reference to it, e.g. after a receiver decoded it
+	void RecycleResponse(TSharedPtr<FWebSocketResponse>&& Response);
+
+	// Prefix of every idempotency key, unique to this client instance
+	FString ClientKey;
+
+	void RetainUnacked(uint64 Id, const IWebSocketCodec& Codec, const ANSICHAR* Frame, int32 Length, uint32 TimeoutMs, EResendPolicy Policy, int32 Connection);
+
+	// Holds Resend requests and fails FailFast ones when a connection drops
+	void HoldUnacked(int32 Connection);
+
+	// Re-sends the connection's held requests in their original order once it is connected again
+	void ResendUnacked(FPooledConnection& Connection);
+
+	// Fails the retained requests of one connection, or of all of them, once the client stops trying to reconnect
+	void FailUnacked(const FString& Message, int32 Connection = INDEX_NONE);
+
+	void ForgetUnacked(uint64 Id);
+
+	// Endpoints ranked by handshake time; only touched on the game thread
+	TUniquePtr<FEndpointRanking> EndpointRanking;
+	// Set while the first probe of a session without a cached ranking holds up connecting
+	bool bWaitingForProbe = false;
+
+	// Summary of the connection states; only touched on the game thread
+	EConnectionState ConnectionState = EConnectionState::Disconnected;
+	bool QuittingFlag = false;
+
+	// Fills in the subprotocols to offer for the configured codecs, most preferred first
+	void GetOfferedProtocols(TArray<FString>& OutProtocols) const;
+
+	// Creates a socket to the connection's endpoint, binds its events and starts connecting
+	void OpenSocket(FPooledConnection& Connection);
+
+	// Waits out the next backoff delay on the core ticker, or gives up once the retry budget is spent
+	void ScheduleReconnect(FPooledConnection& Connection);
+
+	bool OnReconnectTimer(float DeltaTime, int32 Index);
+
+	// Moves the connection on to the next best endpoint for its next attempt
+	void FailOver(FPooledConnection& Connection);
+
+	// Holds the connection's requests and starts reconnecting after an unclean close or a missed heartbeat
+	void OnConnectionLost(FPooledConnection& Connection);
+
+	FDelegateHandle HeartbeatTickerHandle;
+
+	// Sends each connected socket a heartbeat, dropping the ones that have gone silent
+	bool SendHeartbeats(float DeltaTime);
+
+	void SendHeartbeat(FPooledConnection& Connection);
+
+	// Key the client's reactor tasks are posted with, when Configuration.Reactor is set
+	uint32 ReactorKey = 0;
+	// Only touched on the game thread
+	double NextHeartbeatTime = 0.0;
+
+	// The periodic work the client's own tickers would do, called by the shared reactor
+	void TickOnReactor(float DeltaTime);
+
+	TQueue<TUniqueFunction<void()>, EQueueMode::Mpsc> GameThreadMailbox;
+	std::atomic<int32> GameThreadMailboxDepth{0};
+	std::atomic<uint64> GameThreadCallbacks{0};
+	// Time spent on mailbox callbacks by each frame that ran any
+	FLatencyHistogram GameThreadFrameTime;
+	FDelegateHandle MailboxTickerHandle;
+
+	// Runs the callbacks queued before this frame's drain began, until Game_Thread_Budget_Us is spent
+	bool DrainGameThreadMailbox(float DeltaTime);
+
+	// The connection's next delay, drawn from its configured backoff
+	float NextReconnectDelay(const FPooledConnection& Connection) const;
+
+	// Sets one connection's state and recomputes the client's, which is the most connected state of any connection
+	void SetConnectionState(FPooledConnection& Connection, EConnectionState NewState);
+
+	void ReceiveFragment(FPooledConnection& Connection, const void* Data, SIZE_T Size, SIZE_T BytesRemaining);
+
+	void ProcessResponse(FPooledConnection& Connection, const ANSICHAR* Data, int32 Length);
+
+	// Handles one message, either a whole frame or one element of a batch
+	void ProcessMessage(const IWebSocketCodec& Codec, const ANSICHAR* Data, int32 Length);
+
+	void EnqueuePush(FWebSocketResponse&& Header, const ANSICHAR* Data, int32 Length);
+
+	void DrainDecodeQueue();
+
+	// Queues a decoded push for dispatch, coalescing it if its event is latest-wins
+	void QueueDecodedPush(FQueuedPush&& Push);
+
+	// Applies the overflow policy to a push its queue had no room for; returns whether it was queued after all
+	bool HandlePushOverflow(TBoundedMpscQueue<FQueuedPush>& Queue, FQueuedPush&& Push);
+
+	// Forgets a push that will never be dispatched
+	void DiscardPush(const FQueuedPush& Push);
+
+	void SetPushBacklog(bool bAboveHighWater);
+
+	// Sends the FlowControl request SetPushBacklog left for the send path, if any
+	void SendPendingFlowControl();
+
+	bool DequeuePush(FQueuedPush& OutPush);
+
+	// Whether the codec was offered to the server as a subprotocol
+	bool IsCodecOffered(const IWebSocketCodec& Codec) const;
+
+	// Rejects, at compile time, a response type other than the one the request declares
+	template <typename TRequest, typename TResponseData>
+	static void CheckResponseType()
+	{
+		static_assert(TWebSocketMessage<TRequest>::bDeclared, "Declare the request type with DECLARE_WEBSOCKET_MESSAGE before sending it");
+		static_assert(!TIsSame<typename TWebSocketMessage<TRequest>::FResponse, void>::Value, "The request type declares no response, so there is nothing to wait for; send it with Post");
+		static_assert(TIsSame<typename TWebSocketMessage<TRequest>::FResponse, TResponseData>::Value, "TResponseData is not the response type the request declares");
 	}
 
-	void RemoveFromAckMap(const int32 Id)
+	/**
+	 * Routes the request to a connection and sends it there; a TimeoutMs of 0 is replaced by the adaptive timeout. An
+	 * acked request resolves into Receiver if one is given, and into the returned future otherwise.
+	 */
+	template <typename TRequest>
+	TFuture<TSharedPtr<FWebSocketResponse>> SendRequest(const TRequest& RequestData, const bool AckRequired, uint& TimeoutMs, const EResendPolicy ResendPolicy, const FRequestCancellationToken& CancellationToken, const FString& ShardKey, uint64& OutId, TPendingRequestCompletion<TSharedPtr<FWebSocketResponse>>* Receiver = nullptr)
 	{
-		std::unique_lock<std::shared_timed_mutex> Lock(AckMutex);
-		AckMap.Remove(Id);
+		FPooledConnection& Connection = RouteRequest(ShardKey.IsEmpty() ? TWebSocketMessage<TRequest>::GetName() : ShardKey);
+		return SendRequestOn(Connection, RequestData, AckRequired, TimeoutMs, ResendPolicy, CancellationToken, OutId, Receiver);
 	}
 
-	TSharedPtr<FJsonObject> WaitForAck(const int32 Id, const uint TimeoutMs = 5000, const uint PollIntervalMs = 10)
+	// Serializes and sends the request, registering it as pending first when an ack is required
+	template <typename TRequest>
+	TFuture<TSharedPtr<FWebSocketResponse>> SendRequestOn(FPooledConnection& Connection, const TRequest& RequestData, const bool AckRequired, uint& TimeoutMs, const EResendPolicy ResendPolicy, const FRequestCancellationToken& CancellationToken, uint64& OutId, TPendingRequestCompletion<TSharedPtr<FWebSocketResponse>>* Receiver = nullptr)
 	{
-		uint Elapsed = 0;
-		const auto SleepDuration = PollIntervalMs*1ms;
-		while (true)
+		static_assert(TWebSocketMessage<TRequest>::bDeclared, "Declare the request type with DECLARE_WEBSOCKET_MESSAGE before sending it");
+
+		// Counter is shared by every in-flight SendAsync and every connection, so ids are drawn atomically
+		OutId = Counter.fetch_add(1) + 1;
+
+		if (TimeoutMs == 0)
+		{
+			TimeoutMs = Connection.Rtt.GetTimeoutMs(Configuration.Timeout_Rtt_Multiplier, Configuration.Min_Timeout_Ms, Configuration.Default_Timeout_Ms);
+		}
+		const int32 MessageType = CountRequest(TWebSocketMessage<TRequest>::GetFName());
+
+		// Nothing would ever answer a request on a connection that is closed or has given up
+		const EConnectionState State = Connection.State;
+		if (AckRequired && (State == EConnectionState::Disconnected || State == EConnectionState::GaveUp))
+		{
+			++RequestErrors;
+			UE_LOG(LogTemp, Log, TEXT("Connection %d is down, failing request %llu"), Connection.Index, OutId);
+			return FailRequest(Receiver, OutId, TEXT("Disconnected"));
+		}
+
+		// A request sent while the connection is coming up is held until the resend after connecting gives it a real deadline
+		const bool bRetained = AckRequired && ResendPolicy != EResendPolicy::Drop;
+		const bool bHeld = bRetained && ResendPolicy == EResendPolicy::Resend && IsComingUp(State);
+		const double Deadline = bHeld ? TNumericLimits<double>::Max() : FPlatformTime::Seconds() + TimeoutMs / 1000.0;
+
+		TFuture<TSharedPtr<FWebSocketResponse>> AckFuture;
+		if (AckRequired)
+		{
+			// Counted before the slot is claimed, so the release handler can never take it below zero
+			++Connection.InFlight;
+		}
+		if (AckRequired && !(Receiver != nullptr
+			? PendingRequests->Add(OutId, Deadline, *Receiver, Connection.Index, MessageType)
+			: PendingRequests->Add(OutId, Deadline, AckFuture, Connection.Index, MessageType)))
+		{
+			--Connection.InFlight;
+			++RequestErrors;
+			UE_LOG(LogTemp, Log, TEXT("Too many requests in flight, rejecting request %llu"), OutId);
+			return FailRequest(Receiver, OutId, TEXT("Too many requests in flight"));
+		}
+
+		if (AckRequired)
+		{
+			if (!bHeld)
+			{
+				Deadlines->Schedule(OutId, Deadline);
+			}
+
+			// A token that can never cancel is skipped, saving the callback's allocation
+			if (CancellationToken.IsValid())
+			{
+				const uint64 Id = OutId;
+				const uint64 Handle = CancellationToken.OnCancel(WhileAlive([this, Id]() { CancelRequest(Id); }));
+				if (Handle == 0)
+				{
+					UE_LOG(LogTemp, Log, TEXT("Request %llu cancelled before it was sent"), OutId);
+					CancelRequest(OutId);
+					return AckFuture;
+				}
+				TrackCancellation(Id, CancellationToken, Handle);
+			}
+		}
+
+		{
+			// The send buffer and key are reused across requests; Send copies the buffer into the socket's own queue
+			std::unique_lock<std::mutex> Lock(SendMutex);
+			const FString& IdempotencyKey = bRetained && ResendPolicy == EResendPolicy::Resend
+				? MakeIdempotencyKeyLocked(OutId)
+				: EmptyIdempotencyKey;
+			const IWebSocketCodec& Codec = *Connection.Codec.load(std::memory_order_acquire);
+			++RequestsSent;
+			if (Configuration.Flush_Policy != EOutboxFlushPolicy::Immediate)
+			{
+				TArray<ANSICHAR>& Buffer = OpenOutboxEntryLocked(Connection, Codec);
+				const int32 Start = Buffer.Num();
+				Codec.WriteRequest(OutId, AckRequired, TWebSocketMessage<TRequest>::GetMsgType(), IdempotencyKey, TRequest::StaticStruct(), &RequestData, Buffer);
+				if (bRetained)
+				{
+					RetainUnacked(OutId, Codec, Buffer.GetData() + Start, Buffer.Num() - Start, TimeoutMs, ResendPolicy, Connection.Index);
+				}
+				CloseOutboxEntryLocked(Connection);
+				UE_LOG(LogTemp, Verbose, TEXT("Batched request %llu on connection %d (%d requests, %d bytes)"), OutId, Connection.Index, Connection.OutboxCount, Connection.Outbox.Num());
+			}
+			else
+			{
+				SendBuffer.Reset();
+				Codec.WriteRequest(OutId, AckRequired, TWebSocketMessage<TRequest>::GetMsgType(), IdempotencyKey, TRequest::StaticStruct(), &RequestData, SendBuffer);
+				if (bRetained)
+				{
+					RetainUnacked(OutId, Codec, SendBuffer.GetData(), SendBuffer.Num(), TimeoutMs, ResendPolicy, Connection.Index);
+				}
+
+				UE_LOG(LogTemp, Verbose, TEXT("Sending request %llu on connection %d (%d bytes of %s)"), OutId, Connection.Index, SendBuffer.Num(), Codec.GetName());
+
+				// Before the first connect there is no socket yet; a retained request goes out with the resend
+				if (Connection.Socket.IsValid())
+				{
+					Connection.Socket->Send(SendBuffer.GetData(), SendBuffer.Num(), Codec.IsBinary());
+					++FramesSent;
+					BytesSent += SendBuffer.Num();
+				}
+			}
+		}
+
+		// The connection may have come up or gone down while the request was written, after the resend or failure
+		// that would have covered it, so it gets a real deadline rather than being held forever
+		if (bHeld && !IsComingUp(Connection.State))
 		{
-			const auto Ack = ReadAckMap(Id);
-			if (Ack != nullptr) return Ack;
-			if (Ack == nullptr)
+			const double Due = FPlatformTime::Seconds() + TimeoutMs / 1000.0;
+			if (PendingRequests->SetDeadline(OutId, Due))
 			{
-				Elapsed += PollIntervalMs;
-				if (Elapsed >= TimeoutMs) return nullptr;
-				std::this_thread::sleep_for(SleepDuration);
+				Deadlines->Schedule(OutId, Due);
 			}
 		}
+
+		UE_LOG(LogTemp, Verbose, TEXT("Request sent"));
+		return AckFuture;
 	}
 
-	template <typename TResponseData>
-	TResponseData WaitForResponseAsync(const int32 Id, const uint TimeoutMs = 5000)
-	{
-		UE_LOG(LogTemp, Log, TEXT("Inside WaitForResponseAsync"));
-		TResponseData Data;
+	// Returns the outbox ready for the next request to be appended, opening a batch if needed; SendMutex must be held
+	TArray<ANSICHAR>& OpenOutboxEntryLocked(FPooledConnection& Connection, const IWebSocketCodec& Codec);
+
+	// Counts the request just appended and applies the size and time flush triggers; SendMutex must be held
+	void CloseOutboxEntryLocked(FPooledConnection& Connection);
+
+	void FlushOutboxLocked(FPooledConnection& Connection);
+
+	bool FlushOutboxTick(float DeltaTime);
+
+	// Builds a local "Error" event, used when a request fails before it reaches the server
+	static TSharedPtr<FWebSocketResponse> MakeErrorResponse(const uint64 Id, const FString& Message);
 
-		UE_LOG(LogTemp, Log, TEXT("Waiting for notify"));
+	// An already completed future holding a local "Error" event
+	static TFuture<TSharedPtr<FWebSocketResponse>> MakeErrorFuture(uint64 Id, const FString& Message);
 
-		std::unique_lock<std::mutex> UniqueLock(Mutex);
-		const auto Ack = WaitForAck(Id, TimeoutMs);
-		RemoveFromAckMap(Id);
+	// Completes a request that never got a pending slot with a local "Error" event, in Receiver or a future
+	static TFuture<TSharedPtr<FWebSocketResponse>> FailRequest(TPendingRequestCompletion<TSharedPtr<FWebSocketResponse>>* Receiver, uint64 Id, const FString& Message);
+
+	// Whether the connection is on its way to being connected, the states a Resend request is held in
+	static bool IsComingUp(EConnectionState State);
+
+	// Expires the pending requests whose deadlines came due on the wheel, so non-blocking requests time out without a waiting thread
+	bool ExpireTimedOutRequests(float DeltaTime);
+
+	// Frees the request's pending slot, completing it with a "Cancelled" error
+	void CancelRequest(uint64 Id);
+
+	TSharedPtr<FWebSocketResponse> WaitForAck(const uint64 Id, const TFuture<TSharedPtr<FWebSocketResponse>>& Future, const uint TimeoutMs)
+	{
+		// If the request is no longer pending after the timeout a response is being delivered right now, so take it
+		if (!Future.WaitFor(FTimespan::FromMilliseconds(TimeoutMs)))
+		{
+			PendingRequests->Expire(Id);
+			ForgetUnacked(Id);
+		}
+		Future.Wait();
+		return Future.Get();
+	}
+
+	/**
+	 * Decodes the response to a request into OutData, or the reason it failed into OutError. A null Ack is a timeout.
+	 * Both are decoded in place, so reused ones keep the capacity of their strings and arrays.
+	 */
+	template <typename TResponseData>
+	static bool DecodeResponse(const TSharedPtr<FWebSocketResponse>& Ack, TResponseData& OutData, FMgsError& OutError)
+	{
 		if (Ack == nullptr)
 		{
-			UE_LOG(LogTemp, Log, TEXT("Request timeout"));
-			FMgsError Error;
-			Error.Message = "Timeout";
-			throw Error;
+			OutError.Message = TEXT("Timeout");
+			return false;
 		}
-		UE_LOG(LogTemp, Log, TEXT("Got Ack"));
+		UE_LOG(LogTemp, Verbose, TEXT("Got Event: %s"), *Ack->Event);
 
-		const auto NestedJsonData = Ack->GetObjectField("data");
-		UE_LOG(LogTemp, Log, TEXT("Got Event: %s"), *Ack->GetStringField("event"));
-		if (Ack->GetStringField("event").Compare("Error") == 0)
+		// Only now is the data decoded, straight into the type the caller asked for
+		if (Ack->IsError())
 		{
-			FMgsError Error;
-			FJsonObjectConverter::JsonObjectToUStruct(NestedJsonData.ToSharedRef(), &Error);
+			if (!Ack->DecodeData(OutError))
+			{
+				OutError.Message = TEXT("Decode");
+			}
 			UE_LOG(LogTemp, Log, TEXT("Got mgs error response"));
-			throw Error;
+			return false;
 		}
-		FJsonObjectConverter::JsonObjectToUStruct(NestedJsonData.ToSharedRef(), &Data);
-		UE_LOG(LogTemp, Log, TEXT("Got response"));
-		return Data;
+		if (!Ack->DecodeData(OutData))
+		{
+			UE_LOG(LogTemp, Log, TEXT("Couldn't decode the response to request %llu"), Ack->Id);
+			OutError.Message = TEXT("Decode");
+			return false;
+		}
+		UE_LOG(LogTemp, Verbose, TEXT("Got response"));
+		return true;
+	}
+
+	template <typename TResponseData>
+	static TValueOrError<TResponseData, FMgsError> ToResponse(const TSharedPtr<FWebSocketResponse>& Ack)
+	{
+		TResponseData Data;
+		FMgsError Error;
+		if (!DecodeResponse(Ack, Data, Error))
+		{
+			return MakeError(MoveTemp(Error));
+		}
+		return MakeValue(MoveTemp(Data));
+	}
+
+	template <typename TResponseData>
+	friend class TWebSocketResponseReceiver;
+};
+
+/**
+ * Takes the responses to requests sent with the allocation-free SendNonBlocking, one request at a time. Each response
+ * is decoded into Data, or its error into Error, in place, so their strings and arrays keep their capacity from one
+ * request to the next; fields a response leaves out keep their previous values. OnResponse runs on the thread that completes the request, as a continuation would, and may
+ * send the receiver's next request.
+ */
+template <typename TResponseData>
+class TWebSocketResponseReceiver : public TPendingRequestCompletion<TSharedPtr<FWebSocketResponse>>
+{
+	public:
+	TResponseData Data;
+	FMgsError Error;
+
+	// Whether the last request was answered with Data rather than failing with Error
+	bool HasValue() const
+	{
+		return bHasValue;
+	}
+
+	protected:
+	virtual void OnResponse() = 0;
+
+	private:
+	bool bHasValue = false;
+
+	virtual void Complete(const TSharedPtr<FWebSocketResponse>& Ack) override final
+	{
+		bHasValue = FWebSocketClient::DecodeResponse(Ack, Data, Error);
+		OnResponse();
 	}
 };
\ No newline at end of file
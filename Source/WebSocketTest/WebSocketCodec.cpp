@@ -0,0 +1,364 @@
+#include "WebSocketCodec.h"
+#include "JsonStreamReader.h"
+#include "JsonStreamWriter.h"
+#include "MsgPackStream.h"
+#include "WebSocketResponse.h"
+
+namespace
+{
+	class FJsonWebSocketCodec final : public IWebSocketCodec
+	{
+		public:
+		virtual const TCHAR* GetName() const override
+		{
+			return TEXT("json");
+		}
+
+		virtual bool IsBinary() const override
+		{
+			return false;
+		}
+
+		virtual void WriteRequest(const uint64 Id, const bool AckRequired, const FWebSocketMsgType& MsgType, const FString& IdempotencyKey, const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			FJsonStreamWriter Writer(OutBuffer);
+			Writer.BeginObject();
+			Writer.WriteKey("id");
+			Writer.WriteUInt(Id);
+			Writer.WriteKey("ack");
+			Writer.WriteInt(AckRequired ? 1 : 0);
+			Writer.WriteKey("msgType");
+			Writer.WriteRawValue(MsgType.JsonString, MsgType.JsonStringLength);
+			if (!IdempotencyKey.IsEmpty())
+			{
+				Writer.WriteKey("key");
+				Writer.WriteString(IdempotencyKey);
+			}
+			Writer.WriteKey("data");
+			Writer.WriteStruct(Struct, Data);
+			Writer.EndObject();
+		}
+
+		virtual void WriteData(const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			FJsonStreamWriter Writer(OutBuffer);
+			Writer.WriteStruct(Struct, Data);
+		}
+
+		virtual void BeginBatch(TArray<ANSICHAR>& OutBuffer) const override
+		{
+			OutBuffer.Add('[');
+		}
+
+		virtual void WriteBatchSeparator(TArray<ANSICHAR>& OutBuffer) const override
+		{
+			OutBuffer.Add(',');
+		}
+
+		virtual void EndBatch(int32, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			OutBuffer.Add(']');
+		}
+
+		virtual bool SplitBatch(const ANSICHAR* Begin, const int32 Length, TFunctionRef<void(const ANSICHAR*, int32)> Visit) const override
+		{
+			TJsonStreamReader<ANSICHAR> Reader(Begin, Begin + Length);
+			if (Reader.Peek() != '[') return false;
+			const bool bRead = Reader.ForEachElement([&Reader, &Visit]()
+			{
+				Reader.Peek();
+				const ANSICHAR* ElementBegin = Reader.GetCursor();
+				if (!Reader.SkipValue()) return false;
+				Visit(ElementBegin, static_cast<int32>(Reader.GetCursor() - ElementBegin));
+				return true;
+			});
+			if (!bRead)
+			{
+				UE_LOG(LogTemp, Log, TEXT("Couldn't split batched frame"));
+			}
+			return true;
+		}
+
+		virtual bool ScanResponse(const ANSICHAR* Begin, const int32 Length, FWebSocketResponse& OutResponse) const override
+		{
+			TJsonStreamReader<ANSICHAR> Reader(Begin, Begin + Length);
+			return Reader.ForEachMember([&OutResponse, &Reader, Begin](const ANSICHAR* KeyBegin, const ANSICHAR* KeyEnd, bool)
+			{
+				using JsonStreamReader_Private::KeyEquals;
+				if (KeyEquals(KeyBegin, KeyEnd, "id"))
+				{
+					return Reader.ReadUInt64(OutResponse.Id);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "event"))
+				{
+					return Reader.ReadString(OutResponse.Event);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "data"))
+				{
+					Reader.Peek();
+					OutResponse.DataStart = static_cast<int32>(Reader.GetCursor() - Begin);
+					if (!Reader.SkipValue()) return false;
+					OutResponse.DataLength = static_cast<int32>(Reader.GetCursor() - Begin) - OutResponse.DataStart;
+					return true;
+				}
+				return Reader.SkipValue();
+			});
+		}
+
+		virtual bool DecodeData(const ANSICHAR* Begin, const int32 Length, const UScriptStruct* Struct, void* Data) const override
+		{
+			TJsonStreamReader<ANSICHAR> Reader(Begin, Begin + Length);
+			return Reader.ReadStruct(Struct, Data);
+		}
+
+		virtual bool ScanRequest(const ANSICHAR* Begin, const int32 Length, FWebSocketRequestHeader& OutRequest) const override
+		{
+			TJsonStreamReader<ANSICHAR> Reader(Begin, Begin + Length);
+			return Reader.ForEachMember([&OutRequest, &Reader, Begin](const ANSICHAR* KeyBegin, const ANSICHAR* KeyEnd, bool)
+			{
+				using JsonStreamReader_Private::KeyEquals;
+				if (KeyEquals(KeyBegin, KeyEnd, "id"))
+				{
+					return Reader.ReadUInt64(OutRequest.Id);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "ack"))
+				{
+					uint64 Ack = 0;
+					const bool bRead = Reader.ReadUInt64(Ack);
+					OutRequest.bAck = Ack != 0;
+					return bRead;
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "msgType"))
+				{
+					return Reader.ReadString(OutRequest.MsgType);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "key"))
+				{
+					return Reader.ReadString(OutRequest.IdempotencyKey);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "data"))
+				{
+					Reader.Peek();
+					OutRequest.DataStart = static_cast<int32>(Reader.GetCursor() - Begin);
+					if (!Reader.SkipValue()) return false;
+					OutRequest.DataLength = static_cast<int32>(Reader.GetCursor() - Begin) - OutRequest.DataStart;
+					return true;
+				}
+				return Reader.SkipValue();
+			});
+		}
+
+		virtual void WriteResponse(const uint64 Id, const FString& Event, const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			FJsonStreamWriter Writer(OutBuffer);
+			Writer.BeginObject();
+			Writer.WriteKey("id");
+			Writer.WriteUInt(Id);
+			Writer.WriteKey("event");
+			Writer.WriteString(Event);
+			if (Struct != nullptr)
+			{
+				Writer.WriteKey("data");
+				Writer.WriteStruct(Struct, Data);
+			}
+			Writer.EndObject();
+		}
+	};
+
+	class FMsgPackWebSocketCodec final : public IWebSocketCodec
+	{
+		public:
+		virtual const TCHAR* GetName() const override
+		{
+			return TEXT("msgpack");
+		}
+
+		virtual bool IsBinary() const override
+		{
+			return true;
+		}
+
+		virtual void WriteRequest(const uint64 Id, const bool AckRequired, const FWebSocketMsgType& MsgType, const FString& IdempotencyKey, const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			FMsgPackWriter Writer(OutBuffer);
+			Writer.WriteMapHeader(IdempotencyKey.IsEmpty() ? 4 : 5);
+			Writer.WriteString("id", 2);
+			Writer.WriteUInt(Id);
+			Writer.WriteString("ack", 3);
+			Writer.WriteInt(AckRequired ? 1 : 0);
+			Writer.WriteString("msgType", 7);
+			Writer.WriteString(MsgType.Utf8, MsgType.Utf8Length);
+			if (!IdempotencyKey.IsEmpty())
+			{
+				Writer.WriteString("key", 3);
+				Writer.WriteString(IdempotencyKey);
+			}
+			Writer.WriteString("data", 4);
+			Writer.WriteStruct(Struct, Data);
+		}
+
+		virtual void WriteData(const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			FMsgPackWriter Writer(OutBuffer);
+			Writer.WriteStruct(Struct, Data);
+		}
+
+		virtual void BeginBatch(TArray<ANSICHAR>& OutBuffer) const override
+		{
+			// The count is not known yet, so room is left for the widest array header and patched in EndBatch
+			OutBuffer.Add(static_cast<ANSICHAR>(0xdd));
+			OutBuffer.AddZeroed(4);
+		}
+
+		virtual void WriteBatchSeparator(TArray<ANSICHAR>&) const override
+		{
+		}
+
+		virtual void EndBatch(const int32 Count, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			for (int32 Index = 0; Index < 4; ++Index)
+			{
+				OutBuffer[1 + Index] = static_cast<ANSICHAR>(static_cast<uint32>(Count) >> (24 - Index * 8));
+			}
+		}
+
+		virtual bool SplitBatch(const ANSICHAR* Begin, const int32 Length, TFunctionRef<void(const ANSICHAR*, int32)> Visit) const override
+		{
+			FMsgPackReader Reader(Begin, Begin + Length);
+			if (!Reader.IsArray()) return false;
+			const bool bRead = Reader.ForEachElement([&Reader, &Visit]()
+			{
+				const ANSICHAR* ElementBegin = Reader.GetCursor();
+				if (!Reader.SkipValue()) return false;
+				Visit(ElementBegin, static_cast<int32>(Reader.GetCursor() - ElementBegin));
+				return true;
+			});
+			if (!bRead)
+			{
+				UE_LOG(LogTemp, Log, TEXT("Couldn't split batched frame"));
+			}
+			return true;
+		}
+
+		virtual bool ScanResponse(const ANSICHAR* Begin, const int32 Length, FWebSocketResponse& OutResponse) const override
+		{
+			FMsgPackReader Reader(Begin, Begin + Length);
+			return Reader.ForEachMember([&OutResponse, &Reader, Begin](const ANSICHAR* KeyBegin, const ANSICHAR* KeyEnd)
+			{
+				using JsonStreamReader_Private::KeyEquals;
+				if (KeyEquals(KeyBegin, KeyEnd, "id"))
+				{
+					return Reader.ReadUInt64(OutResponse.Id);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "event"))
+				{
+					return Reader.ReadString(OutResponse.Event);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "data"))
+				{
+					OutResponse.DataStart = static_cast<int32>(Reader.GetCursor() - Begin);
+					if (!Reader.SkipValue()) return false;
+					OutResponse.DataLength = static_cast<int32>(Reader.GetCursor() - Begin) - OutResponse.DataStart;
+					return true;
+				}
+				return Reader.SkipValue();
+			});
+		}
+
+		virtual bool DecodeData(const ANSICHAR* Begin, const int32 Length, const UScriptStruct* Struct, void* Data) const override
+		{
+			FMsgPackReader Reader(Begin, Begin + Length);
+			return Reader.ReadStruct(Struct, Data);
+		}
+
+		virtual bool ScanRequest(const ANSICHAR* Begin, const int32 Length, FWebSocketRequestHeader& OutRequest) const override
+		{
+			FMsgPackReader Reader(Begin, Begin + Length);
+			return Reader.ForEachMember([&OutRequest, &Reader, Begin](const ANSICHAR* KeyBegin, const ANSICHAR* KeyEnd)
+			{
+				using JsonStreamReader_Private::KeyEquals;
+				if (KeyEquals(KeyBegin, KeyEnd, "id"))
+				{
+					return Reader.ReadUInt64(OutRequest.Id);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "ack"))
+				{
+					uint64 Ack = 0;
+					const bool bRead = Reader.ReadUInt64(Ack);
+					OutRequest.bAck = Ack != 0;
+					return bRead;
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "msgType"))
+				{
+					return Reader.ReadString(OutRequest.MsgType);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "key"))
+				{
+					return Reader.ReadString(OutRequest.IdempotencyKey);
+				}
+				if (KeyEquals(KeyBegin, KeyEnd, "data"))
+				{
+					OutRequest.DataStart = static_cast<int32>(Reader.GetCursor() - Begin);
+					if (!Reader.SkipValue()) return false;
+					OutRequest.DataLength = static_cast<int32>(Reader.GetCursor() - Begin) - OutRequest.DataStart;
+					return true;
+				}
+				return Reader.SkipValue();
+			});
+		}
+
+		virtual void WriteResponse(const uint64 Id, const FString& Event, const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const override
+		{
+			FMsgPackWriter Writer(OutBuffer);
+			Writer.WriteMapHeader(Struct != nullptr ? 3 : 2);
+			Writer.WriteString("id", 2);
+			Writer.WriteUInt(Id);
+			Writer.WriteString("event", 5);
+			Writer.WriteString(Event);
+			if (Struct != nullptr)
+			{
+				Writer.WriteString("data", 4);
+				Writer.WriteStruct(Struct, Data);
+			}
+		}
+	};
+}
+
+const IWebSocketCodec& IWebSocketCodec::Json()
+{
+	static const FJsonWebSocketCodec Codec;
+	return Codec;
+}
+
+const IWebSocketCodec& IWebSocketCodec::MsgPack()
+{
+	static const FMsgPackWebSocketCodec Codec;
+	return Codec;
+}
+
+const IWebSocketCodec* IWebSocketCodec::FindByName(const FString& Name)
+{
+	for (const IWebSocketCodec* Codec : {&Json(), &MsgPack()})
+	{
+		if (Name.Equals(Codec->GetName(), ESearchCase::IgnoreCase))
+		{
+			return Codec;
+		}
+	}
+	return nullptr;
+}
+
+const IWebSocketCodec& IWebSocketCodec::Detect(const ANSICHAR* Data, int32 Length)
+{
+	SkipByteOrderMark(Data, Length);
+	return Length > 0 && static_cast<uint8>(Data[0]) >= 0x80 ? MsgPack() : Json();
+}
+
+void IWebSocketCodec::SkipByteOrderMark(const ANSICHAR*& Data, int32& Length)
+{
+	if (Length >= 3 && static_cast<uint8>(Data[0]) == 0xef && static_cast<uint8>(Data[1]) == 0xbb && static_cast<uint8>(Data[2]) == 0xbf)
+	{
+		Data += 3;
+		Length -= 3;
+	}
+}
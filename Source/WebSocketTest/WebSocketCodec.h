@@ -0,0 +1,98 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FWebSocketResponse;
+
+/**
+ * A message type name fixed at compile time, with its wire encodings worked out up front so writing a request
+ * never converts or escapes it. Declared for each message type by DECLARE_WEBSOCKET_MESSAGE.
+ */
+struct FWebSocketMsgType
+{
+	const TCHAR* Name;
+	// The name as UTF-8, and the same again quoted as a JSON string
+	const ANSICHAR* Utf8;
+	int32 Utf8Length;
+	const ANSICHAR* JsonString;
+	int32 JsonStringLength;
+};
+
+// The envelope of a request as the server reads it; like FWebSocketResponse, data is left in the frame
+struct FWebSocketRequestHeader
+{
+	uint64 Id = 0;
+	bool bAck = false;
+	FString MsgType;
+	FString IdempotencyKey;
+
+	// Span of the data value within the frame, or INDEX_NONE if the request has no data
+	int32 DataStart = INDEX_NONE;
+	int32 DataLength = 0;
+};
+
+/**
+ * Wire format for request envelopes and response frames. The client offers each configured codec to the server
+ * as an "mgs.<name>" WebSocket subprotocol; both codecs carry the same envelope (id, ack, msgType, key, data out;
+ * id, event, data back) and the same struct field names, so handlers never see which one was used.
+ */
+class WEBSOCKETTEST_API IWebSocketCodec
+{
+	public:
+	virtual ~IWebSocketCodec() = default;
+
+	virtual const TCHAR* GetName() const = 0;
+
+	// Whether frames go out as binary or text WebSocket messages
+	virtual bool IsBinary() const = 0;
+
+	// IdempotencyKey is left out of the envelope when empty
+	virtual void WriteRequest(uint64 Id, bool AckRequired, const FWebSocketMsgType& MsgType, const FString& IdempotencyKey, const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const = 0;
+
+	// Writes a bare struct as a data value, e.g. for responses built locally
+	virtual void WriteData(const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const = 0;
+
+	/**
+	 * Batches are arrays of request envelopes sent as one frame. BeginBatch opens one at the start of an empty
+	 * buffer, WriteBatchSeparator goes before every request after the first, and EndBatch closes the batch once
+	 * Count requests have been written.
+	 */
+	virtual void BeginBatch(TArray<ANSICHAR>& OutBuffer) const = 0;
+	virtual void WriteBatchSeparator(TArray<ANSICHAR>& OutBuffer) const = 0;
+	virtual void EndBatch(int32 Count, TArray<ANSICHAR>& OutBuffer) const = 0;
+
+	// If the frame is a batch, visits the span of each message in it and returns true
+	virtual bool SplitBatch(const ANSICHAR* Begin, int32 Length, TFunctionRef<void(const ANSICHAR*, int32)> Visit) const = 0;
+
+	// Parses the envelope of a frame in place, recording where its data sits without decoding it
+	virtual bool ScanResponse(const ANSICHAR* Begin, int32 Length, FWebSocketResponse& OutResponse) const = 0;
+
+	virtual bool DecodeData(const ANSICHAR* Begin, int32 Length, const UScriptStruct* Struct, void* Data) const = 0;
+
+	/**
+	 * The server's side of the envelope, for the stand-in server and the codec tests: ScanRequest reads what
+	 * WriteRequest wrote, and WriteResponse writes what ScanResponse reads. A response with Id 0 is a push; Struct
+	 * may be null for one without data.
+	 */
+	virtual bool ScanRequest(const ANSICHAR* Begin, int32 Length, FWebSocketRequestHeader& OutRequest) const = 0;
+	virtual void WriteResponse(uint64 Id, const FString& Event, const UScriptStruct* Struct, const void* Data, TArray<ANSICHAR>& OutBuffer) const = 0;
+
+	FString GetSubprotocol() const
+	{
+		return FString(TEXT("mgs.")) + GetName();
+	}
+
+	static const IWebSocketCodec& Json();
+	static const IWebSocketCodec& MsgPack();
+
+	static const IWebSocketCodec* FindByName(const FString& Name);
+
+	/**
+	 * Picks the codec a frame was written with from its first byte: a JSON envelope opens with '{' (or
+	 * whitespace, or a UTF-8 byte order mark), while a MessagePack map header is always 0x80 or above.
+	 */
+	static const IWebSocketCodec& Detect(const ANSICHAR* Data, int32 Length);
+
+	// Steps over a UTF-8 byte order mark at the start of a text frame, which the JSON reader does not expect
+	static void SkipByteOrderMark(const ANSICHAR*& Data, int32& Length);
+};
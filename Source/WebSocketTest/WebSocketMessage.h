@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WebSocketCodec.h"
+
+/**
+ * Compile-time description of a message type: its msgType on the wire, the response the server answers it with
+ * and whether it is acked. Specialized through DECLARE_WEBSOCKET_MESSAGE, next to the USTRUCT it describes; a type
+ * without a declaration cannot be sent.
+ */
+template <typename T>
+struct TWebSocketMessage
+{
+	static constexpr bool bDeclared = false;
+};
+
+namespace WebSocketMessage
+{
+	// Names go on the wire unescaped, so they are limited to printable ASCII other than quotes and backslashes
+	constexpr bool IsValidMsgType(const char* Name)
+	{
+		if (*Name == '\0') return false;
+		for (; *Name != '\0'; ++Name)
+		{
+			if (*Name < 0x20 || *Name > 0x7e || *Name == '"' || *Name == '\\') return false;
+		}
+		return true;
+	}
+}
+
+// Messages the server sends unasked, e.g. errors, declare only a name
+#define DECLARE_WEBSOCKET_EVENT(Type, MsgTypeName) \
+	DECLARE_WEBSOCKET_MESSAGE(Type, MsgTypeName, void, false)
+
+/**
+ * Declares Type as message MsgTypeName, answered with ResponseType (void if never answered) when bAckRequired.
+ * Must be used at global scope, after the USTRUCT.
+ */
+#define DECLARE_WEBSOCKET_MESSAGE(Type, MsgTypeName, ResponseType, bAckRequired) \
+	template <> \
+	struct TWebSocketMessage<Type> \
+	{ \
+		static_assert(WebSocketMessage::IsValidMsgType(MsgTypeName), "msgType of " #Type " must be printable ASCII without quotes or backslashes"); \
+		static constexpr bool bDeclared = true; \
+		static constexpr bool bAck = bAckRequired; \
+		using FResponse = ResponseType; \
+		static const FWebSocketMsgType& GetMsgType() \
+		{ \
+			static const FWebSocketMsgType MsgType{TEXT(MsgTypeName), MsgTypeName, sizeof(MsgTypeName) - 1, "\"" MsgTypeName "\"", sizeof(MsgTypeName) + 1}; \
+			return MsgType; \
+		} \
+		/* One string and one name per type, for routing and stats keyed by name */ \
+		static const FString& GetName() \
+		{ \
+			static const FString Name(TEXT(MsgTypeName)); \
+			return Name; \
+		} \
+		static FName GetFName() \
+		{ \
+			static const FName Name(TEXT(MsgTypeName)); \
+			return Name; \
+		} \
+	};
@@ -0,0 +1,182 @@
+#include "WebSocketReactor.h"
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+
+class FWebSocketReactor::FWorker : public FRunnable
+{
+	public:
+	explicit FWorker(const int32 Index)
+	{
+		WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+		Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("WebSocketReactor%d"), Index));
+	}
+
+	virtual ~FWorker() override
+	{
+		bStopping = true;
+		WakeEvent->Trigger();
+		Thread->WaitForCompletion();
+		delete Thread;
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	}
+
+	void Post(const uint32 Key, const double Due, TUniqueFunction<void()> Function)
+	{
+		Incoming.Enqueue({Key, Due, MoveTemp(Function)});
+		WakeEvent->Trigger();
+	}
+
+	// Drops the client's delayed tasks once everything it posted before has run, and waits for that
+	void RemoveClient(const uint32 Key)
+	{
+		FEvent* Done = FPlatformProcess::GetSynchEventFromPool();
+		Post(Key, 0.0, [this, Key, Done]()
+		{
+			Timers.RemoveAll([Key](const FTask& Task) { return Task.Key == Key; });
+			Timers.Heapify(FTaskDueFirst());
+			Done->Trigger();
+		});
+		Done->Wait();
+		FPlatformProcess::ReturnSynchEventToPool(Done);
+	}
+
+	virtual uint32 Run() override
+	{
+		while (!bStopping)
+		{
+			// Posted tasks run in order; delayed ones wait on the heap
+			FTask Task;
+			while (Incoming.Dequeue(Task))
+			{
+				if (Task.Due <= 0.0)
+				{
+					Task.Function();
+				}
+				else
+				{
+					Timers.HeapPush(MoveTemp(Task), FTaskDueFirst());
+				}
+			}
+
+			const double Now = FPlatformTime::Seconds();
+			while (Timers.Num() > 0 && Timers.HeapTop().Due <= Now)
+			{
+				Timers.HeapPop(Task, FTaskDueFirst(), false);
+				Task.Function();
+			}
+
+			const uint32 WaitMs = Timers.Num() > 0
+				? static_cast<uint32>(FMath::Max(FMath::CeilToDouble((Timers.HeapTop().Due - FPlatformTime::Seconds()) * 1000.0), 0.0))
+				: MAX_uint32;
+			if (WaitMs > 0)
+			{
+				WakeEvent->Wait(WaitMs);
+			}
+		}
+		return 0;
+	}
+
+	private:
+	struct FTask
+	{
+		uint32 Key = 0;
+		// Seconds on the platform clock; 0 runs as soon as it is dequeued
+		double Due = 0.0;
+		TUniqueFunction<void()> Function;
+	};
+
+	struct FTaskDueFirst
+	{
+		bool operator()(const FTask& A, const FTask& B) const
+		{
+			return A.Due < B.Due;
+		}
+	};
+
+	TQueue<FTask, EQueueMode::Mpsc> Incoming;
+	// Delayed tasks, soonest first; only touched by the worker thread
+	TArray<FTask> Timers;
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopping{false};
+};
+
+FWebSocketReactor::FWebSocketReactor(const int32 NumThreads)
+{
+	for (int32 Index = 0; Index < FMath::Max(NumThreads, 1); ++Index)
+	{
+		Workers.Add(MakeUnique<FWorker>(Index));
+	}
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FWebSocketReactor::Tick));
+}
+
+FWebSocketReactor::~FWebSocketReactor()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	Workers.Empty();
+}
+
+int32 FWebSocketReactor::GetNumClients() const
+{
+	FScopeLock Lock(&ClientsLock);
+	return Clients.Num();
+}
+
+uint32 FWebSocketReactor::AddClient(TFunction<void(float)> Tick)
+{
+	const TSharedPtr<FClient> Client = MakeShared<FClient>();
+	Client->Tick = MoveTemp(Tick);
+
+	FScopeLock Lock(&ClientsLock);
+	Client->Key = NextKey++;
+	Clients.Add(Client);
+	return Client->Key;
+}
+
+void FWebSocketReactor::RemoveClient(const uint32 Key)
+{
+	{
+		FScopeLock Lock(&ClientsLock);
+		const int32 Index = Clients.IndexOfByPredicate([Key](const TSharedPtr<FClient>& Client) { return Client->Key == Key; });
+		if (Index != INDEX_NONE)
+		{
+			Clients[Index]->bRemoved = true;
+			Clients.RemoveAtSwap(Index);
+		}
+	}
+	GetWorker(Key).RemoveClient(Key);
+}
+
+void FWebSocketReactor::Post(const uint32 Key, TUniqueFunction<void()> Task)
+{
+	GetWorker(Key).Post(Key, 0.0, MoveTemp(Task));
+}
+
+void FWebSocketReactor::PostAfter(const uint32 Key, const double DelaySeconds, TUniqueFunction<void()> Task)
+{
+	// A due time of 0 means no delay to the worker, so the smallest real one is nudged past it
+	GetWorker(Key).Post(Key, FMath::Max(FPlatformTime::Seconds() + DelaySeconds, DBL_MIN), MoveTemp(Task));
+}
+
+bool FWebSocketReactor::Tick(float DeltaTime)
+{
+	// Ticked from a copy, since a client's tick may add or remove clients
+	{
+		FScopeLock Lock(&ClientsLock);
+		TickingClients = Clients;
+	}
+	for (const TSharedPtr<FClient>& Client : TickingClients)
+	{
+		if (!Client->bRemoved)
+		{
+			Client->Tick(DeltaTime);
+		}
+	}
+	TickingClients.Reset();
+	return true;
+}
+
+FWebSocketReactor::FWorker& FWebSocketReactor::GetWorker(const uint32 Key) const
+{
+	return *Workers[static_cast<int32>(Key % static_cast<uint32>(Workers.Num()))];
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+
+/**
+ * Shared driver for many FWebSocketClient instances, so CPU and thread use stay flat as clients are added. Hand the
+ * same reactor to every client through FWebSocketConfiguration::Reactor.
+ *
+ * One core ticker calls every client's periodic work (request deadlines, outbox flushes, heartbeats) instead of each
+ * client registering its own. Background work, push decoding and timed outbox flushes, runs on a fixed set of
+ * reactor threads rather than as task graph work per client. Each client's tasks always go to the same thread,
+ * through a lock-free queue, so they run in the order they were posted.
+ *
+ * Socket I/O needs no help: the WebSockets module already services every socket from one thread.
+ */
+class WEBSOCKETTEST_API FWebSocketReactor
+{
+	public:
+	explicit FWebSocketReactor(int32 NumThreads = 1);
+
+	~FWebSocketReactor();
+
+	int32 GetNumThreads() const
+	{
+		return Workers.Num();
+	}
+
+	int32 GetNumClients() const;
+
+	/**
+	 * Calls Tick on the game thread every core tick until the client is removed. Returns the key to post the
+	 * client's tasks with.
+	 */
+	uint32 AddClient(TFunction<void(float)> Tick);
+
+	/**
+	 * Stops ticking the client and drops its delayed tasks, waiting until none of its tasks is running. Call it
+	 * before tearing the client down, and never from a reactor thread.
+	 */
+	void RemoveClient(uint32 Key);
+
+	// Runs Task on the client's reactor thread; safe from any thread
+	void Post(uint32 Key, TUniqueFunction<void()> Task);
+
+	// Runs Task on the client's reactor thread once DelaySeconds have passed, to the millisecond
+	void PostAfter(uint32 Key, double DelaySeconds, TUniqueFunction<void()> Task);
+
+	private:
+	class FWorker;
+
+	struct FClient
+	{
+		uint32 Key = 0;
+		TFunction<void(float)> Tick;
+		// Set on removal, in case a client is removed by another one's tick
+		bool bRemoved = false;
+	};
+
+	TArray<TUniquePtr<FWorker>> Workers;
+	FDelegateHandle TickerHandle;
+
+	mutable FCriticalSection ClientsLock;
+	TArray<TSharedPtr<FClient>> Clients;
+	uint32 NextKey = 0;
+
+	// Only touched by Tick, on the game thread
+	TArray<TSharedPtr<FClient>> TickingClients;
+
+	bool Tick(float DeltaTime);
+
+	FWorker& GetWorker(uint32 Key) const;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WebSocketCodec.h"
+
+/**
+ * A received frame with only its envelope parsed. Scan pulls out id and event and records where data sits in
+ * the frame; data is left as undecoded wire bytes until a waiter or push handler decodes it into its own USTRUCT, so
+ * frames nobody wants cost a header scan rather than a full DOM parse.
+ */
+struct FWebSocketResponse
+{
+	uint64 Id = 0;
+
+	FString Event;
+
+	// The whole frame as received; only filled in by Retain, once somebody wants the frame
+	TArray<ANSICHAR> Frame;
+
+	// Span of the data value within the frame, or INDEX_NONE if the frame has no data
+	int32 DataStart = INDEX_NONE;
+	int32 DataLength = 0;
+
+	// Codec the frame was written with; also used to decode its data
+	const IWebSocketCodec* Codec = nullptr;
+
+	// Parses the envelope of a frame in place, without copying it; a reused response keeps its buffers' capacity
+	bool Scan(const IWebSocketCodec& InCodec, const ANSICHAR* Begin, const int32 Length)
+	{
+		Id = 0;
+		Event.Reset();
+		DataStart = INDEX_NONE;
+		DataLength = 0;
+		Codec = &InCodec;
+		return InCodec.ScanResponse(Begin, Length, *this);
+	}
+
+	// Copies the scanned frame so its data can be decoded after the receive buffer is reused
+	void Retain(const ANSICHAR* Begin, const int32 Length)
+	{
+		Frame.Reset(Length);
+		Frame.Append(Begin, Length);
+	}
+
+	bool IsError() const
+	{
+		return Event.Equals(TEXT("Error"), ESearchCase::CaseSensitive);
+	}
+
+	template <typename T>
+	bool DecodeData(T& OutData) const
+	{
+		if (DataStart == INDEX_NONE || DataStart + DataLength > Frame.Num()) return false;
+		return Codec != nullptr && Codec->DecodeData(Frame.GetData() + DataStart, DataLength, T::StaticStruct(), &OutData);
+	}
+};
@@ -0,0 +1,263 @@
+#include "WebSocketStandInServer.h"
+#include "INetworkingWebSocket.h"
+#include "IWebSocketNetworkingModule.h"
+#include "IWebSocketServer.h"
+#include "JsonStreamReader.h"
+#include "MsgPackStream.h"
+#include "WebSocketNetworkingDelegates.h"
+#include "WebSocketStructs.h"
+
+namespace
+{
+	// A frame split across several receive callbacks is given up on past this size
+	constexpr int32 MaxFrameBytes = 1024 * 1024;
+
+	// libwebsockets hands large frames over in pieces, and only a whole value parses
+	bool IsWholeValue(const IWebSocketCodec& Codec, const ANSICHAR* Data, const int32 Length)
+	{
+		if (&Codec == &IWebSocketCodec::MsgPack())
+		{
+			return FMsgPackReader(Data, Data + Length).SkipValue();
+		}
+		return TJsonStreamReader<ANSICHAR>(Data, Data + Length).SkipValue();
+	}
+
+	template <typename TRequest>
+	bool IsMsgType(const FWebSocketRequestHeader& Request)
+	{
+		return Request.MsgType.Equals(TWebSocketMessage<TRequest>::GetName(), ESearchCase::CaseSensitive);
+	}
+
+	template <typename T>
+	bool DecodeRequestData(const IWebSocketCodec& Codec, const ANSICHAR* Frame, const FWebSocketRequestHeader& Request, T& OutData)
+	{
+		return Request.DataStart != INDEX_NONE && Codec.DecodeData(Frame + Request.DataStart, Request.DataLength, T::StaticStruct(), &OutData);
+	}
+
+	double GetUnixTimeMs()
+	{
+		return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalMilliseconds();
+	}
+}
+
+FWebSocketStandInServer::FWebSocketStandInServer(const float InChatPushInterval, const float InDelay)
+	: ChatPushInterval(InChatPushInterval), Delay(FMath::Max(InDelay, 0.0f))
+{
+}
+
+FWebSocketStandInServer::~FWebSocketStandInServer()
+{
+	Stop();
+}
+
+void FWebSocketStandInServer::Stop()
+{
+	// Sockets go first, since the server owns the context they were created in
+	Delayed.Reset();
+	Clients.Reset();
+	Server.Reset();
+}
+
+bool FWebSocketStandInServer::Start(const uint32 Port)
+{
+	IWebSocketNetworkingModule* Module = FModuleManager::LoadModulePtr<IWebSocketNetworkingModule>(TEXT("WebSocketNetworking"));
+	if (Module == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Stand-in server needs the WebSocketNetworking plugin"));
+		return false;
+	}
+
+	Server = Module->CreateServer();
+	if (!Server->Init(Port, FWebSocketClientConnectedCallBack::CreateRaw(this, &FWebSocketStandInServer::OnClientConnected)))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Stand-in server couldn't listen on port %u"), Port);
+		Server.Reset();
+		return false;
+	}
+	ServeFrom = FPlatformTime::Seconds() + Delay;
+	NextChatPushTime = FPlatformTime::Seconds() + ChatPushInterval;
+	UE_LOG(LogTemp, Log, TEXT("Stand-in server listening on %s"), *GetUrl(Port));
+	return true;
+}
+
+void FWebSocketStandInServer::Tick()
+{
+	const double Now = FPlatformTime::Seconds();
+	if (!Server.IsValid() || Now < ServeFrom) return;
+	Server->Tick();
+	SendDelayed(Now);
+
+	// Dropped here rather than in the close callback, which runs inside the socket being closed
+	Delayed.RemoveAll([](const FDelayedFrame& Frame)
+	{
+		return Frame.Client->bClosed;
+	});
+	Clients.RemoveAll([](const TUniquePtr<FClient>& Client)
+	{
+		return Client->bClosed;
+	});
+
+	if (ChatPushInterval > 0.0f && FPlatformTime::Seconds() >= NextChatPushTime)
+	{
+		NextChatPushTime = FPlatformTime::Seconds() + ChatPushInterval;
+		SendChatPushes();
+	}
+}
+
+TArray<uint64> FWebSocketStandInServer::GetEchoesPerClient() const
+{
+	TArray<uint64> Echoes;
+	for (const TUniquePtr<FClient>& Client : Clients)
+	{
+		if (!Client->bClosed)
+		{
+			Echoes.Add(Client->EchoesHandled);
+		}
+	}
+	return Echoes;
+}
+
+void FWebSocketStandInServer::OnClientConnected(INetworkingWebSocket* Socket)
+{
+	TUniquePtr<FClient>& Client = Clients.Add_GetRef(MakeUnique<FClient>());
+	Client->Socket.Reset(Socket);
+	++ConnectionsAccepted;
+
+	FClient* Connected = Client.Get();
+	Socket->SetRecieveCallBack(FWebSocketPacketRecievedCallBack::CreateRaw(this, &FWebSocketStandInServer::OnReceived, Connected));
+	Socket->SetSocketClosedCallBack(FWebSocketInfoCallBack::CreateLambda([Connected]()
+	{
+		Connected->bClosed = true;
+	}));
+}
+
+void FWebSocketStandInServer::OnReceived(void* Data, const int32 Length, FClient* Client)
+{
+	const ANSICHAR* Frame = static_cast<const ANSICHAR*>(Data);
+	int32 FrameLength = Length;
+	if (Client->Partial.Num() > 0)
+	{
+		Client->Partial.Append(Frame, Length);
+		Frame = Client->Partial.GetData();
+		FrameLength = Client->Partial.Num();
+	}
+
+	const IWebSocketCodec& Codec = IWebSocketCodec::Detect(Frame, FrameLength);
+	if (!IsWholeValue(Codec, Frame, FrameLength))
+	{
+		if (FrameLength > MaxFrameBytes)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Stand-in server dropping a %d byte frame it couldn't parse"), FrameLength);
+			Client->Partial.Reset();
+		}
+		else if (Client->Partial.Num() == 0)
+		{
+			Client->Partial.Append(Frame, FrameLength);
+		}
+		return;
+	}
+
+	// Batches are answered one response per request, which the client handles the same as a batched answer
+	if (!Codec.SplitBatch(Frame, FrameLength, [this, Client, &Codec](const ANSICHAR* Message, const int32 MessageLength)
+	{
+		HandleRequest(*Client, Codec, Message, MessageLength);
+	}))
+	{
+		HandleRequest(*Client, Codec, Frame, FrameLength);
+	}
+	Client->Partial.Reset();
+}
+
+void FWebSocketStandInServer::HandleRequest(FClient& Client, const IWebSocketCodec& Codec, const ANSICHAR* Frame, const int32 Length)
+{
+	FWebSocketRequestHeader Request;
+	if (!Codec.ScanRequest(Frame, Length, Request))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Stand-in server couldn't read a request"));
+		return;
+	}
+	++RequestsHandled;
+	Client.Codec = &Codec;
+
+	if (IsMsgType<FFlowControlRequestData>(Request))
+	{
+		FFlowControlRequestData FlowControl;
+		DecodeRequestData(Codec, Frame, Request, FlowControl);
+		Client.bPaused = FlowControl.Paused;
+	}
+	if (!Request.bAck) return;
+
+	if (IsMsgType<FEchoRequestData>(Request))
+	{
+		FEchoRequestData Echo;
+		DecodeRequestData(Codec, Frame, Request, Echo);
+		FEchoResponseData Response;
+		Response.Val = MoveTemp(Echo.Val);
+		++Client.EchoesHandled;
+		Send(Client, Codec, Request.Id, Request.MsgType, FEchoResponseData::StaticStruct(), &Response);
+	}
+	else if (IsMsgType<FHeartbeatRequestData>(Request))
+	{
+		FHeartbeatResponseData Response;
+		Response.ServerTime = GetUnixTimeMs();
+		Send(Client, Codec, Request.Id, Request.MsgType, FHeartbeatResponseData::StaticStruct(), &Response);
+	}
+	else if (IsMsgType<FDebugLoginRequestData>(Request))
+	{
+		FDebugLoginRequestData Login;
+		DecodeRequestData(Codec, Frame, Request, Login);
+		FDebugLoginResponseData Response;
+		Response.Id = FString::Printf(TEXT("stand-in-%u"), ++NextUserId);
+		Response.Name = Login.Token;
+		Response.Created = FDateTime::UtcNow().ToIso8601();
+		Response.Updated = Response.Created;
+		Send(Client, Codec, Request.Id, Request.MsgType, FDebugLoginResponseData::StaticStruct(), &Response);
+	}
+	else
+	{
+		FMgsError Error;
+		Error.Message = FString::Printf(TEXT("Unknown msgType %s"), *Request.MsgType);
+		Send(Client, Codec, Request.Id, TWebSocketMessage<FMgsError>::GetName(), FMgsError::StaticStruct(), &Error);
+	}
+}
+
+void FWebSocketStandInServer::Send(FClient& Client, const IWebSocketCodec& Codec, const uint64 Id, const FString& Event, const UScriptStruct* Struct, const void* Data)
+{
+	if (Delay > 0.0f)
+	{
+		FDelayedFrame& Frame = Delayed.Add_GetRef({&Client, TArray<ANSICHAR>(), FPlatformTime::Seconds() + Delay});
+		Codec.WriteResponse(Id, Event, Struct, Data, Frame.Frame);
+		return;
+	}
+
+	SendBuffer.Reset();
+	Codec.WriteResponse(Id, Event, Struct, Data, SendBuffer);
+	Client.Socket->Send(reinterpret_cast<const uint8*>(SendBuffer.GetData()), SendBuffer.Num(), false);
+}
+
+void FWebSocketStandInServer::SendDelayed(const double Now)
+{
+	int32 Sent = 0;
+	for (; Sent < Delayed.Num() && Delayed[Sent].Due <= Now; ++Sent)
+	{
+		const FDelayedFrame& Frame = Delayed[Sent];
+		if (!Frame.Client->bClosed)
+		{
+			Frame.Client->Socket->Send(reinterpret_cast<const uint8*>(Frame.Frame.GetData()), Frame.Frame.Num(), false);
+		}
+	}
+	Delayed.RemoveAt(0, Sent, false);
+}
+
+void FWebSocketStandInServer::SendChatPushes()
+{
+	FChatMessage Message;
+	Message.SenderId = TEXT("stand-in");
+	for (const TUniquePtr<FClient>& Client : Clients)
+	{
+		if (Client->bPaused || Client->bClosed) continue;
+		Message.Message = FString::Printf(TEXT("Push %llu"), PushesSent + 1);
+		Send(*Client, *Client->Codec, 0, TEXT("ChatMessage"), FChatMessage::StaticStruct(), &Message);
+		++PushesSent;
+	}
+}
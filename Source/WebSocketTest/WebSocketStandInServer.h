@@ -0,0 +1,112 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WebSocketCodec.h"
+
+class INetworkingWebSocket;
+class IWebSocketServer;
+
+/**
+ * A local server speaking the client's protocol, so tests, benchmarks and load runs do not need the real backend.
+ * It answers DebugLogin, Echo and Heartbeat, takes batches, honours FlowControl, and can push a ChatMessage to every
+ * client at a fixed interval. Each request is answered in the codec it was written in.
+ *
+ * A Delay stands in for a distant server: nothing is serviced until Delay after Start, so handshakes begun as it
+ * starts take about that long, and every frame it sends leaves Delay after it was written.
+ *
+ * Built on the WebSocketNetworking plugin, which does not negotiate subprotocols, so clients connect to it with
+ * empty Codecs or with Negotiate_Codecs off. Not thread safe: tick it from the thread that started it, e.g. next to the core ticker.
+ */
+class WEBSOCKETTEST_API FWebSocketStandInServer
+{
+	public:
+	// A ChatPushInterval of 0 sends no pushes
+	explicit FWebSocketStandInServer(float InChatPushInterval = 0.0f, float InDelay = 0.0f);
+
+	~FWebSocketStandInServer();
+
+	// Listens on Port; fails if the port is taken or the plugin is not available
+	bool Start(uint32 Port);
+
+	// Services the sockets and sends any pushes that are due; call every frame
+	void Tick();
+
+	// Drops every socket without a close frame and stops listening, as a server that went away would
+	void Stop();
+
+	int32 GetNumClients() const
+	{
+		return Clients.Num();
+	}
+
+	uint64 GetRequestsHandled() const
+	{
+		return RequestsHandled;
+	}
+
+	uint64 GetPushesSent() const
+	{
+		return PushesSent;
+	}
+
+	// Handshakes completed since Start, including ones since closed
+	uint64 GetConnectionsAccepted() const
+	{
+		return ConnectionsAccepted;
+	}
+
+	// Echoes answered on each open socket, in the order they connected
+	TArray<uint64> GetEchoesPerClient() const;
+
+	static FString GetUrl(uint32 Port)
+	{
+		return FString::Printf(TEXT("ws://127.0.0.1:%u/"), Port);
+	}
+
+	private:
+	struct FClient
+	{
+		TUniquePtr<INetworkingWebSocket> Socket;
+		// A frame libwebsockets delivered in pieces, gathered until it parses
+		TArray<ANSICHAR> Partial;
+		// Codec of the client's last request, which pushes go out in
+		const IWebSocketCodec* Codec = &IWebSocketCodec::Json();
+		uint64 EchoesHandled = 0;
+		bool bPaused = false;
+		bool bClosed = false;
+	};
+
+	// A frame held back by Delay
+	struct FDelayedFrame
+	{
+		FClient* Client;
+		TArray<ANSICHAR> Frame;
+		double Due;
+	};
+
+	const float ChatPushInterval;
+	const float Delay;
+	TUniquePtr<IWebSocketServer> Server;
+	TArray<TUniquePtr<FClient>> Clients;
+	TArray<ANSICHAR> SendBuffer;
+	// In the order they were written, so also in the order they fall due
+	TArray<FDelayedFrame> Delayed;
+	double ServeFrom = 0.0;
+	double NextChatPushTime = 0.0;
+	uint64 RequestsHandled = 0;
+	uint64 PushesSent = 0;
+	uint64 ConnectionsAccepted = 0;
+	uint32 NextUserId = 0;
+
+	void OnClientConnected(INetworkingWebSocket* Socket);
+
+	void OnReceived(void* Data, int32 Length, FClient* Client);
+
+	void HandleRequest(FClient& Client, const IWebSocketCodec& Codec, const ANSICHAR* Frame, int32 Length);
+
+	void Send(FClient& Client, const IWebSocketCodec& Codec, uint64 Id, const FString& Event, const UScriptStruct* Struct, const void* Data);
+
+	void SendChatPushes();
+
+	void SendDelayed(double Now);
+};
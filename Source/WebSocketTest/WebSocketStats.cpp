@@ -0,0 +1,210 @@
+#include "WebSocketStats.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "WebSocketClient.h"
+
+DEFINE_STAT(STAT_WebSocketGameThreadCallbacks);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Clients"), STAT_WebSocketClients, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Requests In Flight"), STAT_WebSocketInFlight, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Requests"), STAT_WebSocketRequests, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Timeouts"), STAT_WebSocketTimeouts, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Errors"), STAT_WebSocketErrors, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Push Queue Depth"), STAT_WebSocketPushQueueDepth, STATGROUP_WebSocketClient);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Sent (MB)"), STAT_WebSocketMegabytesSent, STATGROUP_WebSocketClient);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Received (MB)"), STAT_WebSocketMegabytesReceived, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frames Sent"), STAT_WebSocketFramesSent, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frames Received"), STAT_WebSocketFramesReceived, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Reconnects"), STAT_WebSocketReconnects, STATGROUP_WebSocketClient);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Latency p50 (ms)"), STAT_WebSocketLatencyP50, STATGROUP_WebSocketClient);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Latency p99 (ms)"), STAT_WebSocketLatencyP99, STATGROUP_WebSocketClient);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Latency p999 (ms)"), STAT_WebSocketLatencyP999, STATGROUP_WebSocketClient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Game Thread Callbacks Queued"), STAT_WebSocketGameThreadQueueDepth, STATGROUP_WebSocketClient);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Game Thread Callbacks p99 (us)"), STAT_WebSocketGameThreadP99, STATGROUP_WebSocketClient);
+
+namespace
+{
+	FCriticalSection ClientsLock;
+	TArray<const FWebSocketClient*> Clients;
+	FDelegateHandle PublishTickerHandle;
+
+#if STATS
+	TAutoConsoleVariable<float> CVarStatsPublishInterval(
+		TEXT("WebSocket.StatsPublishInterval"),
+		1.0f,
+		TEXT("Seconds between updates of the WebSocketClient stat group; 0 updates it every frame"));
+
+	double LastPublishTime = 0.0;
+
+	// Counters are summed over clients; latency percentiles cannot be, so the worst client's are shown
+	bool PublishStats(float DeltaTime)
+	{
+		// Percentiles walk every histogram bucket, which adds up over many clients, so they are sampled rather than
+		// read every frame
+		const double Now = FPlatformTime::Seconds();
+		if (Now - LastPublishTime < CVarStatsPublishInterval.GetValueOnGameThread()) return true;
+		LastPublishTime = Now;
+
+		FWebSocketClientStats Total;
+		int32 NumClients = 0;
+		FWebSocketStatsRegistry::ForEachClient([&Total, &NumClients](const FWebSocketClient& Client)
+		{
+			// Totals only: no locks, so publishing never waits on a client that is sending
+			const FWebSocketClientStats Stats = Client.GetStats(EWebSocketStatsFields::Totals);
+			++NumClients;
+			Total.InFlight += Stats.InFlight;
+			Total.Requests += Stats.Requests;
+			Total.Timeouts += Stats.Timeouts;
+			Total.Errors += Stats.Errors;
+			Total.PushQueueDepth += Stats.PushQueueDepth;
+			Total.BytesSent += Stats.BytesSent;
+			Total.BytesReceived += Stats.BytesReceived;
+			Total.FramesSent += Stats.FramesSent;
+			Total.FramesReceived += Stats.FramesReceived;
+			Total.Reconnects += Stats.Reconnects;
+			Total.P50Ms = FMath::Max(Total.P50Ms, Stats.P50Ms);
+			Total.P99Ms = FMath::Max(Total.P99Ms, Stats.P99Ms);
+			Total.P999Ms = FMath::Max(Total.P999Ms, Stats.P999Ms);
+			Total.GameThreadQueueDepth += Stats.GameThreadQueueDepth;
+			Total.GameThreadP99Us = FMath::Max(Total.GameThreadP99Us, Stats.GameThreadP99Us);
+		});
+
+		SET_DWORD_STAT(STAT_WebSocketClients, NumClients);
+		SET_DWORD_STAT(STAT_WebSocketInFlight, Total.InFlight);
+		SET_DWORD_STAT(STAT_WebSocketRequests, Total.Requests);
+		SET_DWORD_STAT(STAT_WebSocketTimeouts, Total.Timeouts);
+		SET_DWORD_STAT(STAT_WebSocketErrors, Total.Errors);
+		SET_DWORD_STAT(STAT_WebSocketPushQueueDepth, Total.PushQueueDepth);
+		SET_FLOAT_STAT(STAT_WebSocketMegabytesSent, Total.BytesSent / (1024.0 * 1024.0));
+		SET_FLOAT_STAT(STAT_WebSocketMegabytesReceived, Total.BytesReceived / (1024.0 * 1024.0));
+		SET_DWORD_STAT(STAT_WebSocketFramesSent, Total.FramesSent);
+		SET_DWORD_STAT(STAT_WebSocketFramesReceived, Total.FramesReceived);
+		SET_DWORD_STAT(STAT_WebSocketReconnects, Total.Reconnects);
+		SET_FLOAT_STAT(STAT_WebSocketLatencyP50, Total.P50Ms);
+		SET_FLOAT_STAT(STAT_WebSocketLatencyP99, Total.P99Ms);
+		SET_FLOAT_STAT(STAT_WebSocketLatencyP999, Total.P999Ms);
+		SET_DWORD_STAT(STAT_WebSocketGameThreadQueueDepth, Total.GameThreadQueueDepth);
+		SET_FLOAT_STAT(STAT_WebSocketGameThreadP99, Total.GameThreadP99Us);
+		return true;
+	}
+#endif
+
+	FAutoConsoleCommand DumpStatsCommand(
+		TEXT("WebSocket.DumpStats"),
+		TEXT("Logs request, latency, push, traffic, memory and game thread callback stats of every websocket client, per message type; pass json for one JSON line per client"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			FWebSocketStatsRegistry::DumpStats(Args.Contains(TEXT("json")));
+		}));
+}
+
+FString FWebSocketClientStats::ToJson() const
+{
+	FString Json;
+	const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("inFlight"), InFlight);
+	Writer->WriteValue(TEXT("requests"), static_cast<int64>(Requests));
+	Writer->WriteValue(TEXT("timeouts"), static_cast<int64>(Timeouts));
+	Writer->WriteValue(TEXT("errors"), static_cast<int64>(Errors));
+	Writer->WriteValue(TEXT("cancelled"), static_cast<int64>(Cancelled));
+	Writer->WriteValue(TEXT("p50Ms"), P50Ms);
+	Writer->WriteValue(TEXT("p99Ms"), P99Ms);
+	Writer->WriteValue(TEXT("p999Ms"), P999Ms);
+	Writer->WriteValue(TEXT("pushQueueDepth"), PushQueueDepth);
+	Writer->WriteValue(TEXT("bytesSent"), static_cast<int64>(BytesSent));
+	Writer->WriteValue(TEXT("bytesReceived"), static_cast<int64>(BytesReceived));
+	Writer->WriteValue(TEXT("framesSent"), static_cast<int64>(FramesSent));
+	Writer->WriteValue(TEXT("framesReceived"), static_cast<int64>(FramesReceived));
+	Writer->WriteValue(TEXT("reconnectAttempts"), static_cast<int64>(ReconnectAttempts));
+	Writer->WriteValue(TEXT("reconnects"), static_cast<int64>(Reconnects));
+	Writer->WriteValue(TEXT("allocatedBytes"), static_cast<int64>(AllocatedBytes));
+	Writer->WriteValue(TEXT("gameThreadQueueDepth"), GameThreadQueueDepth);
+	Writer->WriteValue(TEXT("gameThreadCallbacks"), static_cast<int64>(GameThreadCallbacks));
+	Writer->WriteValue(TEXT("gameThreadP50Us"), GameThreadP50Us);
+	Writer->WriteValue(TEXT("gameThreadP99Us"), GameThreadP99Us);
+	Writer->WriteValue(TEXT("gameThreadMaxUs"), GameThreadMaxUs);
+	Writer->WriteArrayStart(TEXT("messageTypes"));
+	for (const FWebSocketMessageTypeStats& Type : MessageTypes)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("msgType"), Type.MsgType.ToString());
+		Writer->WriteValue(TEXT("requests"), static_cast<int64>(Type.Requests));
+		Writer->WriteValue(TEXT("responses"), static_cast<int64>(Type.Responses));
+		Writer->WriteValue(TEXT("timeouts"), static_cast<int64>(Type.Timeouts));
+		Writer->WriteValue(TEXT("errors"), static_cast<int64>(Type.Errors));
+		Writer->WriteValue(TEXT("cancelled"), static_cast<int64>(Type.Cancelled));
+		Writer->WriteValue(TEXT("meanMs"), Type.MeanMs);
+		Writer->WriteValue(TEXT("p50Ms"), Type.P50Ms);
+		Writer->WriteValue(TEXT("p99Ms"), Type.P99Ms);
+		Writer->WriteValue(TEXT("p999Ms"), Type.P999Ms);
+		Writer->WriteValue(TEXT("maxMs"), Type.MaxMs);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+	Writer->WriteObjectEnd();
+	Writer->Close();
+	return Json;
+}
+
+void FWebSocketStatsRegistry::Register(const FWebSocketClient* Client)
+{
+	FScopeLock Lock(&ClientsLock);
+	Clients.Add(Client);
+
+	// Without stats the STAT macros compile away, and the snapshot and console command are all there is
+#if STATS
+	if (!PublishTickerHandle.IsValid())
+	{
+		PublishTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&PublishStats));
+	}
+#endif
+}
+
+void FWebSocketStatsRegistry::Unregister(const FWebSocketClient* Client)
+{
+	FScopeLock Lock(&ClientsLock);
+	Clients.Remove(Client);
+	if (Clients.Num() == 0 && PublishTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(PublishTickerHandle);
+		PublishTickerHandle.Reset();
+	}
+}
+
+void FWebSocketStatsRegistry::ForEachClient(const TFunctionRef<void(const FWebSocketClient&)> Visit)
+{
+	FScopeLock Lock(&ClientsLock);
+	for (const FWebSocketClient* Client : Clients)
+	{
+		Visit(*Client);
+	}
+}
+
+void FWebSocketStatsRegistry::DumpStats(const bool bJson)
+{
+	int32 Index = 0;
+	ForEachClient([&Index, bJson](const FWebSocketClient& Client)
+	{
+		const FWebSocketClientStats Stats = Client.GetStats(EWebSocketStatsFields::All);
+		if (bJson)
+		{
+			UE_LOG(LogTemp, Display, TEXT("%s"), *Stats.ToJson());
+			return;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("WebSocket client %d (%s): %d in flight, %llu requests, %llu timeouts, %llu errors, %llu cancelled, p50 %.2fms p99 %.2fms p999 %.2fms"),
+			Index++, *Client.GetEndpoint(), Stats.InFlight, Stats.Requests, Stats.Timeouts, Stats.Errors, Stats.Cancelled, Stats.P50Ms, Stats.P99Ms, Stats.P999Ms);
+		UE_LOG(LogTemp, Display, TEXT("  %d pushes queued; sent %llu frames, %llu bytes; received %llu frames, %llu bytes; %llu reconnects in %llu attempts; %llu bytes held"),
+			Stats.PushQueueDepth, Stats.FramesSent, Stats.BytesSent, Stats.FramesReceived, Stats.BytesReceived, Stats.Reconnects, Stats.ReconnectAttempts, Stats.AllocatedBytes);
+		UE_LOG(LogTemp, Display, TEXT("  %llu game thread callbacks, %d queued; per frame p50 %.0fus p99 %.0fus max %.0fus"),
+			Stats.GameThreadCallbacks, Stats.GameThreadQueueDepth, Stats.GameThreadP50Us, Stats.GameThreadP99Us, Stats.GameThreadMaxUs);
+		for (const FWebSocketMessageTypeStats& Type : Stats.MessageTypes)
+		{
+			UE_LOG(LogTemp, Display, TEXT("  %s: %llu requests, %llu answered, mean %.2fms p50 %.2fms p99 %.2fms p999 %.2fms max %.2fms, %llu timeouts, %llu errors, %llu cancelled"),
+				*Type.MsgType.ToString(), Type.Requests, Type.Responses, Type.MeanMs, Type.P50Ms, Type.P99Ms, Type.P999Ms, Type.MaxMs, Type.Timeouts, Type.Errors, Type.Cancelled);
+		}
+	});
+}
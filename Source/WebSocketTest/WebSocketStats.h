@@ -0,0 +1,104 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("WebSocketClient"), STATGROUP_WebSocketClient, STATCAT_Advanced);
+
+// Game-thread time spent running completion callbacks from the clients' mailboxes
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Game Thread Callbacks"), STAT_WebSocketGameThreadCallbacks, STATGROUP_WebSocketClient, WEBSOCKETTEST_API);
+
+class FWebSocketClient;
+
+// What FWebSocketClient::GetStats fills in beyond the counters and overall percentiles, which are plain atomic reads
+enum class EWebSocketStatsFields : uint8
+{
+	Totals = 0,
+	// The per message type breakdown, read under the message type lock
+	MessageTypes = 1 << 0,
+	// AllocatedBytes, which takes the send and retained request locks, so keep it out of anything periodic
+	Memory = 1 << 1,
+	All = MessageTypes | Memory
+};
+ENUM_CLASS_FLAGS(EWebSocketStatsFields)
+
+struct FWebSocketMessageTypeStats
+{
+	FName MsgType;
+	uint64 Requests = 0;
+	// Acked requests answered without an error; the latencies are over these
+	uint64 Responses = 0;
+	uint64 Timeouts = 0;
+	uint64 Errors = 0;
+	uint64 Cancelled = 0;
+	double MeanMs = 0.0;
+	double P50Ms = 0.0;
+	double P99Ms = 0.0;
+	double P999Ms = 0.0;
+	double MaxMs = 0.0;
+};
+
+/**
+ * Point-in-time view of one client, for telemetry to poll. Counters run from construction; sampling the totals
+ * is cheap enough to do every frame.
+ */
+struct FWebSocketClientStats
+{
+	int32 InFlight = 0;
+	uint64 Requests = 0;
+	uint64 Timeouts = 0;
+	// Error responses, and requests failed locally, e.g. on disconnect
+	uint64 Errors = 0;
+	uint64 Cancelled = 0;
+
+	// Round trip latency over every message type
+	double P50Ms = 0.0;
+	double P99Ms = 0.0;
+	double P999Ms = 0.0;
+
+	int32 PushQueueDepth = 0;
+
+	uint64 BytesSent = 0;
+	uint64 BytesReceived = 0;
+	uint64 FramesSent = 0;
+	uint64 FramesReceived = 0;
+
+	uint64 ReconnectAttempts = 0;
+	uint64 Reconnects = 0;
+
+	// Memory the client holds, see FWebSocketClient::GetAllocatedSize; only filled in with EWebSocketStatsFields::Memory
+	uint64 AllocatedBytes = 0;
+
+	// RunOnGameThread callbacks waiting for a frame, and run so far
+	int32 GameThreadQueueDepth = 0;
+	uint64 GameThreadCallbacks = 0;
+
+	// Game-thread time a frame spends on those callbacks, over the frames that ran any
+	double GameThreadP50Us = 0.0;
+	double GameThreadP99Us = 0.0;
+	double GameThreadMaxUs = 0.0;
+
+	// Only filled in with EWebSocketStatsFields::MessageTypes
+	TArray<FWebSocketMessageTypeStats> MessageTypes;
+
+	// One line of JSON, for tooling that compares runs
+	FString ToJson() const;
+};
+
+/**
+ * Every live client, so the WebSocket.DumpStats console command and the WebSocketClient STAT group can cover them
+ * all. Clients register themselves on construction.
+ */
+class WEBSOCKETTEST_API FWebSocketStatsRegistry
+{
+	public:
+	static void Register(const FWebSocketClient* Client);
+
+	static void Unregister(const FWebSocketClient* Client);
+
+	// Visit runs under the registry lock, so a client cannot be destroyed while it is being read
+	static void ForEachClient(TFunctionRef<void(const FWebSocketClient&)> Visit);
+
+	// Logs every client's stats, per message type, either readably or as one line of JSON per client
+	static void DumpStats(bool bJson = false);
+};
@@ -1,9 +1,10 @@
+// Generated from WebSocketStructs.schema.json by the GenerateWebSocketMessages commandlet; edit the schema
+// and run it again rather than editing this file
 #pragma once
 
+#include "WebSocketMessage.h"
 #include "WebSocketStructs.generated.h"
 
-
-
 USTRUCT()
 struct FWebSocketRequest
 {
@@ -20,16 +21,12 @@ struct FWebSocketRequest
 };
 
 USTRUCT()
-struct  FDebugLoginRequestData
+struct FDebugLoginRequestData
 {
 	GENERATED_BODY()
 
 	UPROPERTY()
 	FString Token;
-
-	FString Name = "DebugLogin";
-
-	FString GetName() const;
 };
 
 USTRUCT()
@@ -59,7 +56,6 @@ struct FDebugLogin : public FWebSocketRequest
 	FDebugLoginRequestData Data;
 };
 
-
 USTRUCT()
 struct FMgsError
 {
@@ -67,10 +63,6 @@ struct FMgsError
 
 	UPROPERTY()
 	FString Message;
-
-	FString Name = "Error";
-
-	FString GetName() const;
 };
 
 USTRUCT()
@@ -80,10 +72,6 @@ struct FEchoRequestData
 
 	UPROPERTY()
 	FString Val;
-
-	FString Name = "Echo";
-
-	FString GetName() const;
 };
 
 USTRUCT()
@@ -114,5 +102,37 @@ struct FChatMessage
 
 	UPROPERTY()
 	FString SenderId;
+};
+
+USTRUCT()
+struct FFlowControlRequestData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	bool Paused = false; //asks the server to hold back pushes while set
+};
+
+USTRUCT()
+struct FHeartbeatRequestData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	double ClientTime = 0.0; //client unix time in ms when sent
+};
+
+USTRUCT()
+struct FHeartbeatResponseData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	double ServerTime = 0.0; //server unix time in ms when answered
+};
 
-};
\ No newline at end of file
+DECLARE_WEBSOCKET_MESSAGE(FDebugLoginRequestData, "DebugLogin", FDebugLoginResponseData, true)
+DECLARE_WEBSOCKET_MESSAGE(FEchoRequestData, "Echo", FEchoResponseData, true)
+DECLARE_WEBSOCKET_MESSAGE(FHeartbeatRequestData, "Heartbeat", FHeartbeatResponseData, true)
+DECLARE_WEBSOCKET_MESSAGE(FFlowControlRequestData, "FlowControl", void, false)
+DECLARE_WEBSOCKET_EVENT(FMgsError, "Error")
@@ -0,0 +1,233 @@
+#include "WebSocketSwarmCommandlet.h"
+#include "HAL/ThreadManager.h"
+#include "LatencyHistogram.h"
+#include "Misc/FileHelper.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "WebSocketBenchmarkCommandlet.h"
+#include "WebSocketClient.h"
+#include "WebSocketStandInServer.h"
+
+namespace
+{
+	// How long the whole swarm gets to connect and log in before the measured part starts regardless
+	constexpr double LoginTimeoutSeconds = 30.0;
+
+	constexpr uint32 EchoTimeoutMs = 10000;
+
+	// One simulated player and the state of its scripted session
+	struct FSwarmClient
+	{
+		TUniquePtr<FWebSocketClient> Client;
+		TFuture<TValueOrError<FDebugLoginResponseData, FMgsError>> Login;
+		bool bLoggedIn = false;
+		double NextEcho = 0.0;
+		TArray<TPair<double, TFuture<TValueOrError<FEchoResponseData, FMgsError>>>> Echoes;
+		uint64 Pushes = 0;
+	};
+
+	int32 CountThreads()
+	{
+		int32 Threads = 0;
+		FThreadManager::Get().ForEachThread([&Threads](uint32 ThreadId, FRunnableThread* Thread)
+		{
+			++Threads;
+		});
+		return Threads;
+	}
+}
+
+int32 UWebSocketSwarmCommandlet::Main(const FString& Params)
+{
+	int32 NumClients = 100;
+	float Rate = 10.0f;
+	float Duration = 30.0f;
+	float ChatInterval = 1.0f;
+	int32 ReactorThreads = 0;
+	uint32 Port = 18781;
+	FString OutputPath;
+	FParse::Value(*Params, TEXT("Clients="), NumClients);
+	FParse::Value(*Params, TEXT("Rate="), Rate);
+	FParse::Value(*Params, TEXT("Duration="), Duration);
+	FParse::Value(*Params, TEXT("ChatInterval="), ChatInterval);
+	FParse::Value(*Params, TEXT("ReactorThreads="), ReactorThreads);
+	FParse::Value(*Params, TEXT("Port="), Port);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	NumClients = FMath::Max(NumClients, 1);
+	Rate = FMath::Max(Rate, 0.01f);
+
+	FWebSocketStandInServer Server(ChatInterval);
+	if (!Server.Start(Port))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't start the stand-in server on port %u"), Port);
+		return 1;
+	}
+
+	const int32 ThreadsBefore = CountThreads();
+	const uint64 MemoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+
+	FWebSocketConfiguration Config;
+	Config.Url = FWebSocketStandInServer::GetUrl(Port);
+	Config.Endpoint_Cache_File = FString();
+	if (ReactorThreads > 0)
+	{
+		Config.Reactor = MakeShared<FWebSocketReactor>(ReactorThreads);
+	}
+
+	TArray<TUniquePtr<FSwarmClient>> Swarm;
+	for (int32 Index = 0; Index < NumClients; ++Index)
+	{
+		FSwarmClient& Player = *Swarm.Add_GetRef(MakeUnique<FSwarmClient>());
+		Player.Client = MakeUnique<FWebSocketClient>(Config);
+		uint64* Pushes = &Player.Pushes;
+		Player.Client->On<FChatMessage>(TEXT("ChatMessage"), [Pushes](const FChatMessage&)
+		{
+			++*Pushes;
+		});
+		Player.Client->ConnectToServer();
+	}
+
+	// Echoes start as each client logs in; the measured window opens once all of them have, or the login timeout passes
+	double LastTickTime = FPlatformTime::Seconds();
+	const double LoginDeadline = LastTickTime + LoginTimeoutSeconds;
+	double MeasureFrom = 0.0;
+	double End = TNumericLimits<double>::Max();
+	int32 LoggedIn = 0;
+	uint64 LoginErrors = 0;
+	uint64 Requests = 0;
+	uint64 Errors = 0;
+	uint64 PushesAtStart = 0;
+	uint64 PushesSentAtStart = 0;
+	uint64 MemoryLoggedIn = MemoryBefore;
+	FLatencyHistogram LatencyUs;
+	FEchoRequestData Echo;
+	Echo.Val = TEXT("swarm");
+
+	while (FPlatformTime::Seconds() < End)
+	{
+		UWebSocketBenchmarkCommandlet::PumpFrame(Server, LastTickTime);
+		const double Now = FPlatformTime::Seconds();
+		for (const TUniquePtr<FSwarmClient>& Player : Swarm)
+		{
+			FWebSocketClient& Client = *Player->Client;
+			Client.DispatchPushMessages();
+
+			if (!Player->Login.IsValid())
+			{
+				if (Client.IsConnected())
+				{
+					FDebugLoginRequestData Login;
+					Login.Token = TEXT("swarm");
+					Player->Login = Client.SendNonBlocking(Login, EchoTimeoutMs);
+				}
+				continue;
+			}
+			if (!Player->bLoggedIn)
+			{
+				if (!Player->Login.IsReady()) continue;
+				if (!Player->Login.Get().HasValue())
+				{
+					// Retried on the next frame
+					++LoginErrors;
+					Player->Login = TFuture<TValueOrError<FDebugLoginResponseData, FMgsError>>();
+					continue;
+				}
+				Player->bLoggedIn = true;
+				Player->NextEcho = Now + FMath::FRand() / Rate;
+				++LoggedIn;
+			}
+
+			while (Now >= Player->NextEcho)
+			{
+				Player->Echoes.Emplace(Now, Client.SendNonBlocking(Echo, EchoTimeoutMs));
+				Player->NextEcho += 1.0 / Rate;
+			}
+			Player->Echoes.RemoveAllSwap([&](const TPair<double, TFuture<TValueOrError<FEchoResponseData, FMgsError>>>& Sent)
+			{
+				if (!Sent.Value.IsReady()) return false;
+				if (MeasureFrom > 0.0 && Sent.Key >= MeasureFrom)
+				{
+					if (Sent.Value.Get().HasValue())
+					{
+						LatencyUs.Record(static_cast<uint64>((Now - Sent.Key) * 1000000.0));
+						++Requests;
+					}
+					else
+					{
+						++Errors;
+					}
+				}
+				return true;
+			}, false);
+		}
+
+		if (MeasureFrom == 0.0 && (LoggedIn == NumClients || Now >= LoginDeadline))
+		{
+			MeasureFrom = Now;
+			End = Now + Duration;
+			MemoryLoggedIn = FPlatformMemory::GetStats().UsedPhysical;
+			PushesSentAtStart = Server.GetPushesSent();
+			for (const TUniquePtr<FSwarmClient>& Player : Swarm)
+			{
+				PushesAtStart += Player->Pushes;
+			}
+			UE_LOG(LogTemp, Display, TEXT("%d of %d clients logged in after %.1fs"), LoggedIn, NumClients, Now - (LoginDeadline - LoginTimeoutSeconds));
+		}
+	}
+
+	int32 Connected = 0;
+	uint64 Pushes = 0;
+	uint64 ClientBytes = 0;
+	for (const TUniquePtr<FSwarmClient>& Player : Swarm)
+	{
+		Connected += Player->Client->IsConnected() ? 1 : 0;
+		Pushes += Player->Pushes;
+		ClientBytes += Player->Client->GetAllocatedSize();
+	}
+	const int32 ThreadsDuring = CountThreads();
+	const double Seconds = FMath::Max(End - MeasureFrom, 0.001);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("clients"), NumClients);
+	Writer->WriteValue(TEXT("connected"), Connected);
+	Writer->WriteValue(TEXT("loggedIn"), LoggedIn);
+	Writer->WriteValue(TEXT("loginErrors"), static_cast<int64>(LoginErrors));
+	Writer->WriteValue(TEXT("reactorThreads"), ReactorThreads);
+	Writer->WriteValue(TEXT("echoRatePerClient"), Rate);
+	Writer->WriteValue(TEXT("seconds"), Seconds);
+	Writer->WriteValue(TEXT("requests"), static_cast<int64>(Requests));
+	Writer->WriteValue(TEXT("errors"), static_cast<int64>(Errors));
+	Writer->WriteValue(TEXT("requestsPerSecond"), Requests / Seconds);
+	Writer->WriteValue(TEXT("p50Ms"), LatencyUs.GetPercentile(50.0) / 1000.0);
+	Writer->WriteValue(TEXT("p90Ms"), LatencyUs.GetPercentile(90.0) / 1000.0);
+	Writer->WriteValue(TEXT("p99Ms"), LatencyUs.GetPercentile(99.0) / 1000.0);
+	Writer->WriteValue(TEXT("maxMs"), LatencyUs.GetMax() / 1000.0);
+	Writer->WriteValue(TEXT("pushesSent"), static_cast<int64>(Server.GetPushesSent() - PushesSentAtStart));
+	Writer->WriteValue(TEXT("pushesReceived"), static_cast<int64>(Pushes - PushesAtStart));
+	Writer->WriteValue(TEXT("clientBytesPerClient"), static_cast<int64>(ClientBytes / NumClients));
+	Writer->WriteValue(TEXT("processBytesPerClient"), static_cast<int64>(MemoryLoggedIn > MemoryBefore ? (MemoryLoggedIn - MemoryBefore) / NumClients : 0));
+	Writer->WriteValue(TEXT("threadsBefore"), ThreadsBefore);
+	Writer->WriteValue(TEXT("threadsDuring"), ThreadsDuring);
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	UE_LOG(LogTemp, Display, TEXT("%d clients: %.0f requests/s, p50 %.3fms p99 %.3fms, %llu errors, %llu bytes held per client, %d threads (%d before)"),
+		NumClients, Requests / Seconds, LatencyUs.GetPercentile(50.0) / 1000.0, LatencyUs.GetPercentile(99.0) / 1000.0, Errors, ClientBytes / NumClients, ThreadsDuring, ThreadsBefore);
+	UE_LOG(LogTemp, Display, TEXT("%s"), *Json);
+
+	// Clients go before the reactor and the server they use
+	for (const TUniquePtr<FSwarmClient>& Player : Swarm)
+	{
+		Player->Client->Quit();
+	}
+	Swarm.Reset();
+
+	if (!OutputPath.IsEmpty() && !FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't write %s"), *OutputPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "WebSocketSwarmCommandlet.generated.h"
+
+/**
+ * Drives many headless clients from one process against an in-process stand-in server, to find how many a process
+ * can carry and what each one costs. Every client connects, logs in with DebugLogin, then echoes at a fixed rate
+ * while the server pushes a ChatMessage to all of them at an interval.
+ *
+ * UE4Editor-Cmd WebSocketTest.uproject -run=WebSocketSwarm [-Clients=<n>] [-Rate=<echoes/s per client>] [-Duration=<seconds>] [-ChatInterval=<seconds>] [-ReactorThreads=<n>] [-Port=<port>] [-Output=<json>]
+ *
+ * With -ReactorThreads every client is driven by one shared FWebSocketReactor; without it each client ticks itself.
+ * Throughput, echo latency percentiles, pushes received, memory per client and the process's thread count are
+ * logged and, with -Output, written to a JSON file.
+ */
+UCLASS()
+class UWebSocketSwarmCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+	public:
+	virtual int32 Main(const FString& Params) override;
+};
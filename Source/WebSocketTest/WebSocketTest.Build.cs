@@ -10,6 +10,6 @@ public class WebSocketTest : ModuleRules
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay", "WebSockets", "Json", "JsonUtilities"});
 		
-		PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore"});
+		PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore", "WebSocketNetworking"});
 	}
 }